@@ -0,0 +1,264 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "corpus/corpus.h"
+#include "query/latency_stats.h"
+#include "synthetic/synthetic_dump.h"
+#include "threading/thread_pool.h"
+
+#include <heart/types.h>
+
+#include <heart/stl/string.h>
+#include <heart/stl/vector.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+namespace
+{
+	struct CommandLine
+	{
+		// Benchmarks an existing dump instead of generating one
+		const char* dumpPath = nullptr;
+
+		const char* generatePath = "synthetic_dump.json";
+
+		SyntheticDumpConfig synthetic;
+
+		uint32 runs = 5;
+		uint32 queryCount = 2000;
+
+		// Loads on a thread pool of this many workers, or all on one thread when 0
+		uint32 threadCount = 0;
+
+		bool Parse(int argc, char* argv[])
+		{
+			for (int i = 1; i < argc; ++i)
+			{
+				const char* arg = argv[i];
+				bool hasNext = i + 1 < argc;
+
+				if (strcmp(arg, "--dump") == 0 && hasNext)
+				{
+					dumpPath = argv[++i];
+				}
+				else if (strcmp(arg, "--generate") == 0 && hasNext)
+				{
+					generatePath = argv[++i];
+				}
+				else if (strcmp(arg, "--scale") == 0 && hasNext)
+				{
+					synthetic.scale = strtof(argv[++i], nullptr);
+				}
+				else if (strcmp(arg, "--seed") == 0 && hasNext)
+				{
+					synthetic.seed = strtoull(argv[++i], nullptr, 10);
+				}
+				else if (strcmp(arg, "--runs") == 0 && hasNext)
+				{
+					runs = std::max(uint32(strtoul(argv[++i], nullptr, 10)), 1u);
+				}
+				else if (strcmp(arg, "--queries") == 0 && hasNext)
+				{
+					queryCount = uint32(strtoul(argv[++i], nullptr, 10));
+				}
+				else if (strcmp(arg, "--threads") == 0 && hasNext)
+				{
+					threadCount = uint32(strtoul(argv[++i], nullptr, 10));
+				}
+				else
+				{
+					std::cout << "Unknown or incomplete argument " << arg << std::endl;
+					std::cout << "Usage: benchmark [--dump <path> | --generate <path> [--scale <factor>] [--seed <n>]] [--runs <count>] [--queries <count>] [--threads <count>]" << std::endl;
+					return false;
+				}
+			}
+
+			return true;
+		}
+	};
+
+	struct Stage
+	{
+		const char* name = nullptr;
+		double CorpusLoadTimings::*timing = nullptr;
+		hrt::vector<double> samples;
+	};
+
+	void PrintStage(const char* name, hrt::vector<double>& samples)
+	{
+		std::sort(samples.begin(), samples.end());
+		std::cout << std::left << std::setw(24) << name << std::right << std::setw(12) << samples.front() << std::setw(12) << samples[samples.size() / 2] << std::setw(12) << samples.back() << std::endl;
+	}
+
+	// Words to look up, drawn from the corpus' own dialogue so a real dump works as well as
+	// a synthetic one. Evenly strided so the same corpus always gives the same list.
+	hrt::vector<hrt::string> PickQueryWords(const Corpus& corpus, uint32 count)
+	{
+		hrt::vector<hrt::string> words;
+		if (corpus.dialogEntries.empty() || count == 0)
+			return words;
+
+		size_t stride = std::max(corpus.dialogEntries.size() / count, size_t(1));
+		for (size_t i = 0; words.size() < count && i < corpus.dialogEntries.size() * 4; i += stride)
+		{
+			const char* text = corpus.dialogEntries[i % corpus.dialogEntries.size()].dialogText.CStr(corpus.pool);
+
+			// The (i / size)th word of the entry, so later passes pick different ones
+			size_t skip = i / corpus.dialogEntries.size();
+			hrt::string word;
+			for (const char* c = text;; ++c)
+			{
+				if (*c != '\0' && (isalnum((unsigned char)*c) || *c == '\''))
+				{
+					word.push_back(*c);
+					continue;
+				}
+
+				if (!word.empty() && skip-- == 0)
+				{
+					words.push_back(word);
+					break;
+				}
+
+				word.clear();
+				if (*c == '\0')
+					break;
+			}
+		}
+
+		return words;
+	}
+
+	LatencySummary TimeQueries(const Corpus& corpus, const hrt::vector<hrt::string>& words, uint64& outMatchCount)
+	{
+		hrt::vector<double> latencies;
+		latencies.reserve(words.size());
+		for (const hrt::string& word : words)
+		{
+			auto start = std::chrono::steady_clock::now();
+			outMatchCount += corpus.index.LookupWord(word.c_str()).size();
+			latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+		}
+
+		return SummarizeLatencies(latencies);
+	}
+
+	void PrintLatency(const char* name, const LatencySummary& summary)
+	{
+		std::cout << std::left << std::setw(24) << name << std::right << "mean " << summary.meanUs << "us, p50 " << summary.p50Us << "us, p99 " << summary.p99Us << "us, max " << summary.maxUs << "us over " << summary.count << " queries" << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	CommandLine commandLine;
+	if (!commandLine.Parse(argc, argv))
+		return 1;
+
+	const char* path = commandLine.dumpPath;
+	if (!path)
+	{
+		std::cout << "Generating synthetic dump at scale " << commandLine.synthetic.scale << " (seed " << commandLine.synthetic.seed << ")... ";
+		std::cout.flush();
+
+		auto start = std::chrono::steady_clock::now();
+		SyntheticDumpStats stats;
+		if (!WriteSyntheticDump(commandLine.generatePath, commandLine.synthetic, stats))
+		{
+			std::cout << "Failed to write " << commandLine.generatePath << std::endl;
+			return 1;
+		}
+
+		double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "Done in " << elapsedMs << "ms! " << stats.actorCount << " actors, " << stats.variableCount << " variables, " << stats.conversationCount << " conversations, ";
+		std::cout << stats.entryCount << " entries and " << stats.linkCount << " links, " << stats.byteCount / (1024 * 1024) << "MB." << std::endl;
+
+		path = commandLine.generatePath;
+	}
+
+	// One stage per phase of LoadCorpus, each timed on its own
+	Stage stages[] = {
+		{"Parse json", &CorpusLoadTimings::readMs, {}},
+		{"Build entities", &CorpusLoadTimings::parseMs, {}},
+		{"Index ids", &CorpusLoadTimings::indexIdsMs, {}},
+		{"Build graph", &CorpusLoadTimings::graphMs, {}},
+		{"FinalizeBuilder", &CorpusLoadTimings::finalizePoolMs, {}},
+		{"Compile conditions", &CorpusLoadTimings::conditionsMs, {}},
+		{"HashLookup::Compile", &CorpusLoadTimings::indexMs, {}},
+		{"NearDuplicateIndex::Build", &CorpusLoadTimings::duplicatesMs, {}},
+		{"SimilarityIndex::Build", &CorpusLoadTimings::similarityMs, {}},
+	};
+
+	hrt::vector<double> totals;
+	hrt::vector<double> coldSamples;
+	hrt::vector<double> warmSamples;
+	LatencySummary cold;
+	LatencySummary warm;
+	uint64 matchCount = 0;
+
+	std::unique_ptr<ThreadPool> threads;
+	if (commandLine.threadCount != 0)
+		threads = std::make_unique<ThreadPool>(commandLine.threadCount);
+
+	std::cout << "Loading " << path << " " << commandLine.runs << " times" << (threads ? " on a thread pool" : "") << "... ";
+	std::cout.flush();
+	for (uint32 run = 0; run < commandLine.runs; ++run)
+	{
+		// Fresh corpus every run, so nothing is warm but the OS file cache
+		Corpus corpus;
+		CorpusLoadTimings timings;
+		if (!LoadCorpus(path, corpus, nullptr, &timings, threads.get()))
+		{
+			std::cout << "Failed to load " << path << std::endl;
+			return 1;
+		}
+
+		for (Stage& stage : stages)
+		{
+			stage.samples.push_back(timings.*stage.timing);
+		}
+
+		// Wall time, stages overlap on a thread pool
+		totals.push_back(timings.totalMs);
+
+		// The first lookup of each word misses the query cache, repeating it hits
+		hrt::vector<hrt::string> words = PickQueryWords(corpus, commandLine.queryCount);
+		cold = TimeQueries(corpus, words, matchCount);
+		warm = TimeQueries(corpus, words, matchCount);
+		coldSamples.push_back(cold.p99Us);
+		warmSamples.push_back(warm.p99Us);
+	}
+	std::cout << "Done!" << std::endl;
+
+	std::cout << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << std::left << std::setw(24) << "Stage (ms)" << std::right << std::setw(12) << "min" << std::setw(12) << "median" << std::setw(12) << "max" << std::endl;
+	for (Stage& stage : stages)
+	{
+		PrintStage(stage.name, stage.samples);
+	}
+	PrintStage("Total", totals);
+	PrintStage("Cold query p99 (us)", coldSamples);
+	PrintStage("Warm query p99 (us)", warmSamples);
+
+	std::cout << std::endl;
+	std::cout << "Last run's query latency:" << std::endl;
+	PrintLatency("Cold", cold);
+	PrintLatency("Warm", warm);
+	std::cout << matchCount << " matches in total." << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,439 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "synthetic/synthetic_dump.h"
+
+#include <heart/stl/string.h>
+#include <heart/stl/vector.h>
+
+#include <rapidjson/filewritestream.h>
+#include <rapidjson/writer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+	typedef rapidjson::Writer<rapidjson::FileWriteStream> DumpWriter;
+
+	const char* const CommonWords[] = {
+		"the", "you", "to", "a", "i", "it", "of", "and", "is", "that", "in", "what", "this", "me", "he", "no", "not", "be", "was", "do",
+		"your", "for", "have", "on", "are", "with", "we", "there", "but", "just", "they", "like", "know", "so", "can", "about", "one", "all", "at", "get",
+		"here", "him", "out", "my", "man", "if", "think", "some", "now", "she", "her", "from", "how", "right", "up", "look", "don't", "it's", "good", "yes",
+		"detective", "kim", "harry", "case", "body", "tree", "hanged", "union", "martinaise", "lieutenant", "shivers", "electrochemistry", "inland", "empire", "volition", "logic",
+		"rhetoric", "drama", "encyclopedia", "authority", "empathy", "suggestion", "esprit", "corps", "half", "light", "composure", "endurance", "pain", "threshold", "physical", "instrument",
+		"perception", "reaction", "speed", "savoir", "faire", "interfacing", "visual", "calculus", "hand", "eye", "coordination", "whirling", "rags", "harbour", "fishing", "village",
+		"church", "coast", "sea", "fortress", "pier", "boardwalk", "bookstore", "pawnshop", "apartment", "hostel", "cafeteria", "kineema", "motor", "carriage", "tape", "necktie",
+		"badge", "gun", "ledger", "money", "reál", "speed", "amphetamine", "pyrholidon", "cigarettes", "alcohol", "drink", "memory", "dream", "morning", "evening", "night",
+		"rain", "cold", "wind", "window", "door", "street", "hotel", "ceiling", "fan", "mirror", "face", "thought", "cabinet", "skill", "check", "dice",
+		"white", "red", "passive", "active", "success", "failure", "critical", "bonus", "penalty", "experience", "level", "point", "task", "quest", "clue", "evidence",
+		"witness", "suspect", "motive", "alibi", "autopsy", "corpse", "boot", "belt", "shirt", "jacket", "coat", "hat", "glasses", "shoes", "trousers", "pocket",
+		"communist", "moralist", "ultraliberal", "fascist", "revolution", "history", "politics", "coalition", "government", "wealth", "capital", "labour", "strike", "dock", "workers", "truck",
+		"mercenary", "soldier", "war", "peace", "world", "pale", "isola", "revachol", "insulinde", "graad", "semenine", "katla", "mesque", "sur", "la", "clef",
+		"cuno", "cunoesse", "evrart", "klaasje", "joyce", "measurehead", "titus", "garte", "lena", "gaston", "ruby", "soona", "idiot", "doom", "spiral", "angus",
+		"siileng", "plaisance", "lilienne", "elizabeth", "rene", "trant", "jean", "vicquemare", "judit", "minot", "mack", "torson", "chester", "mcleod", "acele", "morell",
+	};
+
+	// Deterministic on every platform, unlike the standard distributions
+	class SyntheticRandom
+	{
+		uint64 m_state;
+
+	public:
+		explicit SyntheticRandom(uint64 seed) :
+			m_state(seed)
+		{
+		}
+
+		// splitmix64
+		uint64 Next()
+		{
+			uint64 z = (m_state += 0x9E3779B97F4A7C15ull);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return z ^ (z >> 31);
+		}
+
+		float NextFloat()
+		{
+			return float(Next() >> 40) * (1.0f / float(1 << 24));
+		}
+
+		uint32 Below(uint32 bound)
+		{
+			return bound == 0 ? 0 : uint32(Next() % bound);
+		}
+
+		uint32 Between(uint32 low, uint32 high)
+		{
+			return low + Below(high - low + 1);
+		}
+
+		bool Chance(float probability)
+		{
+			return NextFloat() < probability;
+		}
+	};
+
+	// Common words first, then a long tail of made-up ones built from syllables
+	const hrt::vector<hrt::string>& GetWords()
+	{
+		static const hrt::vector<hrt::string> words = []() {
+			const char* const syllables[] = {"ka", "ro", "vi", "sel", "mun", "dra", "quo", "tes", "ber", "lin", "ash", "gor", "pel", "zun", "ith", "or"};
+			constexpr uint32 TailCount = 6000;
+
+			hrt::vector<hrt::string> result;
+			for (const char* word : CommonWords)
+			{
+				result.push_back(word);
+			}
+
+			for (uint32 i = 0; i < TailCount; ++i)
+			{
+				hrt::string word;
+				for (uint32 value = i + 16; value != 0; value /= 16)
+				{
+					word += syllables[value % 16];
+				}
+
+				result.push_back(word);
+			}
+
+			return result;
+		}();
+
+		return words;
+	}
+
+	// Zipf-ish: low indices are far more likely than high ones
+	const hrt::string& PickWord(SyntheticRandom& random)
+	{
+		const hrt::vector<hrt::string>& words = GetWords();
+		float u = random.NextFloat();
+		return words[std::min(uint32(float(words.size()) * u * u * u * u), uint32(words.size() - 1))];
+	}
+
+	void MakeSentence(SyntheticRandom& random, uint32 minWords, uint32 maxWords, hrt::string& out)
+	{
+		out.clear();
+		uint32 wordCount = random.Between(minWords, maxWords);
+		for (uint32 i = 0; i < wordCount; ++i)
+		{
+			if (i != 0)
+				out += random.Chance(0.08f) ? ", " : " ";
+
+			const hrt::string& word = PickWord(random);
+			out += word;
+			if (i == 0)
+				out[out.size() - word.size()] = char(toupper(out[out.size() - word.size()]));
+		}
+
+		out += random.Chance(0.2f) ? "?" : ".";
+	}
+
+	void WriteField(DumpWriter& writer, const char* title, const char* value)
+	{
+		writer.StartObject();
+		writer.Key("title");
+		writer.String(title);
+		writer.Key("value");
+		writer.String(value);
+		writer.Key("type");
+		writer.String("Text");
+		writer.EndObject();
+	}
+
+	// The real dump stores most numbers as strings, which also exercises the loader's coercion
+	void WriteField(DumpWriter& writer, const char* title, uint64 value, bool hex = false)
+	{
+		char buffer[32];
+		snprintf(buffer, sizeof(buffer), hex ? "0x%016llX" : "%llu", (unsigned long long)value);
+		WriteField(writer, title, buffer);
+	}
+
+	struct PendingLink
+	{
+		uint32 origin = 0;
+		uint32 destinationConversation = 0;
+		uint32 destinationEntry = 0;
+		bool isConnector = false;
+	};
+
+	void WriteActors(DumpWriter& writer, SyntheticRandom& random, uint32 count, uint64& articyId)
+	{
+		hrt::string text;
+
+		writer.Key("actors");
+		writer.StartArray();
+		for (uint32 id = 1; id <= count; ++id)
+		{
+			writer.StartObject();
+			writer.Key("id");
+			writer.Int(int32(id));
+			writer.Key("fields");
+			writer.StartArray();
+
+			MakeSentence(random, 1, 3, text);
+			text.pop_back();
+			WriteField(writer, "Name", id == 1 ? "You" : text.c_str());
+			WriteField(writer, "IsPlayer", id == 1 ? "True" : "False");
+			WriteField(writer, "IsNPC", id == 1 ? "False" : "True");
+			WriteField(writer, "IsFemale", random.Chance(0.4f) ? "True" : "False");
+			WriteField(writer, "color", random.Below(40));
+			WriteField(writer, "Articy Id", articyId++, true);
+			WriteField(writer, "character_short_name", text.c_str());
+			WriteField(writer, "Pictures", "[]");
+			MakeSentence(random, 4, 20, text);
+			WriteField(writer, "Description", text.c_str());
+			MakeSentence(random, 2, 8, text);
+			WriteField(writer, "short_description", text.c_str());
+			MakeSentence(random, 10, 60, text);
+			WriteField(writer, "LongDescription", text.c_str());
+
+			writer.EndArray();
+			writer.EndObject();
+		}
+		writer.EndArray();
+	}
+
+	void WriteVariables(DumpWriter& writer, SyntheticRandom& random, const hrt::vector<hrt::string>& names)
+	{
+		hrt::string text;
+
+		writer.Key("variables");
+		writer.StartArray();
+		for (uint32 i = 0; i < uint32(names.size()); ++i)
+		{
+			writer.StartObject();
+			writer.Key("id");
+			writer.Int(int32(i + 1));
+			writer.Key("fields");
+			writer.StartArray();
+
+			WriteField(writer, "Name", names[i].c_str());
+			if (random.Chance(0.8f))
+				WriteField(writer, "Initial Value", random.Chance(0.1f) ? "True" : "False");
+			else
+				WriteField(writer, "Initial Value", random.Below(5));
+
+			MakeSentence(random, 3, 12, text);
+			WriteField(writer, "Description", text.c_str());
+
+			writer.EndArray();
+			writer.EndObject();
+		}
+		writer.EndArray();
+	}
+
+	void MakeCondition(SyntheticRandom& random, const hrt::vector<hrt::string>& variables, hrt::string& out)
+	{
+		out.clear();
+		uint32 termCount = random.Chance(0.7f) ? 1 : random.Between(2, 4);
+		for (uint32 i = 0; i < termCount; ++i)
+		{
+			if (i != 0)
+				out += random.Chance(0.75f) ? " and " : " or ";
+
+			if (random.Chance(0.15f))
+				out += "not ";
+
+			out += "Variable[\"";
+			out += variables[random.Below(uint32(variables.size()))];
+			out += "\"]";
+
+			if (random.Chance(0.7f))
+			{
+				out += random.Chance(0.8f) ? " == true" : " == false";
+			}
+			else
+			{
+				char buffer[16];
+				snprintf(buffer, sizeof(buffer), " >= %u", random.Between(1, 4));
+				out += buffer;
+			}
+		}
+	}
+
+	void WriteConversation(DumpWriter& writer, SyntheticRandom& random, const SyntheticDumpConfig& config, uint32 id, uint32 conversationCount, uint32 actorCount, const hrt::vector<hrt::string>& variables, uint64& articyId, SyntheticDumpStats& stats)
+	{
+		// Pareto-shaped lengths: E[u^-0.6] = 2.5, so this averages out near the configured size
+		float u = std::max(random.NextFloat(), 1e-4f);
+		uint32 average = config.averageEntriesPerConversation;
+		uint32 entryCount = std::min(uint32(float(average) * 0.4f / std::pow(u, 0.6f)) + 2, average * 40);
+
+		uint32 npc = actorCount > 1 ? random.Between(2, actorCount) : 1;
+
+		// Every entry hangs off a recent one, some links jump back or leave the conversation
+		hrt::vector<PendingLink> links;
+		for (uint32 entry = 1; entry < entryCount; ++entry)
+		{
+			uint32 parent = entry - 1 - random.Below(std::min(entry, 8u));
+			links.push_back(PendingLink {parent, id, entry, false});
+
+			if (random.Chance(0.1f))
+				links.push_back(PendingLink {entry, id, random.Below(entry), false});
+
+			if (random.Chance(config.crossConversationLinkRate))
+				links.push_back(PendingLink {entry, random.Between(1, conversationCount), 0, true});
+		}
+
+		std::stable_sort(links.begin(), links.end(), [](const PendingLink& a, const PendingLink& b) { return a.origin < b.origin; });
+
+		hrt::string text;
+
+		writer.StartObject();
+		writer.Key("id");
+		writer.Int(int32(id));
+		writer.Key("fields");
+		writer.StartArray();
+		MakeSentence(random, 2, 5, text);
+		text.pop_back();
+		WriteField(writer, "Title", text.c_str());
+		WriteField(writer, "Articy Id", articyId++, true);
+		MakeSentence(random, 5, 25, text);
+		WriteField(writer, "Description", text.c_str());
+		writer.EndArray();
+
+		writer.Key("dialogueEntries");
+		writer.StartArray();
+		size_t nextLink = 0;
+		for (uint32 entry = 0; entry < entryCount; ++entry)
+		{
+			bool isStart = entry == 0;
+			bool isGroup = !isStart && random.Chance(config.groupRate);
+			uint32 actor = (entry % 2 == 0) ? 1 : npc;
+
+			writer.StartObject();
+			writer.Key("id");
+			writer.Int(int32(entry));
+			writer.Key("conversationId");
+			writer.Int(int32(id));
+			writer.Key("isRoot");
+			writer.Uint(isStart ? 1 : 0);
+			writer.Key("isGroup");
+			writer.Uint(isGroup ? 1 : 0);
+			writer.Key("conditionPriority");
+			writer.Int(2);
+
+			writer.Key("conditionsString");
+			if (!isStart && random.Chance(config.conditionRate))
+				MakeCondition(random, variables, text);
+			else
+				text.clear();
+			writer.String(text.c_str());
+
+			writer.Key("fields");
+			writer.StartArray();
+			if (isStart || isGroup)
+				text = isStart ? "START" : "HUB";
+			else
+				MakeSentence(random, 1, 4, text);
+			WriteField(writer, "Title", text.c_str());
+			if (isStart || isGroup)
+				text.clear();
+			else
+				MakeSentence(random, 3, 40, text);
+			WriteField(writer, "Dialogue Text", text.c_str());
+			WriteField(writer, "Articy Id", articyId++, true);
+			WriteField(writer, "Actor", actor);
+			WriteField(writer, "Conversant", actor == 1 ? npc : 1);
+			WriteField(writer, "OutputId", articyId++, true);
+			WriteField(writer, "InputId", articyId++, true);
+			writer.EndArray();
+
+			writer.Key("outgoingLinks");
+			writer.StartArray();
+			for (; nextLink < links.size() && links[nextLink].origin == entry; ++nextLink)
+			{
+				const PendingLink& link = links[nextLink];
+				writer.StartObject();
+				writer.Key("originConversationID");
+				writer.Int(int32(id));
+				writer.Key("originDialogueID");
+				writer.Int(int32(entry));
+				writer.Key("destinationConversationID");
+				writer.Int(int32(link.destinationConversation));
+				writer.Key("destinationDialogueID");
+				writer.Int(int32(link.destinationEntry));
+				writer.Key("isConnector");
+				writer.Uint(link.isConnector ? 1 : 0);
+				writer.Key("priority");
+				writer.Uint(2);
+				writer.EndObject();
+			}
+			writer.EndArray();
+
+			writer.EndObject();
+		}
+		writer.EndArray();
+		writer.EndObject();
+
+		stats.entryCount += entryCount;
+		stats.linkCount += uint32(links.size());
+	}
+}
+
+bool WriteSyntheticDump(const char* path, const SyntheticDumpConfig& config, SyntheticDumpStats& outStats)
+{
+	FILE* file = nullptr;
+	fopen_s(&file, path, "wb");
+	if (!file)
+		return false;
+
+	outStats = SyntheticDumpStats {};
+	outStats.actorCount = std::max(uint32(float(config.actorCount) * config.scale), 1u);
+	outStats.variableCount = std::max(uint32(float(config.variableCount) * config.scale), 1u);
+	outStats.conversationCount = std::max(uint32(float(config.conversationCount) * config.scale), 1u);
+
+	SyntheticRandom random(config.seed);
+	uint64 articyId = 0x0100000000000000ull;
+
+	hrt::vector<hrt::string> variableNames;
+	variableNames.reserve(outStats.variableCount);
+	const char* const areas[] = {"whirling", "church", "coast", "plaza", "village", "yard", "tequila", "kim", "jam", "apt"};
+	for (uint32 i = 0; i < outStats.variableCount; ++i)
+	{
+		// Drawn one at a time, the order arguments are evaluated in differs between compilers
+		const char* area = areas[random.Below(10)];
+		const hrt::string& first = PickWord(random);
+		const hrt::string& second = PickWord(random);
+
+		char buffer[96];
+		snprintf(buffer, sizeof(buffer), "%s.%s_%s_%u", area, first.c_str(), second.c_str(), i);
+		variableNames.push_back(buffer);
+	}
+
+	constexpr size_t BufferSize = 1ull << 16;
+	char* buffer = (char*)malloc(BufferSize);
+	rapidjson::FileWriteStream stream(file, buffer, BufferSize);
+	DumpWriter writer(stream);
+
+	writer.StartObject();
+	WriteActors(writer, random, outStats.actorCount, articyId);
+	WriteVariables(writer, random, variableNames);
+
+	writer.Key("conversations");
+	writer.StartArray();
+	for (uint32 id = 1; id <= outStats.conversationCount; ++id)
+	{
+		WriteConversation(writer, random, config, id, outStats.conversationCount, outStats.actorCount, variableNames, articyId, outStats);
+	}
+	writer.EndArray();
+	writer.EndObject();
+
+	stream.Flush();
+	outStats.byteCount = uint64(ftell(file));
+	bool succeeded = ferror(file) == 0;
+
+	fclose(file);
+	free(buffer);
+	return succeeded;
+}
@@ -0,0 +1,50 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include <heart/types.h>
+
+// Sizes roughly follow the real dump at scale 1. Conversation lengths are skewed so a few
+// are huge and most are short, and words are picked with a Zipf-like bias so the index
+// sees a realistic mix of very common and very rare words.
+struct SyntheticDumpConfig
+{
+	uint64 seed = 1;
+
+	uint32 actorCount = 420;
+	uint32 variableCount = 10500;
+	uint32 conversationCount = 1400;
+
+	// Average over all conversations, the longest get many times this
+	uint32 averageEntriesPerConversation = 50;
+
+	// Chance an entry has a condition, links to another conversation, or is a hub
+	float conditionRate = 0.15f;
+	float crossConversationLinkRate = 0.02f;
+	float groupRate = 0.05f;
+
+	// Multiplies the actor, variable and conversation counts
+	float scale = 1.0f;
+};
+
+struct SyntheticDumpStats
+{
+	uint32 actorCount = 0;
+	uint32 variableCount = 0;
+	uint32 conversationCount = 0;
+	uint32 entryCount = 0;
+	uint32 linkCount = 0;
+	uint64 byteCount = 0;
+};
+
+// Writes a dump with the same layout LoadCorpus reads: actors, variables and
+// conversations holding dialogueEntries, each with a "fields" array of title/value pairs.
+// The same config always produces the same file.
+bool WriteSyntheticDump(const char* path, const SyntheticDumpConfig& config, SyntheticDumpStats& outStats);
@@ -24,3 +24,7 @@ project "generator"
 		get_root_location() .. "external/rapidjson/include",
 		"src/"
 	}
+
+	links {
+		"Ws2_32",
+	}
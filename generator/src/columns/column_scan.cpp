@@ -0,0 +1,211 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "columns/column_scan.h"
+
+#include <cstdint>
+#include <emmintrin.h>
+
+namespace
+{
+	// Every op is one of the three SSE2 compares, possibly negated
+	enum class BaseCompare : uint8
+	{
+		Equal,
+		Less,
+		Greater,
+	};
+
+	struct CompareKernel
+	{
+		BaseCompare base;
+		bool negate;
+	};
+
+	CompareKernel GetKernel(CompareOp op)
+	{
+		switch (op)
+		{
+		case CompareOp::Equal: return CompareKernel {BaseCompare::Equal, false};
+		case CompareOp::NotEqual: return CompareKernel {BaseCompare::Equal, true};
+		case CompareOp::Less: return CompareKernel {BaseCompare::Less, false};
+		case CompareOp::GreaterEqual: return CompareKernel {BaseCompare::Less, true};
+		case CompareOp::Greater: return CompareKernel {BaseCompare::Greater, false};
+		case CompareOp::LessEqual: return CompareKernel {BaseCompare::Greater, true};
+		}
+
+		return CompareKernel {BaseCompare::Equal, false};
+	}
+
+	uint32 GetWordCount(uint32 count)
+	{
+		return (count + 63) / 64;
+	}
+
+	// Applies the negation and clears the bits past the last row
+	void FinishWords(uint64* words, uint32 count, bool negate)
+	{
+		uint32 wordCount = GetWordCount(count);
+		if (negate)
+		{
+			for (uint32 i = 0; i < wordCount; ++i)
+			{
+				words[i] = ~words[i];
+			}
+		}
+
+		if (count & 63)
+			words[wordCount - 1] &= (uint64(1) << (count & 63)) - 1;
+	}
+
+	// For a constant outside what the column type can hold, every row compares the same way
+	void FillConstant(uint64* words, uint32 count, CompareOp op, bool valueAboveRange)
+	{
+		bool result = false;
+		switch (op)
+		{
+		case CompareOp::Equal: result = false; break;
+		case CompareOp::NotEqual: result = true; break;
+		case CompareOp::Less:
+		case CompareOp::LessEqual: result = valueAboveRange; break;
+		case CompareOp::Greater:
+		case CompareOp::GreaterEqual: result = !valueAboveRange; break;
+		}
+
+		for (uint32 i = 0; i < GetWordCount(count); ++i)
+		{
+			words[i] = result ? ~uint64(0) : 0;
+		}
+
+		FinishWords(words, count, false);
+	}
+
+	__m128i Compare32(__m128i values, __m128i needle, BaseCompare base)
+	{
+		switch (base)
+		{
+		case BaseCompare::Equal: return _mm_cmpeq_epi32(values, needle);
+		case BaseCompare::Less: return _mm_cmplt_epi32(values, needle);
+		case BaseCompare::Greater: return _mm_cmpgt_epi32(values, needle);
+		}
+
+		return _mm_setzero_si128();
+	}
+
+	__m128i Compare16(__m128i values, __m128i needle, BaseCompare base)
+	{
+		switch (base)
+		{
+		case BaseCompare::Equal: return _mm_cmpeq_epi16(values, needle);
+		case BaseCompare::Less: return _mm_cmplt_epi16(values, needle);
+		case BaseCompare::Greater: return _mm_cmpgt_epi16(values, needle);
+		}
+
+		return _mm_setzero_si128();
+	}
+
+	__m128i Compare8(__m128i values, __m128i needle, BaseCompare base)
+	{
+		switch (base)
+		{
+		case BaseCompare::Equal: return _mm_cmpeq_epi8(values, needle);
+		case BaseCompare::Less: return _mm_cmplt_epi8(values, needle);
+		case BaseCompare::Greater: return _mm_cmpgt_epi8(values, needle);
+		}
+
+		return _mm_setzero_si128();
+	}
+}
+
+void ScanColumn(const int32* column, uint32 count, CompareOp op, int32 value, uint64* outWords)
+{
+	CompareKernel kernel = GetKernel(op);
+	__m128i needle = _mm_set1_epi32(value);
+
+	for (uint32 word = 0; word < GetWordCount(count); ++word)
+	{
+		const int32* rows = column + word * 64;
+
+		uint64 bits = 0;
+		for (uint32 i = 0; i < 64; i += 4)
+		{
+			__m128i values = _mm_loadu_si128((const __m128i*)(rows + i));
+			__m128i mask = Compare32(values, needle, kernel.base);
+			bits |= uint64(_mm_movemask_ps(_mm_castsi128_ps(mask))) << i;
+		}
+
+		outWords[word] = bits;
+	}
+
+	FinishWords(outWords, count, kernel.negate);
+}
+
+void ScanColumn(const int16* column, uint32 count, CompareOp op, int32 value, uint64* outWords)
+{
+	if (value < INT16_MIN || value > INT16_MAX)
+	{
+		FillConstant(outWords, count, op, value > INT16_MAX);
+		return;
+	}
+
+	CompareKernel kernel = GetKernel(op);
+	__m128i needle = _mm_set1_epi16(int16(value));
+	__m128i zero = _mm_setzero_si128();
+
+	for (uint32 word = 0; word < GetWordCount(count); ++word)
+	{
+		const int16* rows = column + word * 64;
+
+		uint64 bits = 0;
+		for (uint32 i = 0; i < 64; i += 8)
+		{
+			__m128i values = _mm_loadu_si128((const __m128i*)(rows + i));
+			__m128i mask = Compare16(values, needle, kernel.base);
+
+			// Narrow each 16-bit lane to a byte so movemask gives one bit per row
+			bits |= uint64(_mm_movemask_epi8(_mm_packs_epi16(mask, zero)) & 0xFF) << i;
+		}
+
+		outWords[word] = bits;
+	}
+
+	FinishWords(outWords, count, kernel.negate);
+}
+
+void ScanColumn(const uint8* column, uint32 count, CompareOp op, int32 value, uint64* outWords)
+{
+	if (value < 0 || value > UINT8_MAX)
+	{
+		FillConstant(outWords, count, op, value > UINT8_MAX);
+		return;
+	}
+
+	CompareKernel kernel = GetKernel(op);
+
+	// SSE2 only compares signed bytes, flipping the top bit keeps unsigned order
+	__m128i bias = _mm_set1_epi8(char(0x80));
+	__m128i needle = _mm_xor_si128(_mm_set1_epi8(char(value)), bias);
+
+	for (uint32 word = 0; word < GetWordCount(count); ++word)
+	{
+		const uint8* rows = column + word * 64;
+
+		uint64 bits = 0;
+		for (uint32 i = 0; i < 64; i += 16)
+		{
+			__m128i values = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(rows + i)), bias);
+			__m128i mask = Compare8(values, needle, kernel.base);
+			bits |= uint64(uint32(_mm_movemask_epi8(mask))) << i;
+		}
+
+		outWords[word] = bits;
+	}
+
+	FinishWords(outWords, count, kernel.negate);
+}
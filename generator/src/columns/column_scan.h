@@ -0,0 +1,30 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include <heart/types.h>
+
+enum class CompareOp : uint8
+{
+	Equal,
+	NotEqual,
+	Less,
+	LessEqual,
+	Greater,
+	GreaterEqual,
+};
+
+// Vectorized compares of a whole column against a constant. Each writes one bit per row
+// into outWords (bit i of word i / 64), for count rows; the column must be readable up to
+// count rounded up to 64, and any bits past count come back clear. SSE2 is part of x64,
+// so there's no fallback path to select at runtime.
+void ScanColumn(const int32* column, uint32 count, CompareOp op, int32 value, uint64* outWords);
+void ScanColumn(const int16* column, uint32 count, CompareOp op, int32 value, uint64* outWords);
+void ScanColumn(const uint8* column, uint32 count, CompareOp op, int32 value, uint64* outWords);
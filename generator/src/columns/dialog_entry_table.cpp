@@ -0,0 +1,173 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "columns/dialog_entry_table.h"
+
+#include <charconv>
+
+namespace
+{
+	uint32 PadToBlock(uint32 count)
+	{
+		return (count + 63) / 64 * 64;
+	}
+
+	struct ColumnName
+	{
+		std::string_view name;
+		EntryColumn column;
+	};
+
+	constexpr ColumnName ColumnNames[] = {
+		{"id", EntryColumn::Id},
+		{"conversationid", EntryColumn::ConversationId},
+		{"conversation", EntryColumn::Conversation},
+		{"actor", EntryColumn::Actor},
+		{"conversant", EntryColumn::Conversant},
+		{"priority", EntryColumn::ConditionPriority},
+		{"root", EntryColumn::IsRoot},
+		{"group", EntryColumn::IsGroup},
+	};
+}
+
+void DialogEntryTable::Build(const EntityVector<DialogEntry>& entries, const EntityVector<Conversation>& conversations)
+{
+	m_rowCount = uint32(entries.size());
+	uint32 padded = PadToBlock(m_rowCount);
+
+	// Padding rows stay zeroed, scans mask them off
+	m_id.assign(padded, 0);
+	m_conversationId.assign(padded, 0);
+	m_conversation.assign(padded, 0);
+	m_actor.assign(padded, 0);
+	m_conversant.assign(padded, 0);
+	m_conditionPriority.assign(padded, 0);
+	m_isRoot.assign(padded, 0);
+	m_isGroup.assign(padded, 0);
+	m_articyId.assign(m_rowCount, 0);
+
+	for (uint32 row = 0; row < m_rowCount; ++row)
+	{
+		const DialogEntry& entry = entries[row];
+		m_id[row] = entry.id;
+		m_conversationId[row] = entry.conversationId;
+		m_actor[row] = entry.actor;
+		m_conversant[row] = entry.conversant;
+		m_conditionPriority[row] = entry.conditionPriority;
+		m_isRoot[row] = entry.isRoot;
+		m_isGroup[row] = entry.isGroup;
+		m_articyId[row] = entry.articyId;
+	}
+
+	for (uint32 i = 0; i < conversations.size(); ++i)
+	{
+		const Conversation& conversation = conversations[i];
+		for (uint32 row = conversation.firstDialogEntry; row < conversation.firstDialogEntry + conversation.dialogEntryCount; ++row)
+		{
+			m_conversation[row] = int32(i);
+		}
+	}
+}
+
+void DialogEntryTable::Scan(const ColumnPredicate& predicate, DenseBitset& out) const
+{
+	if (out.GetSize() != m_rowCount)
+		out.Resize(m_rowCount);
+
+	uint64* words = out.GetWords();
+	switch (predicate.column)
+	{
+	case EntryColumn::Id: ScanColumn(m_id.data(), m_rowCount, predicate.op, predicate.value, words); break;
+	case EntryColumn::ConversationId: ScanColumn(m_conversationId.data(), m_rowCount, predicate.op, predicate.value, words); break;
+	case EntryColumn::Conversation: ScanColumn(m_conversation.data(), m_rowCount, predicate.op, predicate.value, words); break;
+	case EntryColumn::Actor: ScanColumn(m_actor.data(), m_rowCount, predicate.op, predicate.value, words); break;
+	case EntryColumn::Conversant: ScanColumn(m_conversant.data(), m_rowCount, predicate.op, predicate.value, words); break;
+	case EntryColumn::ConditionPriority: ScanColumn(m_conditionPriority.data(), m_rowCount, predicate.op, predicate.value, words); break;
+	case EntryColumn::IsRoot: ScanColumn(m_isRoot.data(), m_rowCount, predicate.op, predicate.value, words); break;
+	case EntryColumn::IsGroup: ScanColumn(m_isGroup.data(), m_rowCount, predicate.op, predicate.value, words); break;
+	}
+}
+
+DenseBitset DialogEntryTable::Select(std::span<const ColumnPredicate> predicates) const
+{
+	DenseBitset selection(m_rowCount);
+	if (predicates.empty())
+	{
+		selection.SetAll();
+		return selection;
+	}
+
+	Scan(predicates[0], selection);
+
+	DenseBitset scratch(m_rowCount);
+	for (size_t i = 1; i < predicates.size(); ++i)
+	{
+		Scan(predicates[i], scratch);
+		selection &= scratch;
+	}
+
+	return selection;
+}
+
+bool ParseColumnPredicate(std::string_view text, ColumnPredicate& outPredicate)
+{
+	size_t opStart = text.find_first_of("=!<>");
+	if (opStart == std::string_view::npos || opStart == 0)
+		return false;
+
+	std::string_view name = text.substr(0, opStart);
+	bool found = false;
+	for (const ColumnName& column : ColumnNames)
+	{
+		if (column.name == name)
+		{
+			outPredicate.column = column.column;
+			found = true;
+			break;
+		}
+	}
+
+	if (!found)
+		return false;
+
+	std::string_view rest = text.substr(opStart);
+	size_t opLength = rest.size() > 1 && rest[1] == '=' ? 2 : 1;
+	std::string_view op = rest.substr(0, opLength);
+
+	if (op == "=" || op == "==")
+		outPredicate.op = CompareOp::Equal;
+	else if (op == "!=")
+		outPredicate.op = CompareOp::NotEqual;
+	else if (op == "<")
+		outPredicate.op = CompareOp::Less;
+	else if (op == "<=")
+		outPredicate.op = CompareOp::LessEqual;
+	else if (op == ">")
+		outPredicate.op = CompareOp::Greater;
+	else if (op == ">=")
+		outPredicate.op = CompareOp::GreaterEqual;
+	else
+		return false;
+
+	std::string_view value = rest.substr(opLength);
+	auto result = std::from_chars(value.data(), value.data() + value.size(), outPredicate.value);
+	return result.ec == std::errc() && result.ptr == value.data() + value.size();
+}
+
+DenseBitset MatchesToSelection(const ManagedStringPool& pool, const hrt::vector<ManagedString>& matches, uint32 rowCount)
+{
+	DenseBitset selection(rowCount);
+	for (const ManagedString& match : matches)
+	{
+		if (match.GetLookbackType(pool) == ObjectType::DialogEntry)
+			selection.Set(match.GetLookbackIndex(pool));
+	}
+
+	return selection;
+}
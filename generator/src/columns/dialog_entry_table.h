@@ -0,0 +1,113 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "columns/column_scan.h"
+#include "memory/dense_bitset.h"
+#include "memory/managed_string.h"
+#include "memory/memory_tracker.h"
+#include "types/conversation.h"
+#include "types/dialogue_entry.h"
+
+#include <heart/types.h>
+
+#include <heart/stl/vector.h>
+
+#include <span>
+#include <string_view>
+
+enum class EntryColumn : uint8
+{
+	Id,
+	ConversationId,
+	Conversation, // dense index into the corpus' conversations
+	Actor,
+	Conversant,
+	ConditionPriority,
+	IsRoot,
+	IsGroup,
+};
+
+struct ColumnPredicate
+{
+	EntryColumn column = EntryColumn::Id;
+	CompareOp op = CompareOp::Equal;
+	int32 value = 0;
+};
+
+// The corpus' scalar dialog entry fields again, one array per field. Scans over the small
+// int fields only touch the bytes they compare, and run 4 to 16 rows per instruction. Rows
+// are the dense entry indices, and every column is padded to a whole number of 64-row
+// blocks. The strings aren't copied, row i's text is the corpus' dialogEntries[i].
+class DialogEntryTable
+{
+	uint32 m_rowCount = 0;
+
+	hrt::vector<int32> m_id;
+	hrt::vector<int32> m_conversationId;
+	hrt::vector<int32> m_conversation;
+	hrt::vector<int32> m_actor;
+	hrt::vector<int32> m_conversant;
+	hrt::vector<int16> m_conditionPriority;
+	hrt::vector<uint8> m_isRoot;
+	hrt::vector<uint8> m_isGroup;
+	hrt::vector<uint64> m_articyId;
+
+public:
+	void Build(const EntityVector<DialogEntry>& entries, const EntityVector<Conversation>& conversations);
+
+	uint32 GetRowCount() const
+	{
+		return m_rowCount;
+	}
+
+	// Sets exactly the rows where the predicate holds, out is resized to fit
+	void Scan(const ColumnPredicate& predicate, DenseBitset& out) const;
+
+	// Rows where every predicate holds, all rows if there are none
+	DenseBitset Select(std::span<const ColumnPredicate> predicates) const;
+
+	std::span<const int32> GetActors() const
+	{
+		return std::span<const int32>(m_actor.data(), m_rowCount);
+	}
+
+	std::span<const int32> GetConversants() const
+	{
+		return std::span<const int32>(m_conversant.data(), m_rowCount);
+	}
+
+	std::span<const int32> GetConversations() const
+	{
+		return std::span<const int32>(m_conversation.data(), m_rowCount);
+	}
+
+	std::span<const uint8> GetIsRoot() const
+	{
+		return std::span<const uint8>(m_isRoot.data(), m_rowCount);
+	}
+
+	std::span<const uint8> GetIsGroup() const
+	{
+		return std::span<const uint8>(m_isGroup.data(), m_rowCount);
+	}
+
+	std::span<const uint64> GetArticyIds() const
+	{
+		return std::span<const uint64>(m_articyId.data(), m_rowCount);
+	}
+};
+
+// "actor=12", "priority>2", "root!=0"... Column names are id, conversationid,
+// conversation, actor, conversant, priority, root and group.
+bool ParseColumnPredicate(std::string_view text, ColumnPredicate& outPredicate);
+
+// The dialog entries among a text search's matches, as a selection over table rows
+DenseBitset MatchesToSelection(const ManagedStringPool& pool, const hrt::vector<ManagedString>& matches, uint32 rowCount);
@@ -0,0 +1,455 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "conditions/condition_compiler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+namespace
+{
+	enum class TokenType : uint8
+	{
+		End,
+		Error,
+		Identifier,
+		Number,
+		String,
+		LeftParen,
+		RightParen,
+		LeftBracket,
+		RightBracket,
+		Comma,
+		Minus,
+		Comparison,
+	};
+
+	struct Token
+	{
+		TokenType type = TokenType::End;
+		std::string_view text;
+	};
+
+	bool IsIdentifierStart(char c)
+	{
+		return std::isalpha((unsigned char)c) || c == '_';
+	}
+
+	bool IsIdentifierPart(char c)
+	{
+		return std::isalnum((unsigned char)c) || c == '_' || c == '.';
+	}
+
+	class Lexer
+	{
+		std::string_view m_source;
+		size_t m_position = 0;
+
+		Token Make(TokenType type, size_t start, size_t end)
+		{
+			m_position = end;
+			return Token {type, m_source.substr(start, end - start)};
+		}
+
+	public:
+		explicit Lexer(std::string_view source) :
+			m_source(source)
+		{
+		}
+
+		Token Next()
+		{
+			while (m_position < m_source.size() && std::isspace((unsigned char)m_source[m_position]))
+				++m_position;
+
+			if (m_position >= m_source.size())
+				return Token {};
+
+			size_t start = m_position;
+			char c = m_source[start];
+			char next = start + 1 < m_source.size() ? m_source[start + 1] : '\0';
+
+			if (IsIdentifierStart(c))
+			{
+				size_t end = start + 1;
+				while (end < m_source.size() && IsIdentifierPart(m_source[end]))
+					++end;
+
+				return Make(TokenType::Identifier, start, end);
+			}
+
+			if (std::isdigit((unsigned char)c))
+			{
+				size_t end = start + 1;
+				while (end < m_source.size() && (std::isdigit((unsigned char)m_source[end]) || m_source[end] == '.'))
+					++end;
+
+				return Make(TokenType::Number, start, end);
+			}
+
+			if (c == '"' || c == '\'')
+			{
+				// The token text is the contents, without the quotes
+				for (size_t end = start + 1; end < m_source.size(); ++end)
+				{
+					if (m_source[end] == '\\')
+						++end;
+					else if (m_source[end] == c)
+					{
+						m_position = end + 1;
+						return Token {TokenType::String, m_source.substr(start + 1, end - start - 1)};
+					}
+				}
+
+				return Make(TokenType::Error, start, m_source.size());
+			}
+
+			switch (c)
+			{
+			case '(':
+				return Make(TokenType::LeftParen, start, start + 1);
+			case ')':
+				return Make(TokenType::RightParen, start, start + 1);
+			case '[':
+				return Make(TokenType::LeftBracket, start, start + 1);
+			case ']':
+				return Make(TokenType::RightBracket, start, start + 1);
+			case ',':
+				return Make(TokenType::Comma, start, start + 1);
+			case '-':
+				return Make(TokenType::Minus, start, start + 1);
+			case '=':
+			case '~':
+				if (next == '=')
+					return Make(TokenType::Comparison, start, start + 2);
+				break;
+			case '<':
+			case '>':
+				return Make(TokenType::Comparison, start, next == '=' ? start + 2 : start + 1);
+			}
+
+			return Make(TokenType::Error, start, m_source.size());
+		}
+	};
+
+	// What an already emitted subexpression looks like to whatever uses it
+	struct Operand
+	{
+		size_t codeStart = 0;
+		uint32 depth = 0;
+
+		// It is, or contains, a PushUnknown
+		bool unknown = false;
+
+		// A string literal, which never makes it into the code
+		bool string = false;
+	};
+
+	// Recursive descent with Lua's precedence: or, and, comparisons, then unary not and minus
+	class Parser
+	{
+		Lexer m_lexer;
+		Token m_current;
+
+		const hrt::unordered_map<std::string_view, uint32>& m_variableLookup;
+		hrt::vector<ConditionInstruction>& m_code;
+		hrt::vector<uint32>& m_variables;
+
+		bool m_failed = false;
+		bool m_partial = false;
+
+		void Advance()
+		{
+			m_current = m_lexer.Next();
+			if (m_current.type == TokenType::Error)
+				m_failed = true;
+		}
+
+		bool IsKeyword(std::string_view keyword) const
+		{
+			return m_current.type == TokenType::Identifier && m_current.text == keyword;
+		}
+
+		bool Expect(TokenType type)
+		{
+			if (m_current.type != type)
+			{
+				m_failed = true;
+				return false;
+			}
+
+			Advance();
+			return true;
+		}
+
+		Operand Push(ConditionOp op, int32 operand)
+		{
+			Operand result;
+			result.codeStart = m_code.size();
+			result.depth = 1;
+
+			m_code.push_back(ConditionInstruction {op, operand});
+			return result;
+		}
+
+		// Throws away everything emitted since start and leaves a single unknown in its place
+		Operand MakeUnknown(size_t start)
+		{
+			m_code.resize(start);
+			m_partial = true;
+
+			Operand result = Push(ConditionOp::PushUnknown, 0);
+			result.unknown = true;
+			return result;
+		}
+
+		Operand Combine(ConditionOp op, const Operand& left, const Operand& right)
+		{
+			Operand result;
+			result.codeStart = left.codeStart;
+			result.depth = std::max(left.depth, right.depth + 1);
+			result.unknown = left.unknown || right.unknown;
+
+			m_code.push_back(ConditionInstruction {op, 0});
+			return result;
+		}
+
+		Operand ParseOr()
+		{
+			Operand left = ParseAnd();
+			while (!m_failed && IsKeyword("or"))
+			{
+				Advance();
+				Operand right = ParseAnd();
+				left = (left.string || right.string) ? MakeUnknown(left.codeStart) : Combine(ConditionOp::Or, left, right);
+			}
+
+			return left;
+		}
+
+		Operand ParseAnd()
+		{
+			Operand left = ParseComparison();
+			while (!m_failed && IsKeyword("and"))
+			{
+				Advance();
+				Operand right = ParseComparison();
+				left = (left.string || right.string) ? MakeUnknown(left.codeStart) : Combine(ConditionOp::And, left, right);
+			}
+
+			return left;
+		}
+
+		Operand ParseComparison()
+		{
+			Operand left = ParseUnary();
+			if (m_failed || m_current.type != TokenType::Comparison)
+				return left;
+
+			std::string_view comparison = m_current.text;
+			Advance();
+			Operand right = ParseUnary();
+
+			// Optimistically treating an unknown as true only works where it's a plain boolean
+			if (left.unknown || right.unknown || left.string || right.string)
+				return MakeUnknown(left.codeStart);
+
+			ConditionOp op = ConditionOp::Equal;
+			if (comparison == "~=")
+				op = ConditionOp::NotEqual;
+			else if (comparison == "<")
+				op = ConditionOp::Less;
+			else if (comparison == "<=")
+				op = ConditionOp::LessEqual;
+			else if (comparison == ">")
+				op = ConditionOp::Greater;
+			else if (comparison == ">=")
+				op = ConditionOp::GreaterEqual;
+
+			return Combine(op, left, right);
+		}
+
+		Operand ParseUnary()
+		{
+			if (IsKeyword("not"))
+			{
+				Advance();
+				Operand operand = ParseUnary();
+				if (operand.unknown || operand.string)
+					return MakeUnknown(operand.codeStart);
+
+				m_code.push_back(ConditionInstruction {ConditionOp::Not, 0});
+				return operand;
+			}
+
+			if (m_current.type == TokenType::Minus)
+			{
+				Advance();
+				if (m_current.type != TokenType::Number)
+				{
+					m_failed = true;
+					return Operand {};
+				}
+
+				Operand number = ParsePrimary();
+				if (!m_failed)
+					m_code.back().operand = -m_code.back().operand;
+
+				return number;
+			}
+
+			return ParsePrimary();
+		}
+
+		Operand ParsePrimary()
+		{
+			if (m_current.type == TokenType::LeftParen)
+			{
+				Advance();
+				Operand inner = ParseOr();
+				Expect(TokenType::RightParen);
+				return inner;
+			}
+
+			if (m_current.type == TokenType::Number)
+			{
+				double value = 0.0;
+				const char* first = m_current.text.data();
+				const char* last = first + m_current.text.size();
+
+				// Programs only work on int32, so a constant like 2.5 can't be compiled without
+				// changing what it compares against
+				auto result = std::from_chars(first, last, value);
+				if (result.ec != std::errc() || result.ptr != last || !(value <= double(INT32_MAX)) || double(int32(value)) != value)
+				{
+					m_failed = true;
+					return Operand {};
+				}
+
+				Advance();
+				return Push(ConditionOp::PushConstant, int32(value));
+			}
+
+			if (m_current.type == TokenType::String)
+			{
+				Operand result;
+				result.codeStart = m_code.size();
+				result.string = true;
+
+				Advance();
+				return result;
+			}
+
+			if (m_current.type != TokenType::Identifier)
+			{
+				m_failed = true;
+				return Operand {};
+			}
+
+			if (IsKeyword("true") || IsKeyword("false") || IsKeyword("nil"))
+			{
+				int32 value = IsKeyword("true") ? 1 : 0;
+				Advance();
+				return Push(ConditionOp::PushConstant, value);
+			}
+
+			if (IsKeyword("and") || IsKeyword("or") || IsKeyword("not"))
+			{
+				m_failed = true;
+				return Operand {};
+			}
+
+			size_t start = m_code.size();
+
+			if (IsKeyword("Variable"))
+			{
+				Advance();
+				if (!Expect(TokenType::LeftBracket) || m_current.type != TokenType::String)
+				{
+					m_failed = true;
+					return Operand {};
+				}
+
+				std::string_view name = m_current.text;
+				Advance();
+				if (!Expect(TokenType::RightBracket))
+					return Operand {};
+
+				auto iter = m_variableLookup.find(name);
+				if (iter == m_variableLookup.end())
+					return MakeUnknown(start);
+
+				m_variables.push_back(iter->second);
+				return Push(ConditionOp::PushVariable, int32(iter->second));
+			}
+
+			// Anything else is a call into the game (CheckItem, IsKimHere...) or a global we
+			// know nothing about. Skip its arguments and treat the whole thing as unknown.
+			Advance();
+			if (m_current.type == TokenType::LeftParen)
+			{
+				uint32 nesting = 0;
+				do
+				{
+					if (m_current.type == TokenType::LeftParen)
+						++nesting;
+					else if (m_current.type == TokenType::RightParen)
+						--nesting;
+					else if (m_current.type == TokenType::End)
+						m_failed = true;
+
+					Advance();
+				} while (nesting > 0 && !m_failed);
+			}
+
+			return MakeUnknown(start);
+		}
+
+	public:
+		Parser(std::string_view source, const hrt::unordered_map<std::string_view, uint32>& variableLookup, hrt::vector<ConditionInstruction>& code, hrt::vector<uint32>& variables) :
+			m_lexer(source),
+			m_variableLookup(variableLookup),
+			m_code(code),
+			m_variables(variables)
+		{
+		}
+
+		CompileStatus Compile()
+		{
+			Advance();
+			if (m_current.type == TokenType::End)
+				return CompileStatus::Compiled;
+
+			size_t start = m_code.size();
+			Operand result = ParseOr();
+
+			if (!m_failed && m_current.type != TokenType::End)
+				m_failed = true;
+
+			if (!m_failed && result.string)
+				result = MakeUnknown(start);
+
+			if (m_failed || result.depth > MaxConditionStackDepth)
+			{
+				m_code.resize(start);
+				m_code.push_back(ConditionInstruction {ConditionOp::PushUnknown, 0});
+				return CompileStatus::Failed;
+			}
+
+			return m_partial ? CompileStatus::Partial : CompileStatus::Compiled;
+		}
+	};
+}
+
+CompileStatus CompileCondition(std::string_view source, const hrt::unordered_map<std::string_view, uint32>& variableLookup, hrt::vector<ConditionInstruction>& outCode, hrt::vector<uint32>& outVariables)
+{
+	Parser parser(source, variableLookup, outCode, outVariables);
+	return parser.Compile();
+}
@@ -0,0 +1,66 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include <heart/types.h>
+
+#include <heart/stl/unordered_map.h>
+#include <heart/stl/vector.h>
+
+#include <string_view>
+
+// Condition programs run on a small value stack with no jumps: every instruction pops its
+// operands and pushes one result, so a program can be stepped across many game states at
+// once. Values are int32, booleans being 0 and 1.
+enum class ConditionOp : uint8
+{
+	PushConstant, // operand is the value
+	PushVariable, // operand is the variable's index in the corpus
+	PushUnknown, // something we can't evaluate (a function call, a string comparison...)
+	Not,
+	And,
+	Or,
+	Equal,
+	NotEqual,
+	Less,
+	LessEqual,
+	Greater,
+	GreaterEqual,
+};
+
+struct ConditionInstruction
+{
+	ConditionOp op = ConditionOp::PushConstant;
+	int32 operand = 0;
+};
+
+enum class CompileStatus : uint8
+{
+	Compiled,
+
+	// Compiled, but parts of it are PushUnknown
+	Partial,
+
+	// Couldn't be parsed or used a constant that isn't an int32, the program is a single
+	// PushUnknown
+	Failed,
+};
+
+// The deepest stack any compiled program is allowed to need
+constexpr uint32 MaxConditionStackDepth = 32;
+
+// Compiles one Lua-style condition (Variable["..."] comparisons combined with and/or/not)
+// and appends it to outCode. Variable names resolve through variableLookup; every
+// variable the program reads is appended to outVariables. An empty source compiles to
+// an empty program, which is always true.
+//
+// Unknowns only ever end up where a boolean is expected: anything compared against
+// one, or negated, collapses into a single PushUnknown.
+CompileStatus CompileCondition(std::string_view source, const hrt::unordered_map<std::string_view, uint32>& variableLookup, hrt::vector<ConditionInstruction>& outCode, hrt::vector<uint32>& outVariables);
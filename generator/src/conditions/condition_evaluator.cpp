@@ -0,0 +1,176 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "conditions/condition_evaluator.h"
+
+#include "conditions/condition_table.h"
+#include "threading/thread_pool.h"
+
+#include <heart/debug/assert.h>
+
+#include <algorithm>
+#include <bit>
+
+namespace
+{
+	// Entries handled per job. A multiple of 64 so no two jobs write the same bitset word.
+	constexpr uint32 EntriesPerJob = 4096;
+
+	struct alignas(64) Lanes
+	{
+		int32 values[ConditionLaneCount];
+	};
+
+	// Plain loops over fixed-width lanes, which the compiler turns into SIMD
+	template <typename F>
+	void Apply(Lanes& left, const Lanes& right, F op)
+	{
+		for (uint32 i = 0; i < ConditionLaneCount; ++i)
+		{
+			left.values[i] = op(left.values[i], right.values[i]) ? 1 : 0;
+		}
+	}
+
+	void Fill(Lanes& target, int32 value)
+	{
+		for (uint32 i = 0; i < ConditionLaneCount; ++i)
+		{
+			target.values[i] = value;
+		}
+	}
+
+	// Bit i is set if the program passes in state firstState + i
+	uint64 EvaluateBlock(std::span<const ConditionInstruction> program, const GameStates& states, uint32 firstState, int32 unknownValue, Lanes* stack)
+	{
+		if (program.empty())
+			return ~uint64(0);
+
+		uint32 top = 0;
+		for (const ConditionInstruction& instruction : program)
+		{
+			switch (instruction.op)
+			{
+			case ConditionOp::PushConstant:
+				Fill(stack[top++], instruction.operand);
+				break;
+			case ConditionOp::PushVariable:
+				std::copy_n(states.GetLanes(uint32(instruction.operand), firstState), ConditionLaneCount, stack[top++].values);
+				break;
+			case ConditionOp::PushUnknown:
+				Fill(stack[top++], unknownValue);
+				break;
+			case ConditionOp::Not:
+				for (int32& value : stack[top - 1].values)
+				{
+					value = value == 0 ? 1 : 0;
+				}
+				break;
+			case ConditionOp::And:
+				Apply(stack[top - 2], stack[top - 1], [](int32 a, int32 b) { return (a != 0) & (b != 0); });
+				--top;
+				break;
+			case ConditionOp::Or:
+				Apply(stack[top - 2], stack[top - 1], [](int32 a, int32 b) { return (a != 0) | (b != 0); });
+				--top;
+				break;
+			case ConditionOp::Equal:
+				Apply(stack[top - 2], stack[top - 1], [](int32 a, int32 b) { return a == b; });
+				--top;
+				break;
+			case ConditionOp::NotEqual:
+				Apply(stack[top - 2], stack[top - 1], [](int32 a, int32 b) { return a != b; });
+				--top;
+				break;
+			case ConditionOp::Less:
+				Apply(stack[top - 2], stack[top - 1], [](int32 a, int32 b) { return a < b; });
+				--top;
+				break;
+			case ConditionOp::LessEqual:
+				Apply(stack[top - 2], stack[top - 1], [](int32 a, int32 b) { return a <= b; });
+				--top;
+				break;
+			case ConditionOp::Greater:
+				Apply(stack[top - 2], stack[top - 1], [](int32 a, int32 b) { return a > b; });
+				--top;
+				break;
+			case ConditionOp::GreaterEqual:
+				Apply(stack[top - 2], stack[top - 1], [](int32 a, int32 b) { return a >= b; });
+				--top;
+				break;
+			}
+		}
+
+		HEART_ASSERT(top == 1);
+
+		uint64 mask = 0;
+		for (uint32 i = 0; i < ConditionLaneCount; ++i)
+		{
+			mask |= uint64(stack[0].values[i] != 0) << i;
+		}
+
+		return mask;
+	}
+}
+
+GameStates::GameStates(const EntityVector<Variable>& variables, uint32 stateCount) :
+	m_stateCount(stateCount),
+	m_variableCount(uint32(variables.size())),
+	m_stride((stateCount + ConditionLaneCount - 1) / ConditionLaneCount * ConditionLaneCount)
+{
+	m_values.resize(size_t(m_variableCount) * m_stride);
+
+	for (uint32 variable = 0; variable < m_variableCount; ++variable)
+	{
+		// Both fields are filled from the same value, and a nonzero number reads as true too.
+		// The number holds booleans as 1/0, so it's the one to trust.
+		int32 initial = variables[variable].initialValueNumber;
+		std::fill_n(m_values.data() + size_t(variable) * m_stride, m_stride, initial);
+	}
+}
+
+hrt::vector<DenseBitset> EvaluateConditions(const ConditionTable& conditions, const GameStates& states, ThreadPool& threads, UnknownPolicy unknowns)
+{
+	uint32 entryCount = conditions.GetEntryCount();
+	uint32 stateCount = states.GetStateCount();
+
+	hrt::vector<DenseBitset> available(stateCount);
+	for (DenseBitset& bits : available)
+	{
+		bits.Resize(entryCount);
+	}
+
+	uint32 blockCount = (stateCount + ConditionLaneCount - 1) / ConditionLaneCount;
+	uint32 entryRangeCount = (entryCount + EntriesPerJob - 1) / EntriesPerJob;
+	int32 unknownValue = unknowns == UnknownPolicy::AssumeTrue ? 1 : 0;
+
+	threads.ParallelFor(blockCount * entryRangeCount, [&](uint32 job) {
+		uint32 firstState = (job / entryRangeCount) * ConditionLaneCount;
+		uint32 firstEntry = (job % entryRangeCount) * EntriesPerJob;
+		uint32 lastEntry = std::min(firstEntry + EntriesPerJob, entryCount);
+
+		// Lanes past the last state are padding, don't report them
+		uint32 liveLanes = std::min(ConditionLaneCount, stateCount - firstState);
+		uint64 liveMask = liveLanes == 64 ? ~uint64(0) : (uint64(1) << liveLanes) - 1;
+
+		Lanes stack[MaxConditionStackDepth];
+
+		for (uint32 entry = firstEntry; entry < lastEntry; ++entry)
+		{
+			uint64 passed = EvaluateBlock(conditions.GetProgram(entry), states, firstState, unknownValue, stack) & liveMask;
+			while (passed != 0)
+			{
+				uint32 lane = uint32(std::countr_zero(passed));
+				available[firstState + lane].Set(entry);
+				passed &= passed - 1;
+			}
+		}
+	});
+
+	return available;
+}
@@ -0,0 +1,77 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "memory/dense_bitset.h"
+#include "memory/memory_tracker.h"
+#include "types/variable.h"
+
+#include <heart/types.h>
+
+#include <heart/stl/vector.h>
+
+class ConditionTable;
+class ThreadPool;
+
+// Programs are evaluated for this many states at a time, one lane each
+constexpr uint32 ConditionLaneCount = 64;
+
+// Any number of candidate save states, stored variable-major: all the states' values for
+// one variable are contiguous, so an instruction reading it walks a straight run of memory.
+// Rows are padded to a whole number of lane blocks.
+class GameStates
+{
+	hrt::vector<int32> m_values;
+	uint32 m_stateCount = 0;
+	uint32 m_variableCount = 0;
+	uint32 m_stride = 0;
+
+public:
+	// Every state starts out with each variable's initial value
+	GameStates(const EntityVector<Variable>& variables, uint32 stateCount);
+
+	uint32 GetStateCount() const
+	{
+		return m_stateCount;
+	}
+
+	uint32 GetVariableCount() const
+	{
+		return m_variableCount;
+	}
+
+	int32 Get(uint32 state, uint32 variable) const
+	{
+		return m_values[size_t(variable) * m_stride + state];
+	}
+
+	void Set(uint32 state, uint32 variable, int32 value)
+	{
+		m_values[size_t(variable) * m_stride + state] = value;
+	}
+
+	// ConditionLaneCount values, starting at firstState
+	const int32* GetLanes(uint32 variable, uint32 firstState) const
+	{
+		return m_values.data() + size_t(variable) * m_stride + firstState;
+	}
+};
+
+enum class UnknownPolicy : uint8
+{
+	// Unknowns only appear where a boolean is expected, so these give an upper and a
+	// lower bound on what's really available.
+	AssumeTrue,
+	AssumeFalse,
+};
+
+// For every state, the set of dialog entries whose conditions pass in it. Work is split
+// into blocks of states by ranges of entries and spread over the pool.
+hrt::vector<DenseBitset> EvaluateConditions(const ConditionTable& conditions, const GameStates& states, ThreadPool& threads, UnknownPolicy unknowns = UnknownPolicy::AssumeTrue);
@@ -0,0 +1,142 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "conditions/condition_table.h"
+
+#include "profiling/profiler.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+namespace
+{
+	const char* GetOpName(ConditionOp op)
+	{
+		switch (op)
+		{
+		case ConditionOp::PushConstant: return "push";
+		case ConditionOp::PushVariable: return "load";
+		case ConditionOp::PushUnknown: return "unknown";
+		case ConditionOp::Not: return "not";
+		case ConditionOp::And: return "and";
+		case ConditionOp::Or: return "or";
+		case ConditionOp::Equal: return "eq";
+		case ConditionOp::NotEqual: return "ne";
+		case ConditionOp::Less: return "lt";
+		case ConditionOp::LessEqual: return "le";
+		case ConditionOp::Greater: return "gt";
+		case ConditionOp::GreaterEqual: return "ge";
+		}
+
+		return "?";
+	}
+}
+
+uint32 ConditionTable::Compile(const EntityVector<DialogEntry>& entries, const EntityVector<Variable>& variables, const ManagedStringPool& pool)
+{
+	PROFILE_SCOPE("ConditionTable::Compile");
+
+	uint32 entryCount = uint32(entries.size());
+	uint32 variableCount = uint32(variables.size());
+
+	m_variableLookup.clear();
+	m_variableLookup.reserve(variables.size());
+	for (uint32 i = 0; i < variableCount; ++i)
+	{
+		m_variableLookup.emplace(std::string_view(variables[i].name.CStr(pool)), i);
+	}
+
+	m_programOffsets.assign(entryCount + 1, 0);
+	m_code.clear();
+	m_conditionCount = 0;
+	m_partialCount = 0;
+	m_failedCount = 0;
+
+	// (variable, entry) for every read, turned into postings below
+	hrt::vector<std::pair<uint32, uint32>> reads;
+	hrt::vector<uint32> entryReads;
+
+	for (uint32 entry = 0; entry < entryCount; ++entry)
+	{
+		m_programOffsets[entry] = uint32(m_code.size());
+
+		entryReads.clear();
+		CompileStatus status = CompileCondition(entries[entry].conditionsString.CStr(pool), m_variableLookup, m_code, entryReads);
+
+		if (m_code.size() != m_programOffsets[entry])
+			++m_conditionCount;
+
+		if (status == CompileStatus::Partial)
+			++m_partialCount;
+		else if (status == CompileStatus::Failed)
+			++m_failedCount;
+
+		std::sort(entryReads.begin(), entryReads.end());
+		entryReads.erase(std::unique(entryReads.begin(), entryReads.end()), entryReads.end());
+		for (uint32 variable : entryReads)
+		{
+			reads.emplace_back(variable, entry);
+		}
+	}
+
+	m_programOffsets[entryCount] = uint32(m_code.size());
+
+	// Entries were visited in order, so a stable counting sort keeps each posting list sorted
+	m_dependentOffsets.assign(variableCount + 1, 0);
+	for (const auto& read : reads)
+	{
+		++m_dependentOffsets[read.first + 1];
+	}
+
+	for (uint32 i = 0; i < variableCount; ++i)
+	{
+		m_dependentOffsets[i + 1] += m_dependentOffsets[i];
+	}
+
+	hrt::vector<uint32> cursor(m_dependentOffsets.begin(), m_dependentOffsets.end() - 1);
+	m_dependents.resize(reads.size());
+	for (const auto& read : reads)
+	{
+		m_dependents[cursor[read.first]++] = read.second;
+	}
+
+	return m_conditionCount;
+}
+
+uint32 ConditionTable::FindVariable(std::string_view name) const
+{
+	auto iter = m_variableLookup.find(name);
+	return iter == m_variableLookup.end() ? UINT32_MAX : iter->second;
+}
+
+hrt::string DisassembleCondition(std::span<const ConditionInstruction> program, const EntityVector<Variable>& variables, const ManagedStringPool& pool)
+{
+	hrt::string result;
+	for (const ConditionInstruction& instruction : program)
+	{
+		result.append(GetOpName(instruction.op));
+
+		if (instruction.op == ConditionOp::PushConstant)
+		{
+			result.push_back(' ');
+			result.append(std::to_string(instruction.operand).c_str());
+		}
+		else if (instruction.op == ConditionOp::PushVariable)
+		{
+			result.append(" \"");
+			result.append(variables[instruction.operand].name.CStr(pool));
+			result.push_back('"');
+		}
+
+		result.push_back('\n');
+	}
+
+	return result;
+}
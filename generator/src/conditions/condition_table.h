@@ -0,0 +1,96 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "conditions/condition_compiler.h"
+#include "memory/managed_string.h"
+#include "memory/memory_tracker.h"
+#include "types/dialogue_entry.h"
+#include "types/variable.h"
+
+#include <heart/types.h>
+
+#include <heart/stl/string.h>
+#include <heart/stl/unordered_map.h>
+#include <heart/stl/vector.h>
+
+#include <span>
+#include <string_view>
+
+// Every dialog entry's conditionsString compiled to bytecode, and the reverse: for each
+// variable, the entries whose conditions read it. Both are stored as CSR, indexed by the
+// dense entry and variable indices.
+class ConditionTable
+{
+	hrt::vector<uint32> m_programOffsets;
+	hrt::vector<ConditionInstruction> m_code;
+
+	hrt::vector<uint32> m_dependentOffsets;
+	hrt::vector<uint32> m_dependents;
+
+	// Views into the pool's variable names
+	hrt::unordered_map<std::string_view, uint32> m_variableLookup;
+
+	uint32 m_conditionCount = 0;
+	uint32 m_partialCount = 0;
+	uint32 m_failedCount = 0;
+
+public:
+	// The pool must be finalized and outlive the table. Returns the entries with a condition.
+	uint32 Compile(const EntityVector<DialogEntry>& entries, const EntityVector<Variable>& variables, const ManagedStringPool& pool);
+
+	// Empty if the entry has no condition
+	std::span<const ConditionInstruction> GetProgram(uint32 entry) const
+	{
+		return std::span<const ConditionInstruction>(m_code.data() + m_programOffsets[entry], m_code.data() + m_programOffsets[entry + 1]);
+	}
+
+	// Every entry whose condition reads the variable, in entry order
+	std::span<const uint32> GetDependents(uint32 variable) const
+	{
+		return std::span<const uint32>(m_dependents.data() + m_dependentOffsets[variable], m_dependents.data() + m_dependentOffsets[variable + 1]);
+	}
+
+	// Variable index for a name, or UINT32_MAX
+	uint32 FindVariable(std::string_view name) const;
+
+	uint32 GetEntryCount() const
+	{
+		return m_programOffsets.empty() ? 0 : uint32(m_programOffsets.size() - 1);
+	}
+
+	uint32 GetVariableCount() const
+	{
+		return m_dependentOffsets.empty() ? 0 : uint32(m_dependentOffsets.size() - 1);
+	}
+
+	uint32 GetInstructionCount() const
+	{
+		return uint32(m_code.size());
+	}
+
+	uint32 GetConditionCount() const
+	{
+		return m_conditionCount;
+	}
+
+	uint32 GetPartialCount() const
+	{
+		return m_partialCount;
+	}
+
+	uint32 GetFailedCount() const
+	{
+		return m_failedCount;
+	}
+};
+
+// Human readable listing of a program, one instruction per line
+hrt::string DisassembleCondition(std::span<const ConditionInstruction> program, const EntityVector<Variable>& variables, const ManagedStringPool& pool);
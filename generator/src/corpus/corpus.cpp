@@ -0,0 +1,404 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "corpus/corpus.h"
+
+#include "json/rapidjson_wrapper.h"
+#include "memory/memory_tracker.h"
+#include "memory/monotonic_arena.h"
+#include "profiling/profiler.h"
+#include "threading/thread_pool.h"
+
+#include <heart/debug/assert.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <ostream>
+
+namespace
+{
+	template <typename T>
+	void InitializeLookback(T& target, ManagedStringPool& pool, size_t index)
+	{
+		for (ManagedString* str : target.GetStrings())
+		{
+			str->InitializeLookback(pool, T::Type, index);
+		}
+	}
+
+	void ReportMemory(std::ostream* log, const char* phase)
+	{
+		if (log && IsMemoryReportEnabled())
+			PrintMemoryReport(*log, phase);
+	}
+
+	// Writes the time between construction and destruction into one of the timings
+	class StageTimer
+	{
+		double& m_target;
+		std::chrono::steady_clock::time_point m_start = std::chrono::steady_clock::now();
+
+	public:
+		explicit StageTimer(double& target) :
+			m_target(target)
+		{
+		}
+
+		~StageTimer()
+		{
+			m_target = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+		}
+	};
+
+	template <typename T>
+	void RebaseStrings(EntityVector<T>& entities, uint32 first, uint32 count, uint32 offset)
+	{
+		for (uint32 i = first; i < first + count; ++i)
+		{
+			for (ManagedString* str : entities[i].GetStrings())
+			{
+				str->Rebase(offset);
+			}
+		}
+	}
+
+	// Conversations smaller than this are parsed in the same batch as their neighbours
+	constexpr uint32 MinBatchEntries = 1024;
+
+	// A run of whole conversations parsed into a part of the pool of their own
+	struct ParseBatch
+	{
+		std::unique_ptr<ManagedStringPool> strings = std::make_unique<ManagedStringPool>();
+		HashLookup::PartPostings postings;
+		hrt::vector<DialogueGraph::PendingLink> links;
+
+		uint32 firstConversation = 0;
+		uint32 conversationCount = 0;
+		uint32 firstEntry = 0;
+		uint32 entryCount = 0;
+	};
+
+	// Runs a on a worker while b runs here, or both here without a pool
+	template <typename A, typename B>
+	void RunSideBySide(ThreadPool* threads, A&& a, B&& b)
+	{
+		if (!threads)
+		{
+			a();
+			b();
+			return;
+		}
+
+		ThreadPool::TaskGroup group(*threads);
+		group.Run(a);
+		b();
+		group.Wait();
+	}
+}
+
+bool LoadCorpus(const char* path, Corpus& outCorpus, std::ostream* log, CorpusLoadTimings* outTimings, ThreadPool* threads)
+{
+	auto& pool = outCorpus.pool;
+	auto& actors = outCorpus.actors;
+	auto& variables = outCorpus.variables;
+	auto& conversations = outCorpus.conversations;
+	auto& dialogEntries = outCorpus.dialogEntries;
+
+	// The DOM is dropped in one go once the entries are parsed out of it
+	MonotonicArena jsonArena(MemoryTag::JsonDocument);
+	ArenaJsonAllocator jsonAllocator(jsonArena);
+	JsonDocument doc(&jsonAllocator);
+	hrt::vector<DialogueGraph::PendingLink> pendingLinks;
+	CorpusLoadTimings timings;
+	auto loadStart = std::chrono::steady_clock::now();
+	PROFILE_SCOPE("LoadCorpus");
+
+	if (log)
+		*log << "Reading json... " << std::flush;
+	{
+		StageTimer timer(timings.readMs);
+		doc = ParseDocumentAsStream(path, jsonAllocator);
+	}
+	if (!doc.IsObject())
+		return false;
+	if (log)
+		*log << "Done in " << timings.readMs << "ms!" << std::endl;
+	ReportMemory(log, "reading json");
+
+	if (log)
+		*log << "Parsing and tokenizing entries... " << std::flush;
+
+	// Whole conversations are parsed in batches, each into its own part of the pool so they
+	// can all run at once, and each batch is tokenized for the index as soon as it's done.
+	// The first batch also takes the actors and variables.
+	hrt::vector<ParseBatch> batches;
+	{
+		PROFILE_SCOPE("Parse entries");
+		StageTimer timer(timings.parseMs);
+
+		auto rootObj = doc.GetObject();
+		auto actorsIter = rootObj.FindMember("actors");
+		auto variablesIter = rootObj.FindMember("variables");
+		auto conversationsIter = rootObj.FindMember("conversations");
+
+		bool hasActors = actorsIter != rootObj.MemberEnd() && actorsIter->value.IsArray();
+		bool hasVariables = variablesIter != rootObj.MemberEnd() && variablesIter->value.IsArray();
+		bool hasConversations = conversationsIter != rootObj.MemberEnd() && conversationsIter->value.IsArray();
+
+		// Every conversation's entries are counted first, so each batch knows where its
+		// conversations and entries go before any of them are parsed
+		hrt::vector<uint32> entryCounts;
+		if (hasConversations)
+		{
+			for (auto& conversationJson : conversationsIter->value.GetArray())
+			{
+				auto dialogIter = conversationJson.FindMember("dialogueEntries");
+				bool hasEntries = dialogIter != conversationJson.MemberEnd() && dialogIter->value.IsArray();
+				entryCounts.push_back(hasEntries ? uint32(dialogIter->value.Size()) : 0);
+			}
+		}
+
+		uint32 totalEntries = 0;
+		for (uint32 count : entryCounts)
+		{
+			totalEntries += count;
+		}
+
+		// A few batches per worker so uneven conversations still balance, one without workers
+		uint32 batchEntries = UINT32_MAX;
+		if (threads)
+			batchEntries = std::max(totalEntries / (threads->GetThreadCount() * 4), MinBatchEntries);
+
+		batches.emplace_back();
+		for (uint32 i = 0; i < uint32(entryCounts.size()); ++i)
+		{
+			if (batches.back().entryCount >= batchEntries)
+			{
+				ParseBatch& previous = batches.back();
+				ParseBatch& next = batches.emplace_back();
+				next.firstConversation = previous.firstConversation + previous.conversationCount;
+				next.firstEntry = previous.firstEntry + previous.entryCount;
+			}
+
+			++batches.back().conversationCount;
+			batches.back().entryCount += entryCounts[i];
+		}
+
+		conversations.resize(entryCounts.size());
+		dialogEntries.resize(totalEntries);
+
+		auto parseBatch = [&](uint32 batchIndex) {
+			ParseBatch& batch = batches[batchIndex];
+			ManagedStringPool& strings = *batch.strings;
+
+			if (batchIndex == 0 && hasActors)
+			{
+				for (auto& entry : actorsIter->value.GetArray())
+				{
+					actors.push_back(ParseActor(entry.GetObject(), strings));
+					InitializeLookback(actors.back(), strings, actors.size() - 1);
+				}
+			}
+
+			if (batchIndex == 0 && hasVariables)
+			{
+				for (auto& entry : variablesIter->value.GetArray())
+				{
+					variables.push_back(ParseVariable(entry.GetObject(), strings));
+					InitializeLookback(variables.back(), strings, variables.size() - 1);
+				}
+			}
+
+			auto conversationsArray = conversationsIter->value.GetArray();
+			uint32 entryIndex = batch.firstEntry;
+			for (uint32 i = batch.firstConversation; i < batch.firstConversation + batch.conversationCount; ++i)
+			{
+				auto& conversationJson = conversationsArray[i];
+
+				Conversation& conversation = conversations[i];
+				conversation = ParseConversation(conversationJson, strings);
+				InitializeLookback(conversation, strings, i);
+
+				// Entries are laid out conversation by conversation, so each one's are contiguous
+				conversation.firstDialogEntry = entryIndex;
+				conversation.dialogEntryCount = entryCounts[i];
+				if (entryCounts[i] == 0)
+					continue;
+
+				for (auto& dialogJson : conversationJson.FindMember("dialogueEntries")->value.GetArray())
+				{
+					DialogEntry& dialogEntry = dialogEntries[entryIndex];
+					dialogEntry = ParseDialogEntry(dialogJson, strings);
+					InitializeLookback(dialogEntry, strings, entryIndex);
+
+					auto linksIter = dialogJson.FindMember("outgoingLinks");
+					if (linksIter != dialogJson.MemberEnd() && linksIter->value.IsArray())
+					{
+						for (auto& linkJson : linksIter->value.GetArray())
+						{
+							batch.links.push_back(DialogueGraph::PendingLink {entryIndex, ParseDialogLink(linkJson)});
+						}
+					}
+
+					++entryIndex;
+				}
+			}
+
+			HEART_ASSERT(entryIndex == batch.firstEntry + batch.entryCount);
+			HashLookup::TokenizePart(strings, batch.postings);
+		};
+
+		if (threads)
+		{
+			threads->ParallelFor(uint32(batches.size()), parseBatch);
+		}
+		else
+		{
+			for (uint32 i = 0; i < uint32(batches.size()); ++i)
+			{
+				parseBatch(i);
+			}
+		}
+
+		// Batches are in entry order, so this is the order parsing one by one gives
+		for (ParseBatch& batch : batches)
+		{
+			pendingLinks.insert(pendingLinks.end(), batch.links.begin(), batch.links.end());
+			batch.links = {};
+		}
+
+		doc = {};
+		jsonArena.Release();
+	}
+	if (log)
+		*log << "Done in " << timings.parseMs << "ms! Found " << actors.size() << " actors, " << conversations.size() << " conversations and " << dialogEntries.size() << " dialog nodes." << std::endl;
+	ReportMemory(log, "parsing entries");
+
+	// Ids, columns and the graph only need the entities, while the conditions and the text
+	// indexes only need the finalized pool, so the two chains run side by side
+	uint32 duplicateCount = 0;
+	uint32 stringCount = 0;
+	uint32 conditionCount = 0;
+	uint32 hashCount = 0;
+	uint32 bucketCount = 0;
+	uint32 termCount = 0;
+
+	if (log)
+		*log << "Indexing ids, building dialogue graph, compiling conditions and text indexes... " << std::flush;
+
+	auto buildEntityIndexes = [&]() {
+		{
+			StageTimer timer(timings.indexIdsMs);
+			duplicateCount = outCorpus.ids.Build(actors, conversations, dialogEntries);
+			outCorpus.entryTable.Build(dialogEntries, conversations);
+			outCorpus.facets.Build(outCorpus.entryTable);
+		}
+
+		StageTimer timer(timings.graphMs);
+		outCorpus.graph.Build(dialogEntries, outCorpus.ids.GetDialogEntryMap(), pendingLinks);
+		pendingLinks = {};
+	};
+
+	auto buildStringIndexes = [&]() {
+		hrt::vector<uint32> offsets;
+		{
+			StageTimer timer(timings.finalizePoolMs);
+
+			hrt::vector<ManagedStringPool*> parts;
+			for (ParseBatch& batch : batches)
+			{
+				parts.push_back(batch.strings.get());
+			}
+
+			stringCount = pool.FinalizeFromParts(parts, offsets, threads);
+
+			// Moves every handle to where its batch's strings ended up. Only the strings are
+			// written, which the entity chain running alongside never reads.
+			auto rebaseBatch = [&](uint32 batchIndex) {
+				const ParseBatch& batch = batches[batchIndex];
+				if (batchIndex == 0)
+				{
+					RebaseStrings(actors, 0, uint32(actors.size()), offsets[0]);
+					RebaseStrings(variables, 0, uint32(variables.size()), offsets[0]);
+				}
+
+				RebaseStrings(conversations, batch.firstConversation, batch.conversationCount, offsets[batchIndex]);
+				RebaseStrings(dialogEntries, batch.firstEntry, batch.entryCount, offsets[batchIndex]);
+			};
+
+			if (threads)
+			{
+				threads->ParallelFor(uint32(batches.size()), rebaseBatch);
+			}
+			else
+			{
+				for (uint32 i = 0; i < uint32(batches.size()); ++i)
+				{
+					rebaseBatch(i);
+				}
+			}
+		}
+
+		// Everything from here on only reads the pool
+		auto compileConditions = [&]() {
+			StageTimer timer(timings.conditionsMs);
+			conditionCount = outCorpus.conditions.Compile(dialogEntries, variables, pool);
+		};
+
+		auto compileIndex = [&]() {
+			StageTimer timer(timings.indexMs);
+
+			hrt::vector<HashLookup::PartPostings> postings;
+			for (ParseBatch& batch : batches)
+			{
+				postings.push_back(std::move(batch.postings));
+			}
+
+			hashCount = outCorpus.index.CompileParts(pool, postings, offsets, threads);
+		};
+
+		auto buildDuplicates = [&]() {
+			StageTimer timer(timings.duplicatesMs);
+			bucketCount = outCorpus.duplicates.Build(dialogEntries, pool, threads);
+		};
+
+		auto buildSimilarity = [&]() {
+			StageTimer timer(timings.similarityMs);
+			termCount = outCorpus.similarity.Build(dialogEntries, pool, threads);
+		};
+
+		auto buildTextIndexes = [&]() { RunSideBySide(threads, buildDuplicates, buildSimilarity); };
+		RunSideBySide(threads, compileConditions, [&]() { RunSideBySide(threads, compileIndex, buildTextIndexes); });
+	};
+
+	RunSideBySide(threads, buildEntityIndexes, buildStringIndexes);
+
+	if (log)
+	{
+		*log << "Done!" << std::endl;
+		*log << "  Indexed ids in " << timings.indexIdsMs << "ms, " << duplicateCount << " duplicate ids." << std::endl;
+		*log << "  Built dialogue graph in " << timings.graphMs << "ms, " << outCorpus.graph.GetEdgeCount() << " links (" << outCorpus.graph.GetCrossConversationCount() << " across conversations, " << outCorpus.graph.GetUnresolvedCount() << " unresolved)." << std::endl;
+		*log << "  Finalized string pool in " << timings.finalizePoolMs << "ms, " << stringCount << " strings pooled." << std::endl;
+		*log << "  Compiled conditions in " << timings.conditionsMs << "ms, " << conditionCount << " conditions in " << outCorpus.conditions.GetInstructionCount() << " instructions (" << outCorpus.conditions.GetPartialCount() << " partly unknown, " << outCorpus.conditions.GetFailedCount() << " unparsed)." << std::endl;
+		*log << "  Compiled index in " << timings.indexMs << "ms, " << hashCount << " words indexed." << std::endl;
+		*log << "  Signed entries for near-duplicates in " << timings.duplicatesMs << "ms, " << bucketCount << " shared buckets." << std::endl;
+		*log << "  Built similarity vectors in " << timings.similarityMs << "ms, " << termCount << " distinct words." << std::endl;
+	}
+	ReportMemory(log, "indexing and compiling");
+
+	timings.totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+	if (log)
+		*log << "Loaded in " << timings.totalMs << "ms." << std::endl;
+
+	if (outTimings)
+		*outTimings = timings;
+
+	return true;
+}
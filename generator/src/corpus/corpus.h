@@ -0,0 +1,102 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "columns/dialog_entry_table.h"
+#include "conditions/condition_table.h"
+#include "corpus/entity_ids.h"
+#include "graph/dialogue_graph.h"
+#include "memory/hash_lookup.h"
+#include "memory/managed_string.h"
+#include "memory/memory_tracker.h"
+#include "query/facet_index.h"
+#include "query/near_duplicate_index.h"
+#include "query/similarity_index.h"
+#include "types/actor.h"
+#include "types/conversation.h"
+#include "types/dialogue_entry.h"
+#include "types/variable.h"
+
+#include <heart/copy_move_semantics.h>
+#include <heart/types.h>
+
+#include <heart/stl/string.h>
+#include <heart/stl/vector.h>
+
+#include <iosfwd>
+
+// Everything loaded from one dump: the string pool, the entities whose strings live in
+// it, the links between dialog entries, their compiled conditions and the indexes over
+// the strings. Immutable once LoadCorpus returns.
+struct Corpus
+{
+	hrt::string name;
+
+	uint64 generation = 0;
+
+	ManagedStringPool pool;
+
+	EntityVector<Actor> actors;
+	EntityVector<Variable> variables;
+	EntityVector<Conversation> conversations;
+	EntityVector<DialogEntry> dialogEntries;
+
+	// The entries' scalar fields stored by column, for filter scans
+	DialogEntryTable entryTable;
+
+	// Bitmaps of entries by actor, conversant, conversation and flags
+	FacetIndex facets;
+
+	EntityIds ids;
+
+	DialogueGraph graph;
+
+	ConditionTable conditions;
+
+	HashLookup index;
+
+	// MinHash signatures of every entry's text, for finding recycled and reworded lines
+	NearDuplicateIndex duplicates;
+
+	// TF-IDF vectors of the same texts, for "more like this"
+	SimilarityIndex similarity;
+
+	Corpus() = default;
+	DISABLE_COPY_AND_MOVE_SEMANTICS(Corpus);
+};
+
+// Milliseconds spent in each phase of LoadCorpus. Phases overlap when loading on a thread
+// pool, so they can add up to more than the total.
+struct CorpusLoadTimings
+{
+	double readMs = 0.0;
+	double parseMs = 0.0;
+	double indexIdsMs = 0.0;
+	double graphMs = 0.0;
+	double finalizePoolMs = 0.0;
+	double conditionsMs = 0.0;
+	double indexMs = 0.0;
+	double duplicatesMs = 0.0;
+	double similarityMs = 0.0;
+	double totalMs = 0.0;
+};
+
+class ThreadPool;
+
+// Reads, parses, pools and indexes the dump at path into an empty corpus, reporting
+// progress to log and phase timings to outTimings if they're not null. Only touches
+// outCorpus, so corpora can load while others are loading or being read.
+//
+// The file is always read on its own thread while it's parsed. Given a thread pool, the
+// conversations are pulled out of the parsed file in batches on the workers, each batch
+// tokenized for the text index as soon as it's done, so parseMs covers tokenizing and
+// indexMs only the merge. The rest runs as two chains side by side (ids, columns and
+// graph; pool, conditions and the text indexes). Safe to call from a job.
+bool LoadCorpus(const char* path, Corpus& outCorpus, std::ostream* log, CorpusLoadTimings* outTimings = nullptr, ThreadPool* threads = nullptr);
@@ -0,0 +1,85 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "corpus/corpus_set.h"
+
+#include "threading/thread_pool.h"
+
+#include <heart/debug/assert.h>
+
+#include <atomic>
+#include <ostream>
+
+bool CorpusSet::LoadAll(const hrt::vector<const char*>& paths, ThreadPool& threads, std::ostream* log)
+{
+	size_t firstNew = m_corpora.size();
+	for (const char* path : paths)
+	{
+		auto& corpus = m_corpora.emplace_back(std::make_unique<Corpus>());
+		corpus->name = path;
+	}
+
+	std::ostream* perCorpusLog = paths.size() == 1 ? log : nullptr;
+	std::atomic<bool> allLoaded = true;
+
+	threads.ParallelFor(uint32(paths.size()), [&](uint32 i) {
+		if (!LoadCorpus(paths[i], *m_corpora[firstNew + i], perCorpusLog, nullptr, &threads))
+			allLoaded = false;
+	});
+
+	if (log && !perCorpusLog)
+	{
+		for (size_t i = firstNew; i < m_corpora.size(); ++i)
+		{
+			const Corpus& corpus = *m_corpora[i];
+			*log << "Loaded " << corpus.name << ": " << corpus.actors.size() << " actors, " << corpus.conversations.size() << " conversations and " << corpus.dialogEntries.size() << " dialog nodes." << std::endl;
+		}
+	}
+
+	return allLoaded;
+}
+
+void CorpusSet::Add(std::unique_ptr<Corpus> corpus)
+{
+	HEART_ASSERT(corpus != nullptr);
+	m_corpora.push_back(std::move(corpus));
+}
+
+std::unique_ptr<Corpus> CorpusSet::Release(uint32 index)
+{
+	return std::move(m_corpora[index]);
+}
+
+hrt::vector<FederatedMatch> CorpusSet::Lookup(const char* query, ThreadPool& threads, LookupOptions options) const
+{
+	hrt::vector<hrt::vector<ManagedString>> perCorpus(m_corpora.size());
+
+	threads.ParallelFor(uint32(m_corpora.size()), [&](uint32 i) {
+		if (m_corpora[i])
+			perCorpus[i] = m_corpora[i]->index.LookupWord(query, options);
+	});
+
+	size_t total = 0;
+	for (auto& matches : perCorpus)
+	{
+		total += matches.size();
+	}
+
+	hrt::vector<FederatedMatch> result;
+	result.reserve(total);
+	for (uint32 i = 0; i < uint32(perCorpus.size()); ++i)
+	{
+		for (ManagedString& match : perCorpus[i])
+		{
+			result.push_back(FederatedMatch {i, match});
+		}
+	}
+
+	return result;
+}
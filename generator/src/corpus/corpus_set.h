@@ -0,0 +1,64 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "corpus/corpus.h"
+
+#include <heart/types.h>
+
+#include <heart/stl/vector.h>
+
+#include <iosfwd>
+#include <memory>
+
+class ThreadPool;
+
+struct FederatedMatch
+{
+	uint32 corpusIndex = 0;
+	ManagedString match;
+};
+
+// Several independently loaded corpora searched together, e.g. the base game alongside
+// a DLC, or the same dump in several languages. Each one owns its own pool, so they load
+// and answer queries in parallel without sharing anything.
+class CorpusSet
+{
+	hrt::vector<std::unique_ptr<Corpus>> m_corpora;
+
+public:
+	// Loads every dump concurrently. Progress goes to log when there's only one of them,
+	// otherwise just a line per corpus once they're all done.
+	bool LoadAll(const hrt::vector<const char*>& paths, ThreadPool& threads, std::ostream* log);
+
+	void Add(std::unique_ptr<Corpus> corpus);
+
+	// Hands ownership of one corpus to the caller, leaving an empty slot behind
+	std::unique_ptr<Corpus> Release(uint32 index);
+
+	uint32 GetCount() const
+	{
+		return uint32(m_corpora.size());
+	}
+
+	Corpus& Get(uint32 index)
+	{
+		return *m_corpora[index];
+	}
+
+	const Corpus& Get(uint32 index) const
+	{
+		return *m_corpora[index];
+	}
+
+	// Runs the query against every corpus in parallel and merges the results, in corpus
+	// order and then in pool order within each corpus.
+	hrt::vector<FederatedMatch> Lookup(const char* query, ThreadPool& threads, LookupOptions options = {}) const;
+};
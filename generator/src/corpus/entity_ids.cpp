@@ -0,0 +1,79 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "corpus/entity_ids.h"
+
+#include "profiling/profiler.h"
+
+#include <heart/debug/assert.h>
+
+namespace
+{
+	constexpr uint32 RefTypeShift = 28;
+	constexpr uint32 RefIndexMask = (1u << RefTypeShift) - 1;
+
+	uint32 PackRef(ObjectType type, uint32 index)
+	{
+		HEART_ASSERT(index <= RefIndexMask);
+		return (uint32(type) << RefTypeShift) | index;
+	}
+}
+
+uint32 EntityIds::Build(const EntityVector<Actor>& actors, const EntityVector<Conversation>& conversations, const EntityVector<DialogEntry>& entries)
+{
+	PROFILE_SCOPE("EntityIds::Build");
+
+	m_duplicateCount = 0;
+
+	m_actors.Reserve(uint32(actors.size()));
+	m_conversations.Reserve(uint32(conversations.size()));
+	m_dialogEntries.Reserve(uint32(entries.size()));
+	m_articyIds.Reserve(uint32(actors.size() + conversations.size() + entries.size()));
+
+	auto addArticyId = [this](uint64 articyId, ObjectType type, uint32 index) {
+		// Zero means the dump didn't have one
+		if (articyId != 0 && !m_articyIds.Insert(articyId, PackRef(type, index)))
+			++m_duplicateCount;
+	};
+
+	for (uint32 i = 0; i < actors.size(); ++i)
+	{
+		if (!m_actors.Insert(actors[i].id, i))
+			++m_duplicateCount;
+
+		addArticyId(actors[i].articyId, ObjectType::Actor, i);
+	}
+
+	for (uint32 i = 0; i < conversations.size(); ++i)
+	{
+		if (!m_conversations.Insert(conversations[i].id, i))
+			++m_duplicateCount;
+
+		addArticyId(conversations[i].articyId, ObjectType::Conversation, i);
+	}
+
+	for (uint32 i = 0; i < entries.size(); ++i)
+	{
+		if (!m_dialogEntries.Insert(MakeDialogEntryKey(entries[i].conversationId, entries[i].id), i))
+			++m_duplicateCount;
+
+		addArticyId(entries[i].articyId, ObjectType::DialogEntry, i);
+	}
+
+	return m_duplicateCount;
+}
+
+EntityRef EntityIds::FindArticyId(uint64 articyId) const
+{
+	uint32 packed = m_articyIds.Find(articyId);
+	if (packed == FlatIdMap<uint64>::NotFound)
+		return EntityRef {};
+
+	return EntityRef {ObjectType(packed >> RefTypeShift), packed & RefIndexMask};
+}
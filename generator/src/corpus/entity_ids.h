@@ -0,0 +1,75 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "memory/flat_id_map.h"
+#include "memory/memory_tracker.h"
+#include "types/actor.h"
+#include "types/conversation.h"
+#include "types/dialogue_entry.h"
+#include "types/object_type.h"
+
+#include <heart/types.h>
+
+#include <heart/stl/vector.h>
+
+struct EntityRef
+{
+	ObjectType type = ObjectType::Unknown;
+	uint32 index = 0;
+};
+
+// The ids the dump uses to refer to things, resolved to indices into the corpus' arrays.
+// Built once after parsing; every lookup is a single probe into a flat table.
+class EntityIds
+{
+	FlatIdMap<uint32> m_actors;
+	FlatIdMap<int32> m_conversations;
+	FlatIdMap<uint64> m_dialogEntries;
+
+	// Values carry the ObjectType in their top bits, see PackRef
+	FlatIdMap<uint64> m_articyIds;
+
+	uint32 m_duplicateCount = 0;
+
+public:
+	// Returns how many ids were seen more than once. Only the first one is kept.
+	uint32 Build(const EntityVector<Actor>& actors, const EntityVector<Conversation>& conversations, const EntityVector<DialogEntry>& entries);
+
+	// All of these return UINT32_MAX if nothing has the id
+	uint32 FindActor(int32 actorId) const
+	{
+		return m_actors.Find(uint32(actorId));
+	}
+
+	uint32 FindConversation(int32 conversationId) const
+	{
+		return m_conversations.Find(conversationId);
+	}
+
+	uint32 FindDialogEntry(int32 conversationId, int32 entryId) const
+	{
+		return m_dialogEntries.Find(MakeDialogEntryKey(conversationId, entryId));
+	}
+
+	// Type is Unknown if nothing has the id
+	EntityRef FindArticyId(uint64 articyId) const;
+
+	// Keyed by MakeDialogEntryKey
+	const FlatIdMap<uint64>& GetDialogEntryMap() const
+	{
+		return m_dialogEntries;
+	}
+
+	uint32 GetDuplicateCount() const
+	{
+		return m_duplicateCount;
+	}
+};
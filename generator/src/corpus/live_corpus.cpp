@@ -0,0 +1,160 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "corpus/live_corpus.h"
+
+#include <heart/debug/assert.h>
+
+#include <chrono>
+
+LiveCorpus::ReadGuard::ReadGuard(std::atomic<uint64>& slotEpoch, Corpus& corpus) :
+	m_slotEpoch(slotEpoch),
+	m_corpus(corpus)
+{
+}
+
+LiveCorpus::ReadGuard::~ReadGuard()
+{
+	m_slotEpoch.store(IdleEpoch, std::memory_order_release);
+}
+
+LiveCorpus::Reader::Reader(LiveCorpus& owner) :
+	m_owner(owner),
+	m_slot(MaxReaders)
+{
+	for (uint32 i = 0; i < MaxReaders; ++i)
+	{
+		bool expected = false;
+		if (m_owner.m_readers[i].claimed.compare_exchange_strong(expected, true))
+		{
+			m_slot = i;
+			break;
+		}
+	}
+
+	// More concurrent readers than slots
+	HEART_ASSERT(m_slot < MaxReaders);
+}
+
+LiveCorpus::Reader::~Reader()
+{
+	if (m_slot < MaxReaders)
+		m_owner.m_readers[m_slot].claimed = false;
+}
+
+LiveCorpus::ReadGuard LiveCorpus::Reader::Read()
+{
+	ReaderSlot& slot = m_owner.m_readers[m_slot];
+	// Read guards from one reader can't overlap
+	HEART_ASSERT(slot.epoch == IdleEpoch);
+
+	// Announce the epoch first, then pick up the generation. Anything published after the
+	// epoch we saw is retired with a later epoch, so our generation can't be freed under us.
+	slot.epoch.store(m_owner.m_epoch.load());
+	Corpus* corpus = m_owner.m_current.load();
+	HEART_ASSERT(corpus != nullptr);
+
+	return ReadGuard(slot.epoch, *corpus);
+}
+
+LiveCorpus::~LiveCorpus()
+{
+	m_shuttingDown = true;
+	if (m_reloadThread.joinable())
+		m_reloadThread.join();
+
+	for (RetiredCorpus& retired : m_retired)
+	{
+		delete retired.corpus;
+	}
+
+	delete m_current.exchange(nullptr);
+}
+
+void LiveCorpus::Publish(std::unique_ptr<Corpus> corpus)
+{
+	HEART_ASSERT(corpus != nullptr);
+
+	std::lock_guard lock(m_writerMutex);
+
+	corpus->generation = m_nextGeneration++;
+	m_currentGeneration = corpus->generation;
+
+	Corpus* previous = m_current.exchange(corpus.release());
+	uint64 retireEpoch = m_epoch.fetch_add(1) + 1;
+
+	if (previous)
+		m_retired.push_back(RetiredCorpus {previous, retireEpoch});
+
+	ReclaimLocked();
+}
+
+uint32 LiveCorpus::Reclaim()
+{
+	std::lock_guard lock(m_writerMutex);
+	return ReclaimLocked();
+}
+
+uint32 LiveCorpus::ReclaimLocked()
+{
+	if (m_retired.empty())
+		return 0;
+
+	uint64 oldestActive = UINT64_MAX;
+	for (ReaderSlot& slot : m_readers)
+	{
+		uint64 epoch = slot.epoch.load();
+		if (epoch != IdleEpoch && epoch < oldestActive)
+			oldestActive = epoch;
+	}
+
+	for (size_t i = 0; i < m_retired.size();)
+	{
+		// Readers that announced an epoch at or after the retirement saw its replacement
+		if (oldestActive >= m_retired[i].retireEpoch)
+		{
+			delete m_retired[i].corpus;
+			m_retired[i] = m_retired.back();
+			m_retired.pop_back();
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	return uint32(m_retired.size());
+}
+
+bool LiveCorpus::BeginReload(const hrt::string& path)
+{
+	if (m_reloadInProgress.exchange(true))
+		return false;
+
+	// The previous reload has finished (it cleared the flag), so this won't block
+	if (m_reloadThread.joinable())
+		m_reloadThread.join();
+
+	m_reloadThread = std::thread([this, path]() {
+		auto corpus = std::make_unique<Corpus>();
+		if (LoadCorpus(path.c_str(), *corpus, nullptr))
+		{
+			Publish(std::move(corpus));
+
+			while (Reclaim() > 0 && !m_shuttingDown)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+
+		m_reloadInProgress = false;
+	});
+
+	return true;
+}
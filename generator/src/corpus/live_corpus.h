@@ -0,0 +1,134 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "corpus/corpus.h"
+
+#include <heart/copy_move_semantics.h>
+#include <heart/types.h>
+
+#include <heart/stl/string.h>
+#include <heart/stl/vector.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Serves one corpus generation at a time to any number of readers, and lets a new
+// generation replace it without stopping them.
+//
+// Publication is epoch based: a reader announces the global epoch in its own slot before
+// picking up the current generation, and clears it when done. Publishing swaps the pointer
+// and bumps the epoch, and the old generation is only freed once no slot still holds an
+// epoch from before the swap. Readers never take a lock or touch a shared refcount.
+class LiveCorpus
+{
+public:
+	static constexpr uint32 MaxReaders = 256;
+
+private:
+	static constexpr uint64 IdleEpoch = 0;
+
+	struct alignas(64) ReaderSlot
+	{
+		std::atomic<uint64> epoch = IdleEpoch;
+		std::atomic<bool> claimed = false;
+	};
+
+	struct RetiredCorpus
+	{
+		Corpus* corpus = nullptr;
+		uint64 retireEpoch = 0;
+	};
+
+	std::atomic<Corpus*> m_current = nullptr;
+	std::atomic<uint64> m_epoch = IdleEpoch + 1;
+	std::atomic<uint64> m_currentGeneration = 0;
+
+	ReaderSlot m_readers[MaxReaders];
+
+	// Writer side only, serializes publishing and reclamation
+	std::mutex m_writerMutex;
+	hrt::vector<RetiredCorpus> m_retired;
+	uint64 m_nextGeneration = 1;
+
+	std::thread m_reloadThread;
+	std::atomic<bool> m_reloadInProgress = false;
+	std::atomic<bool> m_shuttingDown = false;
+
+	uint32 ReclaimLocked();
+
+public:
+	// Holds the generation that was current when it was created until it goes out of scope
+	class ReadGuard
+	{
+		std::atomic<uint64>& m_slotEpoch;
+		Corpus& m_corpus;
+
+	public:
+		ReadGuard(std::atomic<uint64>& slotEpoch, Corpus& corpus);
+		DISABLE_COPY_AND_MOVE_SEMANTICS(ReadGuard);
+		~ReadGuard();
+
+		const Corpus& operator*() const
+		{
+			return m_corpus;
+		}
+
+		const Corpus* operator->() const
+		{
+			return &m_corpus;
+		}
+	};
+
+	// One per reading thread. Claims a slot for its lifetime; guards from the same reader
+	// must not overlap.
+	class Reader
+	{
+		LiveCorpus& m_owner;
+		uint32 m_slot;
+
+	public:
+		explicit Reader(LiveCorpus& owner);
+		DISABLE_COPY_AND_MOVE_SEMANTICS(Reader);
+		~Reader();
+
+		ReadGuard Read();
+	};
+
+	LiveCorpus() = default;
+	DISABLE_COPY_AND_MOVE_SEMANTICS(LiveCorpus);
+
+	// Every reader must be gone by now
+	~LiveCorpus();
+
+	// Makes corpus the current generation. The previous one is retired and freed once the
+	// readers still using it have finished.
+	void Publish(std::unique_ptr<Corpus> corpus);
+
+	// Frees every retired generation no reader can still see. Returns how many are left.
+	uint32 Reclaim();
+
+	// Loads the dump at path on a background thread and publishes it once it's ready,
+	// then waits for the old generation to drain. Returns false if a reload is already
+	// in progress.
+	bool BeginReload(const hrt::string& path);
+
+	bool IsReloading() const
+	{
+		return m_reloadInProgress;
+	}
+
+	uint64 GetCurrentGeneration() const
+	{
+		return m_currentGeneration;
+	}
+};
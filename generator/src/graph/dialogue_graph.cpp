@@ -0,0 +1,101 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "graph/dialogue_graph.h"
+
+#include "profiling/profiler.h"
+
+#include <heart/debug/assert.h>
+
+namespace
+{
+	// Turns per-entry counts into prefix offsets, counts[i] becomes the start of row i
+	void CountsToOffsets(hrt::vector<uint32>& counts)
+	{
+		uint32 running = 0;
+		for (uint32& value : counts)
+		{
+			uint32 count = value;
+			value = running;
+			running += count;
+		}
+	}
+}
+
+void DialogueGraph::Build(const EntityVector<DialogEntry>& entries, const FlatIdMap<uint64>& entryIds, const hrt::vector<PendingLink>& links)
+{
+	PROFILE_SCOPE("DialogueGraph::Build");
+
+	uint32 entryCount = uint32(entries.size());
+
+	struct ResolvedLink
+	{
+		uint32 origin;
+		DialogueEdge edge;
+	};
+
+	hrt::vector<ResolvedLink> resolved;
+	resolved.reserve(links.size());
+
+	m_crossConversationCount = 0;
+	m_unresolvedCount = 0;
+
+	for (const PendingLink& pending : links)
+	{
+		HEART_ASSERT(pending.origin < entryCount);
+
+		uint32 destination = entryIds.Find(MakeDialogEntryKey(pending.link.destinationConversationID, pending.link.destinationDialogueID));
+		if (destination == FlatIdMap<uint64>::NotFound)
+		{
+			++m_unresolvedCount;
+			continue;
+		}
+
+		ResolvedLink& link = resolved.emplace_back();
+		link.origin = pending.origin;
+		link.edge.entry = destination;
+		link.edge.priority = pending.link.priority;
+
+		if (pending.link.isConnector)
+			link.edge.flags |= DialogueEdge::Connector;
+
+		if (entries[destination].conversationId != entries[pending.origin].conversationId)
+		{
+			link.edge.flags |= DialogueEdge::CrossConversation;
+			++m_crossConversationCount;
+		}
+	}
+
+	// Counting sort into both directions. One extra slot holds the end of the last row.
+	m_outgoingOffsets.assign(entryCount + 1, 0);
+	m_incomingOffsets.assign(entryCount + 1, 0);
+	for (const ResolvedLink& link : resolved)
+	{
+		++m_outgoingOffsets[link.origin];
+		++m_incomingOffsets[link.edge.entry];
+	}
+
+	CountsToOffsets(m_outgoingOffsets);
+	CountsToOffsets(m_incomingOffsets);
+
+	m_outgoing.resize(resolved.size());
+	m_incoming.resize(resolved.size());
+
+	// Fill each row through its own cursor
+	hrt::vector<uint32> outgoingCursor(m_outgoingOffsets.begin(), m_outgoingOffsets.end() - 1);
+	hrt::vector<uint32> incomingCursor(m_incomingOffsets.begin(), m_incomingOffsets.end() - 1);
+	for (const ResolvedLink& link : resolved)
+	{
+		m_outgoing[outgoingCursor[link.origin]++] = link.edge;
+
+		DialogueEdge reverse = link.edge;
+		reverse.entry = link.origin;
+		m_incoming[incomingCursor[link.edge.entry]++] = reverse;
+	}
+}
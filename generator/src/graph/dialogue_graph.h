@@ -0,0 +1,96 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "memory/flat_id_map.h"
+#include "memory/memory_tracker.h"
+#include "types/dialogue_entry.h"
+#include "types/dialogue_link.h"
+
+#include <heart/types.h>
+
+#include <heart/stl/vector.h>
+
+#include <span>
+
+struct DialogueEdge
+{
+	enum Flags : uint8
+	{
+		CrossConversation = 1 << 0,
+		Connector = 1 << 1,
+	};
+
+	// Dense index into the corpus' dialog entries. The destination for outgoing edges,
+	// the origin for incoming ones.
+	uint32 entry = 0;
+
+	uint8 priority = 0;
+
+	uint8 flags = 0;
+};
+
+// Every link between dialog entries, stored as compressed sparse rows in both directions:
+// the edges leaving (or entering) entry i are edges[offsets[i] .. offsets[i + 1]).
+class DialogueGraph
+{
+public:
+	struct PendingLink
+	{
+		uint32 origin = 0;
+		DialogLink link;
+	};
+
+private:
+	hrt::vector<uint32> m_outgoingOffsets;
+	hrt::vector<DialogueEdge> m_outgoing;
+
+	hrt::vector<uint32> m_incomingOffsets;
+	hrt::vector<DialogueEdge> m_incoming;
+
+	uint32 m_crossConversationCount = 0;
+	uint32 m_unresolvedCount = 0;
+
+public:
+	// Resolves the links' (conversation, entry) ids to dense entry indices through
+	// entryIds (keyed by MakeDialogEntryKey) and builds both adjacency lists. Links to
+	// entries that don't exist are counted and dropped.
+	void Build(const EntityVector<DialogEntry>& entries, const FlatIdMap<uint64>& entryIds, const hrt::vector<PendingLink>& links);
+
+	std::span<const DialogueEdge> GetOutgoing(uint32 entry) const
+	{
+		return std::span<const DialogueEdge>(m_outgoing.data() + m_outgoingOffsets[entry], m_outgoing.data() + m_outgoingOffsets[entry + 1]);
+	}
+
+	std::span<const DialogueEdge> GetIncoming(uint32 entry) const
+	{
+		return std::span<const DialogueEdge>(m_incoming.data() + m_incomingOffsets[entry], m_incoming.data() + m_incomingOffsets[entry + 1]);
+	}
+
+	uint32 GetEntryCount() const
+	{
+		return m_outgoingOffsets.empty() ? 0 : uint32(m_outgoingOffsets.size() - 1);
+	}
+
+	uint32 GetEdgeCount() const
+	{
+		return uint32(m_outgoing.size());
+	}
+
+	uint32 GetCrossConversationCount() const
+	{
+		return m_crossConversationCount;
+	}
+
+	uint32 GetUnresolvedCount() const
+	{
+		return m_unresolvedCount;
+	}
+};
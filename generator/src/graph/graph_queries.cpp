@@ -0,0 +1,502 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "graph/graph_queries.h"
+
+#include "threading/thread_pool.h"
+
+#include <heart/debug/assert.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+	constexpr uint32 Unvisited = UINT32_MAX;
+
+	// Words of the component bitsets merged per job in FindUnreachableEntries
+	constexpr uint32 WordsPerJob = 256;
+}
+
+GraphQueries::GraphQueries(const DialogueGraph& graph, const EntityVector<Conversation>& conversations, const EntityVector<DialogEntry>& entries) :
+	m_graph(graph),
+	m_conversations(conversations),
+	m_entries(entries)
+{
+	HEART_ASSERT(graph.GetEntryCount() == entries.size());
+}
+
+void GraphQueries::Precompute(ThreadPool& threads)
+{
+	BuildRoots();
+	BuildComponents();
+	BuildCondensation();
+
+	uint32 conversationCount = uint32(m_conversations.size());
+	m_rootReachability.clear();
+	m_rootReachability.resize(conversationCount);
+
+	threads.ParallelFor(conversationCount, [this](uint32 conversation) {
+		DenseBitset& reached = m_rootReachability[conversation];
+		reached.Resize(m_componentCount);
+
+		hrt::vector<uint32> pending;
+		for (uint32 root : GetRoots(conversation))
+		{
+			uint32 component = m_componentOf[root];
+			if (!reached.Test(component))
+			{
+				reached.Set(component);
+				pending.push_back(component);
+			}
+		}
+
+		while (!pending.empty())
+		{
+			uint32 component = pending.back();
+			pending.pop_back();
+
+			for (uint32 i = m_componentOffsets[component]; i < m_componentOffsets[component + 1]; ++i)
+			{
+				uint32 next = m_componentEdges[i];
+				if (!reached.Test(next))
+				{
+					reached.Set(next);
+					pending.push_back(next);
+				}
+			}
+		}
+	});
+}
+
+void GraphQueries::BuildRoots()
+{
+	uint32 conversationCount = uint32(m_conversations.size());
+
+	m_conversationOf.assign(m_entries.size(), UINT32_MAX);
+	m_rootOffsets.assign(conversationCount + 1, 0);
+	m_roots.clear();
+
+	for (uint32 conversation = 0; conversation < conversationCount; ++conversation)
+	{
+		const Conversation& c = m_conversations[conversation];
+		m_rootOffsets[conversation] = uint32(m_roots.size());
+
+		for (uint32 entry = c.firstDialogEntry; entry < c.firstDialogEntry + c.dialogEntryCount; ++entry)
+		{
+			m_conversationOf[entry] = conversation;
+			if (m_entries[entry].isRoot)
+				m_roots.push_back(entry);
+		}
+
+		if (m_roots.size() == m_rootOffsets[conversation] && c.dialogEntryCount > 0)
+			m_roots.push_back(c.firstDialogEntry);
+	}
+
+	m_rootOffsets[conversationCount] = uint32(m_roots.size());
+}
+
+void GraphQueries::BuildComponents()
+{
+	// Tarjan's algorithm with an explicit stack, the chains get far too deep to recurse
+	struct Frame
+	{
+		uint32 entry;
+		uint32 edge;
+	};
+
+	uint32 entryCount = m_graph.GetEntryCount();
+
+	hrt::vector<uint32> order(entryCount, Unvisited);
+	hrt::vector<uint32> lowLink(entryCount, 0);
+	hrt::vector<uint8> onStack(entryCount, 0);
+	hrt::vector<uint32> stack;
+	hrt::vector<Frame> frames;
+
+	m_componentOf.assign(entryCount, Unvisited);
+	m_componentCount = 0;
+
+	uint32 nextOrder = 0;
+	auto visit = [&](uint32 entry) {
+		order[entry] = lowLink[entry] = nextOrder++;
+		stack.push_back(entry);
+		onStack[entry] = 1;
+		frames.push_back(Frame {entry, 0});
+	};
+
+	for (uint32 start = 0; start < entryCount; ++start)
+	{
+		if (order[start] != Unvisited)
+			continue;
+
+		visit(start);
+		while (!frames.empty())
+		{
+			Frame& frame = frames.back();
+			auto edges = m_graph.GetOutgoing(frame.entry);
+
+			if (frame.edge < edges.size())
+			{
+				uint32 next = edges[frame.edge++].entry;
+				if (order[next] == Unvisited)
+					visit(next);
+				else if (onStack[next])
+					lowLink[frame.entry] = std::min(lowLink[frame.entry], order[next]);
+
+				continue;
+			}
+
+			uint32 entry = frame.entry;
+			frames.pop_back();
+
+			if (!frames.empty())
+			{
+				uint32 parent = frames.back().entry;
+				lowLink[parent] = std::min(lowLink[parent], lowLink[entry]);
+			}
+
+			if (lowLink[entry] != order[entry])
+				continue;
+
+			uint32 member;
+			do
+			{
+				member = stack.back();
+				stack.pop_back();
+				onStack[member] = 0;
+				m_componentOf[member] = m_componentCount;
+			} while (member != entry);
+
+			++m_componentCount;
+		}
+	}
+}
+
+void GraphQueries::BuildCondensation()
+{
+	hrt::vector<std::pair<uint32, uint32>> links;
+	for (uint32 entry = 0; entry < m_graph.GetEntryCount(); ++entry)
+	{
+		uint32 from = m_componentOf[entry];
+		for (const DialogueEdge& edge : m_graph.GetOutgoing(entry))
+		{
+			uint32 to = m_componentOf[edge.entry];
+			if (from != to)
+				links.emplace_back(from, to);
+		}
+	}
+
+	std::sort(links.begin(), links.end());
+	links.erase(std::unique(links.begin(), links.end()), links.end());
+
+	m_componentOffsets.assign(m_componentCount + 1, 0);
+	m_componentEdges.resize(links.size());
+
+	for (size_t i = 0; i < links.size(); ++i)
+	{
+		++m_componentOffsets[links[i].first + 1];
+		m_componentEdges[i] = links[i].second;
+	}
+
+	for (uint32 i = 0; i < m_componentCount; ++i)
+	{
+		m_componentOffsets[i + 1] += m_componentOffsets[i];
+	}
+}
+
+bool GraphQueries::IsReachable(uint32 from, uint32 to) const
+{
+	uint32 fromComponent = m_componentOf[from];
+	uint32 toComponent = m_componentOf[to];
+	if (fromComponent == toComponent)
+		return true;
+
+	if (toComponent > fromComponent)
+		return false;
+
+	DenseBitset seen(m_componentCount);
+	hrt::vector<uint32> pending;
+	pending.push_back(fromComponent);
+	seen.Set(fromComponent);
+
+	while (!pending.empty())
+	{
+		uint32 component = pending.back();
+		pending.pop_back();
+
+		for (uint32 i = m_componentOffsets[component]; i < m_componentOffsets[component + 1]; ++i)
+		{
+			uint32 next = m_componentEdges[i];
+			if (next == toComponent)
+				return true;
+
+			// Nothing numbered below the target can lead back up to it
+			if (next > toComponent && !seen.Test(next))
+			{
+				seen.Set(next);
+				pending.push_back(next);
+			}
+		}
+	}
+
+	return false;
+}
+
+void GraphQueries::BreadthFirst(std::span<const uint32> sources, uint32 maxDepth, const std::function<bool(uint32 entry, uint32 depth)>& visit) const
+{
+	DenseBitset seen(m_graph.GetEntryCount());
+	hrt::vector<uint32> current;
+	hrt::vector<uint32> next;
+
+	for (uint32 source : sources)
+	{
+		if (!seen.Test(source))
+		{
+			seen.Set(source);
+			current.push_back(source);
+		}
+	}
+
+	for (uint32 depth = 0; !current.empty(); ++depth)
+	{
+		for (uint32 entry : current)
+		{
+			if (!visit(entry, depth))
+				return;
+
+			if (depth == maxDepth)
+				continue;
+
+			for (const DialogueEdge& edge : m_graph.GetOutgoing(entry))
+			{
+				if (!seen.Test(edge.entry))
+				{
+					seen.Set(edge.entry);
+					next.push_back(edge.entry);
+				}
+			}
+		}
+
+		current.swap(next);
+		next.clear();
+	}
+}
+
+void GraphQueries::DepthFirst(uint32 source, uint32 maxDepth, const std::function<bool(uint32 entry, uint32 depth)>& visit) const
+{
+	struct Frame
+	{
+		uint32 entry;
+		uint32 edge;
+	};
+
+	DenseBitset seen(m_graph.GetEntryCount());
+	hrt::vector<Frame> frames;
+
+	seen.Set(source);
+	if (!visit(source, 0))
+		return;
+
+	frames.push_back(Frame {source, 0});
+	while (!frames.empty())
+	{
+		Frame& frame = frames.back();
+		auto edges = m_graph.GetOutgoing(frame.entry);
+
+		uint32 depth = uint32(frames.size());
+		if (depth > maxDepth || frame.edge >= edges.size())
+		{
+			frames.pop_back();
+			continue;
+		}
+
+		uint32 next = edges[frame.edge++].entry;
+		if (seen.Test(next))
+			continue;
+
+		seen.Set(next);
+		if (!visit(next, depth))
+			return;
+
+		frames.push_back(Frame {next, 0});
+	}
+}
+
+bool GraphQueries::FindShortestPath(std::span<const uint32> sources, uint32 target, hrt::vector<uint32>& outPath) const
+{
+	outPath.clear();
+
+	hrt::vector<uint32> parent(m_graph.GetEntryCount(), Unvisited);
+	hrt::vector<uint32> pending;
+	pending.reserve(64);
+
+	for (uint32 source : sources)
+	{
+		if (parent[source] == Unvisited)
+		{
+			parent[source] = source;
+			pending.push_back(source);
+		}
+	}
+
+	// pending doubles as the BFS queue, head walks forward through it
+	bool found = parent[target] != Unvisited;
+	for (size_t head = 0; head < pending.size() && !found; ++head)
+	{
+		uint32 entry = pending[head];
+		for (const DialogueEdge& edge : m_graph.GetOutgoing(entry))
+		{
+			if (parent[edge.entry] != Unvisited)
+				continue;
+
+			parent[edge.entry] = entry;
+			pending.push_back(edge.entry);
+
+			if (edge.entry == target)
+			{
+				found = true;
+				break;
+			}
+		}
+	}
+
+	if (!found)
+		return false;
+
+	for (uint32 entry = target; true; entry = parent[entry])
+	{
+		outPath.push_back(entry);
+		if (parent[entry] == entry)
+			break;
+	}
+
+	std::reverse(outPath.begin(), outPath.end());
+	return true;
+}
+
+void GraphQueries::CollectPaths(uint32 start, bool forward, const TranscriptLimits& limits, hrt::vector<hrt::vector<uint32>>& outPaths) const
+{
+	struct Frame
+	{
+		uint32 entry;
+		uint32 edge;
+		bool extended;
+	};
+
+	DenseBitset onPath(m_graph.GetEntryCount());
+	hrt::vector<Frame> frames;
+	hrt::vector<uint32> path;
+
+	frames.push_back(Frame {start, 0, false});
+	path.push_back(start);
+	onPath.Set(start);
+
+	while (!frames.empty() && outPaths.size() < limits.maxTranscripts)
+	{
+		Frame& frame = frames.back();
+		auto edges = forward ? m_graph.GetOutgoing(frame.entry) : m_graph.GetIncoming(frame.entry);
+
+		// Walking backwards, a root is as far as a transcript goes
+		bool stop = (!forward && m_entries[frame.entry].isRoot) || path.size() > limits.maxDepth;
+		if (!stop && frame.edge < edges.size())
+		{
+			uint32 next = edges[frame.edge++].entry;
+			if (onPath.Test(next))
+				continue;
+
+			frame.extended = true;
+			frames.push_back(Frame {next, 0, false});
+			path.push_back(next);
+			onPath.Set(next);
+			continue;
+		}
+
+		// Nothing further that isn't already on the path, so this is one end
+		if (!frame.extended)
+			outPaths.push_back(path);
+
+		onPath.Reset(frame.entry);
+		path.pop_back();
+		frames.pop_back();
+	}
+}
+
+uint32 GraphQueries::EnumerateTranscripts(uint32 entry, const TranscriptLimits& limits, const std::function<void(std::span<const uint32>)>& onTranscript) const
+{
+	// Each half is a list of walks starting at entry
+	hrt::vector<hrt::vector<uint32>> prefixes;
+	hrt::vector<hrt::vector<uint32>> suffixes;
+	CollectPaths(entry, false, limits, prefixes);
+	CollectPaths(entry, true, limits, suffixes);
+
+	uint32 produced = 0;
+	hrt::vector<uint32> transcript;
+
+	for (const hrt::vector<uint32>& prefix : prefixes)
+	{
+		for (const hrt::vector<uint32>& suffix : suffixes)
+		{
+			if (produced == limits.maxTranscripts)
+				return produced;
+
+			transcript.assign(prefix.rbegin(), prefix.rend());
+			transcript.insert(transcript.end(), suffix.begin() + 1, suffix.end());
+
+			onTranscript(std::span<const uint32>(transcript.data(), transcript.size()));
+			++produced;
+		}
+	}
+
+	return produced;
+}
+
+DenseBitset GraphQueries::FindUnreachableEntries(ThreadPool& threads) const
+{
+	DenseBitset reached(m_componentCount);
+	uint64* reachedWords = reached.GetWords();
+
+	uint32 wordCount = uint32(reached.GetWordCount());
+	uint32 jobCount = (wordCount + WordsPerJob - 1) / WordsPerJob;
+
+	// Every job owns its own slice of words, so the merge needs no synchronization
+	threads.ParallelFor(jobCount, [&](uint32 job) {
+		uint32 begin = job * WordsPerJob;
+		uint32 end = std::min(begin + WordsPerJob, wordCount);
+
+		for (const DenseBitset& conversation : m_rootReachability)
+		{
+			const uint64* words = conversation.GetWords();
+			for (uint32 i = begin; i < end; ++i)
+			{
+				reachedWords[i] |= words[i];
+			}
+		}
+	});
+
+	DenseBitset unreachable(m_graph.GetEntryCount());
+	for (uint32 entry = 0; entry < m_graph.GetEntryCount(); ++entry)
+	{
+		if (!reached.Test(m_componentOf[entry]))
+			unreachable.Set(entry);
+	}
+
+	return unreachable;
+}
+
+void FilterReachableMatches(const GraphQueries& queries, const ManagedStringPool& pool, uint32 conversation, hrt::vector<ManagedString>& inOutMatches)
+{
+	auto isUnreachable = [&](const ManagedString& match) {
+		if (match.GetLookbackType(pool) != ObjectType::DialogEntry)
+			return true;
+
+		return !queries.IsReachableFromRoot(conversation, match.GetLookbackIndex(pool));
+	};
+
+	inOutMatches.erase(std::remove_if(inOutMatches.begin(), inOutMatches.end(), isUnreachable), inOutMatches.end());
+}
@@ -0,0 +1,135 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "graph/dialogue_graph.h"
+#include "memory/dense_bitset.h"
+#include "memory/managed_string.h"
+#include "memory/memory_tracker.h"
+#include "types/conversation.h"
+#include "types/dialogue_entry.h"
+
+#include <heart/copy_move_semantics.h>
+#include <heart/types.h>
+
+#include <heart/stl/vector.h>
+
+#include <functional>
+#include <span>
+
+class ThreadPool;
+
+struct TranscriptLimits
+{
+	// Longest walk followed on either side of the entry
+	uint32 maxDepth = 32;
+
+	uint32 maxTranscripts = 64;
+};
+
+// Traversals over one corpus' DialogueGraph, plus the summaries that make the common
+// questions cheap.
+//
+// Precompute() collapses the graph into its strongly connected components (the loops
+// back to hub lines are everywhere) and records, for every conversation, which
+// components its root entries can reach. "Can conversation X reach this line?" is then a
+// single bit test. The references passed in must outlive this object.
+class GraphQueries
+{
+	const DialogueGraph& m_graph;
+	const EntityVector<Conversation>& m_conversations;
+	const EntityVector<DialogEntry>& m_entries;
+
+	hrt::vector<uint32> m_conversationOf;
+
+	// Root entries of conversation i are m_roots[m_rootOffsets[i] .. m_rootOffsets[i + 1])
+	hrt::vector<uint32> m_rootOffsets;
+	hrt::vector<uint32> m_roots;
+
+	// Components are numbered in the order Tarjan finishes them, so everything a
+	// component can reach has a smaller number than it does.
+	hrt::vector<uint32> m_componentOf;
+	uint32 m_componentCount = 0;
+
+	// The condensation, as CSR like the graph itself
+	hrt::vector<uint32> m_componentOffsets;
+	hrt::vector<uint32> m_componentEdges;
+
+	// Per conversation, over components
+	hrt::vector<DenseBitset> m_rootReachability;
+
+	void BuildRoots();
+	void BuildComponents();
+	void BuildCondensation();
+	void CollectPaths(uint32 start, bool forward, const TranscriptLimits& limits, hrt::vector<hrt::vector<uint32>>& outPaths) const;
+
+public:
+	GraphQueries(const DialogueGraph& graph, const EntityVector<Conversation>& conversations, const EntityVector<DialogEntry>& entries);
+	DISABLE_COPY_AND_MOVE_SEMANTICS(GraphQueries);
+
+	// Builds the component and reachability summaries, one conversation per job
+	void Precompute(ThreadPool& threads);
+
+	uint32 GetConversationOf(uint32 entry) const
+	{
+		return m_conversationOf[entry];
+	}
+
+	// The conversation's isRoot entries, or its first entry if none are flagged
+	std::span<const uint32> GetRoots(uint32 conversation) const
+	{
+		return std::span<const uint32>(m_roots.data() + m_rootOffsets[conversation], m_roots.data() + m_rootOffsets[conversation + 1]);
+	}
+
+	uint32 GetComponentCount() const
+	{
+		return m_componentCount;
+	}
+
+	uint32 GetComponent(uint32 entry) const
+	{
+		return m_componentOf[entry];
+	}
+
+	// O(1) once Precompute() has run
+	bool IsReachableFromRoot(uint32 conversation, uint32 entry) const
+	{
+		return m_rootReachability[conversation].Test(m_componentOf[entry]);
+	}
+
+	// Searches the condensation, skipping anything ordered before the target's component
+	bool IsReachable(uint32 from, uint32 to) const;
+
+	// Visits entries in breadth-first order from every source, stopping early when visit
+	// returns false. Depth is the number of links followed.
+	void BreadthFirst(std::span<const uint32> sources, uint32 maxDepth, const std::function<bool(uint32 entry, uint32 depth)>& visit) const;
+
+	// Same as BreadthFirst, but goes as deep as it can before backtracking
+	void DepthFirst(uint32 source, uint32 maxDepth, const std::function<bool(uint32 entry, uint32 depth)>& visit) const;
+
+	// Fewest links from any of the sources to target, written out source first
+	bool FindShortestPath(std::span<const uint32> sources, uint32 target, hrt::vector<uint32>& outPath) const;
+
+	bool FindPathFromRoot(uint32 entry, hrt::vector<uint32>& outPath) const
+	{
+		return FindShortestPath(GetRoots(GetConversationOf(entry)), entry, outPath);
+	}
+
+	// Calls onTranscript with linear walks through entry: from a root (or as far back as
+	// the limits allow) to a line with nowhere left to go. No entry repeats within either
+	// half. Returns how many were produced.
+	uint32 EnumerateTranscripts(uint32 entry, const TranscriptLimits& limits, const std::function<void(std::span<const uint32>)>& onTranscript) const;
+
+	// Entries no conversation's root can get to
+	DenseBitset FindUnreachableEntries(ThreadPool& threads) const;
+};
+
+// Drops every match that isn't a dialog entry reachable from the conversation's root
+void FilterReachableMatches(const GraphQueries& queries, const ManagedStringPool& pool, uint32 conversation, hrt::vector<ManagedString>& inOutMatches);
@@ -0,0 +1,98 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "json/chunked_file_reader.h"
+
+ChunkedFileReader::~ChunkedFileReader()
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_stopping = true;
+	}
+
+	m_freed.notify_all();
+	if (m_thread.joinable())
+		m_thread.join();
+
+	if (m_file)
+		fclose(m_file);
+}
+
+bool ChunkedFileReader::Open(const char* path)
+{
+	HEART_ASSERT(!m_file);
+
+	fopen_s(&m_file, path, "rb");
+	if (!m_file)
+		return false;
+
+	for (Buffer& buffer : m_buffers)
+	{
+		buffer.data.resize(ChunkSize);
+	}
+
+	m_thread = std::thread([this]() { ReaderMain(); });
+	return true;
+}
+
+void ChunkedFileReader::ReaderMain()
+{
+	while (true)
+	{
+		Buffer* buffer = nullptr;
+		{
+			std::unique_lock lock(m_mutex);
+			m_freed.wait(lock, [this]() { return m_stopping || m_filledCount < BufferCount; });
+			if (m_stopping)
+				return;
+
+			buffer = &m_buffers[m_writeIndex];
+		}
+
+		// Nobody else touches a buffer that isn't filled yet, so this needs no lock
+		buffer->size = fread(buffer->data.data(), 1, ChunkSize, m_file);
+
+		{
+			std::lock_guard lock(m_mutex);
+			if (buffer->size == 0)
+			{
+				m_finished = true;
+			}
+			else
+			{
+				m_writeIndex = (m_writeIndex + 1) % BufferCount;
+				++m_filledCount;
+			}
+		}
+
+		m_filled.notify_one();
+		if (buffer->size == 0)
+			return;
+	}
+}
+
+std::span<const char> ChunkedFileReader::NextChunk()
+{
+	std::unique_lock lock(m_mutex);
+	if (m_holdingChunk)
+	{
+		m_readIndex = (m_readIndex + 1) % BufferCount;
+		--m_filledCount;
+		m_holdingChunk = false;
+		m_freed.notify_one();
+	}
+
+	m_filled.wait(lock, [this]() { return m_finished || m_filledCount > 0; });
+	if (m_filledCount == 0)
+		return {};
+
+	m_holdingChunk = true;
+	const Buffer& buffer = m_buffers[m_readIndex];
+	return std::span<const char>(buffer.data.data(), buffer.size);
+}
@@ -0,0 +1,142 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include <heart/copy_move_semantics.h>
+#include <heart/debug/assert.h>
+#include <heart/types.h>
+
+#include <heart/stl/vector.h>
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <span>
+#include <thread>
+
+// Reads a file on its own thread into a small ring of buffers, so the consumer can work on
+// one chunk while the next few are read. I/O gets a thread of its own rather than a
+// ThreadPool job, a job blocked on the disk would hold up a worker.
+class ChunkedFileReader
+{
+public:
+	static constexpr size_t ChunkSize = size_t(1) << 20;
+	static constexpr uint32 BufferCount = 4;
+
+private:
+	struct Buffer
+	{
+		hrt::vector<char> data;
+		size_t size = 0;
+	};
+
+	FILE* m_file = nullptr;
+	std::thread m_thread;
+
+	std::mutex m_mutex;
+	std::condition_variable m_filled;
+	std::condition_variable m_freed;
+
+	Buffer m_buffers[BufferCount];
+	uint32 m_readIndex = 0;
+	uint32 m_writeIndex = 0;
+
+	// Includes the chunk the consumer is holding, until it asks for the next one
+	uint32 m_filledCount = 0;
+	bool m_holdingChunk = false;
+	bool m_finished = false;
+	bool m_stopping = false;
+
+	void ReaderMain();
+
+public:
+	ChunkedFileReader() = default;
+	DISABLE_COPY_AND_MOVE_SEMANTICS(ChunkedFileReader);
+	~ChunkedFileReader();
+
+	// Starts reading in the background
+	bool Open(const char* path);
+
+	// Blocks until the next chunk is read, empty at the end of the file. Hands the previous
+	// chunk back to the reader, so it mustn't be used after this.
+	std::span<const char> NextChunk();
+};
+
+// rapidjson input stream over a ChunkedFileReader
+class ChunkedReadStream
+{
+	ChunkedFileReader& m_reader;
+
+	const char* m_current = nullptr;
+	const char* m_end = nullptr;
+	size_t m_consumed = 0;
+
+	void Refill()
+	{
+		std::span<const char> chunk = m_reader.NextChunk();
+		m_consumed += chunk.size();
+		m_current = chunk.data();
+		m_end = chunk.data() + chunk.size();
+	}
+
+public:
+	typedef char Ch;
+
+	explicit ChunkedReadStream(ChunkedFileReader& reader) :
+		m_reader(reader)
+	{
+		Refill();
+	}
+
+	Ch Peek() const
+	{
+		return m_current < m_end ? *m_current : '\0';
+	}
+
+	Ch Take()
+	{
+		if (m_current == m_end)
+			return '\0';
+
+		Ch c = *m_current++;
+		if (m_current == m_end)
+			Refill();
+
+		return c;
+	}
+
+	size_t Tell() const
+	{
+		return m_consumed - size_t(m_end - m_current);
+	}
+
+	// Read only
+	Ch* PutBegin()
+	{
+		HEART_ASSERT(false);
+		return nullptr;
+	}
+
+	void Put(Ch)
+	{
+		HEART_ASSERT(false);
+	}
+
+	void Flush()
+	{
+		HEART_ASSERT(false);
+	}
+
+	size_t PutEnd(Ch*)
+	{
+		HEART_ASSERT(false);
+		return 0;
+	}
+};
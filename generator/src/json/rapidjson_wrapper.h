@@ -9,8 +9,73 @@
 
 #pragma once
 
+#include "memory/monotonic_arena.h"
+
 #include <heart/debug/assert.h>
 
 #include <rapidjson/document.h>
 
-rapidjson::Document ParseDocumentAsStream(const char* path);
+#include <cstddef>
+
+// rapidjson's allocator interface over TrackedMalloc, charged to MemoryTag::JsonDocument.
+// Free doesn't get a size, so each block keeps its own in a small header.
+class TrackedJsonAllocator
+{
+public:
+	static const bool kNeedFree = true;
+
+	void* Malloc(size_t size);
+	void* Realloc(void* originalPtr, size_t originalSize, size_t newSize);
+	static void Free(void* ptr);
+
+	bool operator==(const TrackedJsonAllocator&) const
+	{
+		return true;
+	}
+
+	bool operator!=(const TrackedJsonAllocator&) const
+	{
+		return false;
+	}
+};
+
+// rapidjson's allocator interface over a MonotonicArena, for the DOM's values. Nothing is
+// freed until the arena is released, which has to wait until the document is done with.
+class ArenaJsonAllocator
+{
+	MonotonicArena* m_arena = nullptr;
+
+public:
+	static const bool kNeedFree = false;
+
+	// rapidjson default constructs one for an empty document, it mustn't allocate
+	ArenaJsonAllocator() = default;
+
+	explicit ArenaJsonAllocator(MonotonicArena& arena) :
+		m_arena(&arena)
+	{
+	}
+
+	void* Malloc(size_t size);
+	void* Realloc(void* originalPtr, size_t originalSize, size_t newSize);
+
+	static void Free(void*)
+	{
+	}
+
+	bool operator==(const ArenaJsonAllocator& other) const
+	{
+		return m_arena == other.m_arena;
+	}
+
+	bool operator!=(const ArenaJsonAllocator& other) const
+	{
+		return m_arena != other.m_arena;
+	}
+};
+
+// Values go in the arena, the parse stack grows and shrinks so it stays on the tracked heap
+typedef rapidjson::GenericDocument<rapidjson::UTF8<>, ArenaJsonAllocator, TrackedJsonAllocator> JsonDocument;
+
+// The document keeps a pointer to allocator, which must outlive it
+JsonDocument ParseDocumentAsStream(const char* path, ArenaJsonAllocator& allocator);
@@ -168,12 +168,6 @@ struct GenericJsonReader
 		using ParsableType = unsigned int;
 	};
 
-	template <>
-	struct PromotionHelper<ManagedString>
-	{
-		using ParsableType = const char*;
-	};
-
 	template <typename RapidJsonFieldT>
 	bool AttemptRead(TargetT& outTarget, RapidJsonFieldT&& json)
 	{
@@ -227,6 +221,33 @@ bool ReadFromFieldsArray(TargetT& targetField, RapidjsonT&& jsonObj, const char*
 	return false;
 }
 
+// Strings are read into whichever pool the caller is building
+template <typename RapidjsonT>
+bool ReadSingleField(ManagedString& targetField, ManagedStringPool& pool, RapidjsonT&& jsonObj, const char* fieldName)
+{
+	const char* value;
+	if (!ReadSingleField(value, jsonObj, fieldName))
+		return false;
+
+	targetField = ManagedString(pool, value);
+	return true;
+}
+
+template <typename RapidjsonT>
+bool ReadFromFieldsArray(ManagedString& targetField, ManagedStringPool& pool, RapidjsonT&& jsonObj, const char* fieldName)
+{
+	const char* value;
+	if (!ReadFromFieldsArray(value, jsonObj, fieldName))
+		return false;
+
+	targetField = ManagedString(pool, value);
+	return true;
+}
+
 #define READ_NAMED_SINGLE_FIELD(obj, field, json) ReadSingleField(obj.field, json, #field)
 
 #define READ_NAMED_FROM_FIELDS_ARRAY(obj, field, arr) ReadFromFieldsArray(obj.field, arr, #field);
+
+#define READ_NAMED_STRING_SINGLE_FIELD(obj, field, pool, json) ReadSingleField(obj.field, pool, json, #field)
+
+#define READ_NAMED_STRING_FROM_FIELDS_ARRAY(obj, field, pool, arr) ReadFromFieldsArray(obj.field, pool, arr, #field);
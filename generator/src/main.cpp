@@ -7,112 +7,647 @@
  *
  */
 
-#include "types/actor.h"
-#include "types/conversation.h"
-#include "types/dialogue_entry.h"
-#include "types/variable.h"
-
-#include "memory/hash_lookup.h"
+#include "conditions/condition_evaluator.h"
+#include "corpus/corpus.h"
+#include "corpus/corpus_set.h"
+#include "corpus/live_corpus.h"
+#include "graph/graph_queries.h"
+#include "memory/memory_tracker.h"
+#include "os/buffered_writer.h"
 #include "os/slim_win32.h"
-#include "json/rapidjson_wrapper.h"
+#include "profiling/profiler.h"
+#include "query/batch_query.h"
+#include "query/faceted_search.h"
+#include "query/match_context.h"
+#include "query/snippet.h"
+#include "server/load_generator.h"
+#include "server/query_server.h"
+#include "threading/thread_pool.h"
 
-#include <heart/countof.h>
-#include <heart/stl/vector.h>
 #include <heart/types.h>
 
+#include <heart/stl/vector.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <string_view>
 
-template <typename T>
-void InitializeLookback(T& target, size_t index)
+namespace
 {
-	for (ManagedString* str : target.GetStrings())
+	void PrintEntry(const Corpus& corpus, uint32 entry)
 	{
-		str->InitializeLookback(T::Type, index);
+		MatchContext context = ResolveEntryContext(corpus, entry);
+		std::cout << "  (" << context.entry->conversationId << ":" << context.entry->id << ") ";
+		if (context.speaker)
+			std::cout << context.speaker->name.CStr(corpus.pool) << ": ";
+
+		// No flush per line, the command's trailing blank line takes care of it
+		std::cout << context.entry->dialogText.CStr(corpus.pool) << '\n';
 	}
-}
 
-int main()
-{
-	::SetConsoleOutputCP(CP_UTF8);
-	setvbuf(stdout, nullptr, _IOFBF, 1000);
+	void PrintMatch(BufferedWriter& output, const Corpus& corpus, const ManagedString& match, std::string_view query, bool showCorpus)
+	{
+		MatchContext context;
+		if (!ResolveMatchContext(corpus, match, context))
+			return;
+
+		hrt::string& line = output.GetBuffer();
+		if (showCorpus)
+		{
+			line.append("[");
+			line.append(corpus.name);
+			line.append("] ");
+		}
+
+		if (context.conversation)
+		{
+			line.append("(");
+			line.append(context.conversation->title.CStr(corpus.pool));
+			line.append(") ");
+		}
+		if (context.speaker)
+		{
+			line.append(context.speaker->name.CStr(corpus.pool));
+			line.append(": ");
+		}
+
+		std::string_view text(match.CStr(corpus.pool), match.GetSize());
 
-	rapidjson::Document doc;
-	hrt::vector<Actor> actors;
-	hrt::vector<Variable> variables;
-	hrt::vector<Conversation> conversations;
-	hrt::vector<DialogEntry> dialogEntries;
+		MatchSpan span;
+		if (HashLookup::FindMatchSpan(text, query, {}, span))
+			AppendSnippet(line, text, span);
+		else
+			line.append(text);
 
-	std::cout << "Reading json... ";
-	std::cout.flush();
+		line.push_back('\n');
+		output.FlushIfFull();
+	}
+
+	// ":path", ":transcripts", ":from" and ":unreachable". Returns false if line isn't one.
+	bool RunGraphCommand(const std::string& line, const Corpus& corpus, const GraphQueries& graph, ThreadPool& threads)
 	{
-		doc = ParseDocumentAsStream("C:\\Users\\James\\Desktop\\DiscoDump\\Disco Elysium.json");
-		if (!doc.IsObject())
-			return 1;
+		std::istringstream stream(line);
+		std::string command;
+		stream >> command;
+
+		if (command == ":unreachable")
+		{
+			DenseBitset unreachable = graph.FindUnreachableEntries(threads);
+			std::cout << unreachable.Count() << " of " << corpus.dialogEntries.size() << " entries can't be reached from any conversation root." << std::endl;
+			return true;
+		}
+
+		if (command != ":path" && command != ":transcripts" && command != ":from")
+			return false;
+
+		int32 conversationId = 0;
+		stream >> conversationId;
+
+		if (command == ":from")
+		{
+			std::string query;
+			std::getline(stream >> std::ws, query);
+
+			uint32 conversation = corpus.ids.FindConversation(conversationId);
+			if (conversation == UINT32_MAX)
+			{
+				std::cout << "No conversation " << conversationId << std::endl;
+				return true;
+			}
+
+			auto matches = corpus.index.LookupWord(query.c_str());
+			FilterReachableMatches(graph, corpus.pool, conversation, matches);
+			for (const ManagedString& match : matches)
+			{
+				PrintEntry(corpus, match.GetLookbackIndex(corpus.pool));
+			}
+
+			return true;
+		}
+
+		int32 entryId = 0;
+		stream >> entryId;
+
+		uint32 entry = corpus.ids.FindDialogEntry(conversationId, entryId);
+		if (entry == UINT32_MAX)
+		{
+			std::cout << "No entry " << conversationId << ":" << entryId << std::endl;
+			return true;
+		}
+
+		if (command == ":path")
+		{
+			hrt::vector<uint32> path;
+			if (!graph.FindPathFromRoot(entry, path))
+			{
+				std::cout << "Unreachable from its conversation's root." << std::endl;
+				return true;
+			}
+
+			for (uint32 step : path)
+			{
+				PrintEntry(corpus, step);
+			}
+
+			return true;
+		}
+
+		uint32 count = graph.EnumerateTranscripts(entry, TranscriptLimits {}, [&](std::span<const uint32> transcript) {
+			for (uint32 step : transcript)
+			{
+				PrintEntry(corpus, step);
+			}
+
+			std::cout << std::endl;
+		});
+
+		std::cout << count << " transcripts." << std::endl;
+		return true;
 	}
-	std::cout << "Done!" << std::endl;
 
-	std::cout << "Parsing entries... ";
-	std::cout.flush();
+	// ":scan <column><op><value>... [| <text query>]", e.g. ":scan root=1 priority>2 | kim"
+	bool RunScanCommand(const std::string& line, const Corpus& corpus)
 	{
-		auto rootObj = doc.GetObject();
-		if (auto actorsIter = rootObj.FindMember("actors"); actorsIter != rootObj.MemberEnd() && actorsIter->value.IsArray())
+		std::istringstream stream(line);
+		std::string command;
+		stream >> command;
+
+		if (command != ":scan")
+			return false;
+
+		hrt::vector<ColumnPredicate> predicates;
+		std::string token;
+		while (stream >> token && token != "|")
 		{
-			auto actorsArray = actorsIter->value.GetArray();
-			for (auto& entry : actorsArray)
+			ColumnPredicate predicate;
+			if (!ParseColumnPredicate(token, predicate))
 			{
-				actors.push_back(ParseActor(entry.GetObject()));
-				InitializeLookback(actors.back(), actors.size() - 1);
+				std::cout << "Can't read predicate " << token << std::endl;
+				return true;
 			}
+
+			predicates.push_back(predicate);
 		}
 
-		if (auto variablesIter = rootObj.FindMember("variables"); variablesIter != rootObj.MemberEnd() && variablesIter->value.IsArray())
+		auto start = std::chrono::steady_clock::now();
+		DenseBitset selection = corpus.entryTable.Select(std::span<const ColumnPredicate>(predicates.data(), predicates.size()));
+
+		std::string query;
+		if (std::getline(stream >> std::ws, query) && !query.empty())
+			selection &= MatchesToSelection(corpus.pool, corpus.index.LookupWord(query.c_str()), corpus.entryTable.GetRowCount());
+		auto end = std::chrono::steady_clock::now();
+
+		constexpr uint32 MaxPrinted = 20;
+		uint32 printed = 0;
+		selection.ForEachSet([&](uint32 entry) {
+			if (printed++ < MaxPrinted)
+				PrintEntry(corpus, entry);
+		});
+
+		double elapsedUs = std::chrono::duration<double, std::micro>(end - start).count();
+		std::cout << selection.Count() << " entries selected in " << elapsedUs << "us." << std::endl;
+		return true;
+	}
+
+	// Searches with filters, e.g. "whirling" actor:Kim root:true
+	void RunFacetedSearch(const std::string& line, const Corpus& corpus)
+	{
+		FacetedQuery query;
+		hrt::string error;
+		if (!ParseFacetedQuery(line, corpus, query, error))
+		{
+			std::cout << error << std::endl;
+			return;
+		}
+
+		FacetedResult result = RunFacetedQuery(corpus, query);
+
+		constexpr uint32 MaxPrinted = 20;
+		uint32 printed = 0;
+		result.entries.ForEach([&](uint32 entry) {
+			if (printed++ < MaxPrinted)
+				PrintEntry(corpus, entry);
+		});
+
+		std::cout << result.entries.GetCardinality() << " entries." << std::endl;
+
+		constexpr size_t MaxFacets = 5;
+		std::cout << "By actor:";
+		for (size_t i = 0; i < result.actorCounts.size() && i < MaxFacets; ++i)
+		{
+			uint32 actor = corpus.ids.FindActor(result.actorCounts[i].value);
+			std::cout << " " << (actor != UINT32_MAX ? corpus.actors[actor].name.CStr(corpus.pool) : "(none)") << " (" << result.actorCounts[i].count << ")";
+		}
+		std::cout << std::endl;
+
+		std::cout << "By conversation:";
+		for (size_t i = 0; i < result.conversationCounts.size() && i < MaxFacets; ++i)
 		{
-			auto variablesArray = variablesIter->value.GetArray();
-			for (auto& entry : variablesArray)
+			const Conversation& conversation = corpus.conversations[result.conversationCounts[i].value];
+			std::cout << " " << conversation.title.CStr(corpus.pool) << " (" << result.conversationCounts[i].count << ")";
+		}
+		std::cout << std::endl;
+	}
+
+	// ":dupes [<similarity>] [<clusters>]", e.g. ":dupes 0.7 20" for the 20 largest groups of
+	// lines at least 70% alike
+	bool RunDuplicateCommand(const std::string& line, const Corpus& corpus)
+	{
+		std::istringstream stream(line);
+		std::string command;
+		stream >> command;
+
+		if (command != ":dupes")
+			return false;
+
+		float threshold = 0.8f;
+		uint32 clusterLimit = 10;
+		stream >> threshold >> clusterLimit;
+
+		constexpr uint32 EntriesShown = 5;
+
+		auto start = std::chrono::steady_clock::now();
+		hrt::vector<DuplicateCluster> clusters = corpus.duplicates.FindClusters(threshold);
+		auto end = std::chrono::steady_clock::now();
+
+		for (uint32 i = 0; i < clusters.size() && i < clusterLimit; ++i)
+		{
+			const hrt::vector<uint32>& entries = clusters[i].entries;
+			std::cout << entries.size() << " alike:\n";
+			for (uint32 j = 0; j < entries.size() && j < EntriesShown; ++j)
 			{
-				variables.push_back(ParseVariable(entry.GetObject()));
-				InitializeLookback(variables.back(), variables.size() - 1);
+				PrintEntry(corpus, entries[j]);
 			}
+
+			if (entries.size() > EntriesShown)
+				std::cout << "  ...and " << entries.size() - EntriesShown << " more\n";
+		}
+
+		uint32 lineCount = 0;
+		for (const DuplicateCluster& cluster : clusters)
+		{
+			lineCount += uint32(cluster.entries.size());
 		}
 
-		if (auto conversationsIter = rootObj.FindMember("conversations"); conversationsIter != rootObj.MemberEnd() && conversationsIter->value.IsArray())
+		double elapsedMs = std::chrono::duration<double, std::milli>(end - start).count();
+		std::cout << clusters.size() << " clusters covering " << lineCount << " entries (" << elapsedMs << "ms)." << std::endl;
+		return true;
+	}
+
+	// ":like <conversation id> <entry id> [<count>]" for the lines most like that one, and
+	// ":liketext <text>" for the lines most like any text
+	bool RunSimilarityCommand(const std::string& line, const Corpus& corpus)
+	{
+		std::istringstream stream(line);
+		std::string command;
+		stream >> command;
+
+		if (command != ":like" && command != ":liketext")
+			return false;
+
+		constexpr uint32 DefaultCount = 10;
+
+		auto start = std::chrono::steady_clock::now();
+		hrt::vector<SimilarEntry> results;
+		if (command == ":liketext")
 		{
-			auto conversationsArray = conversationsIter->value.GetArray();
-			for (auto& conversationJson : conversationsArray)
+			std::string text;
+			std::getline(stream >> std::ws, text);
+			corpus.similarity.FindSimilar(text, DefaultCount, results);
+		}
+		else
+		{
+			int32 conversationId = 0;
+			int32 entryId = 0;
+			uint32 count = DefaultCount;
+			stream >> conversationId >> entryId >> count;
+
+			uint32 entry = corpus.ids.FindDialogEntry(conversationId, entryId);
+			if (entry == UINT32_MAX)
 			{
-				Conversation& conversation = conversations.emplace_back(ParseConversation(conversationJson));
-				InitializeLookback(conversation, conversations.size() - 1);
+				std::cout << "No entry " << conversationId << ":" << entryId << std::endl;
+				return true;
+			}
 
-				auto dialogIter = conversationJson.FindMember("dialogueEntries");
-				if (dialogIter != conversationJson.MemberEnd() && dialogIter->value.IsArray())
+			PrintEntry(corpus, entry);
+			corpus.similarity.FindSimilar(entry, count, results);
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		for (const SimilarEntry& result : results)
+		{
+			std::cout << "  " << result.score;
+			PrintEntry(corpus, result.entry);
+		}
+
+		double elapsedMs = std::chrono::duration<double, std::milli>(end - start).count();
+		std::cout << results.size() << " similar entries (" << elapsedMs << "ms)." << std::endl;
+		return true;
+	}
+
+	// ":depends <variable>", ":condition <conversation id> <entry id>" and
+	// ":available [<variable>=<true|false|number>]..."
+	bool RunConditionCommand(const std::string& line, const Corpus& corpus, ThreadPool& threads)
+	{
+		std::istringstream stream(line);
+		std::string command;
+		stream >> command;
+
+		if (command == ":available")
+		{
+			// Evaluated twice, once for each way of reading the conditions we can't evaluate
+			GameStates states(corpus.variables, 2);
+
+			std::string assignment;
+			while (stream >> assignment)
+			{
+				size_t equals = assignment.find('=');
+				uint32 variable = equals == std::string::npos ? UINT32_MAX : corpus.conditions.FindVariable(std::string_view(assignment).substr(0, equals));
+				if (variable == UINT32_MAX)
 				{
-					auto dialogArray = dialogIter->value.GetArray();
-					for (auto& dialogJson : dialogArray)
-					{
-						DialogEntry& dialogEntry = dialogEntries.emplace_back(ParseDialogEntry(dialogJson));
-						InitializeLookback(dialogEntry, dialogEntries.size() - 1);
-
-						HEART_ASSERT(conversation.dialogEntryCount < HeartCountOf(conversation.dialogEntries));
-						conversation.dialogEntries[conversation.dialogEntryCount++] = uint32(dialogEntries.size() - 1);
-					}
+					std::cout << "Ignoring " << assignment << std::endl;
+					continue;
 				}
+
+				std::string value = assignment.substr(equals + 1);
+				int32 parsed = value == "true" ? 1 : value == "false" ? 0 : int32(strtol(value.c_str(), nullptr, 10));
+				states.Set(0, variable, parsed);
+				states.Set(1, variable, parsed);
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			auto optimistic = EvaluateConditions(corpus.conditions, states, threads, UnknownPolicy::AssumeTrue);
+			auto pessimistic = EvaluateConditions(corpus.conditions, states, threads, UnknownPolicy::AssumeFalse);
+			auto end = std::chrono::steady_clock::now();
+
+			double elapsedMs = std::chrono::duration<double, std::milli>(end - start).count();
+			std::cout << "Between " << pessimistic[0].Count() << " and " << optimistic[0].Count() << " of " << corpus.dialogEntries.size() << " entries available (" << elapsedMs << "ms)." << std::endl;
+			return true;
+		}
+
+		if (command == ":depends")
+		{
+			std::string name;
+			std::getline(stream >> std::ws, name);
+
+			uint32 variable = corpus.conditions.FindVariable(name);
+			if (variable == UINT32_MAX)
+			{
+				std::cout << "No variable " << name << std::endl;
+				return true;
+			}
+
+			auto dependents = corpus.conditions.GetDependents(variable);
+			for (uint32 entry : dependents)
+			{
+				PrintEntry(corpus, entry);
 			}
+
+			std::cout << dependents.size() << " entries read " << name << "." << std::endl;
+			return true;
 		}
 
-		doc = {};
+		if (command != ":condition")
+			return false;
+
+		int32 conversationId = 0;
+		int32 entryId = 0;
+		stream >> conversationId >> entryId;
+
+		uint32 entry = corpus.ids.FindDialogEntry(conversationId, entryId);
+		if (entry == UINT32_MAX)
+		{
+			std::cout << "No entry " << conversationId << ":" << entryId << std::endl;
+			return true;
+		}
+
+		std::cout << corpus.dialogEntries[entry].conditionsString.CStr(corpus.pool) << std::endl;
+		std::cout << DisassembleCondition(corpus.conditions.GetProgram(entry), corpus.variables, corpus.pool);
+		return true;
 	}
-	std::cout << "Done! Found " << actors.size() << " actors, " << conversations.size() << " conversations and " << dialogEntries.size() << " dialog nodes." << std::endl;
+}
+
+struct CommandLine
+{
+	// Several dumps can be loaded side by side, searches in the REPL cover all of them
+	hrt::vector<const char*> dumpPaths;
 
-	std::cout << "Finalizing string pool... ";
-	std::cout.flush();
-	uint32 stringCount = ManagedStringPool::Get().FinalizeBuilder();
-	std::cout << "Done! " << stringCount << " strings pooled." << std::endl;
+	const char* batchInput = nullptr;
+	const char* batchOutput = nullptr;
 
-	std::cout << "Compiling index... ";
-	std::cout.flush();
-	HashLookup hasher;
-	uint32 hashCount = hasher.Compile();
-	std::cout << "Done! " << hashCount << " words indexed." << std::endl;
+	uint16 servePort = 0;
+
+	// Per-query budget for the server, zero is unlimited
+	uint32 queryTimeoutUs = 0;
+	uint32 queryMaxCandidates = 0;
+
+	// Lets clients stop the server with a "shutdown" line
+	bool allowShutdown = false;
+
+	LoadGeneratorConfig loadGenerator;
+
+	uint32 threadCount = 0;
+
+	// Chrome trace written and/or summary printed when the program exits
+	const char* tracePath = nullptr;
+	bool printProfile = false;
+
+	// Tracked memory by subsystem after each load phase
+	bool memoryReport = false;
+
+	bool Parse(int argc, char* argv[])
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* arg = argv[i];
+			bool hasNext = i + 1 < argc;
+
+			if (strcmp(arg, "--dump") == 0 && hasNext)
+			{
+				dumpPaths.push_back(argv[++i]);
+			}
+			else if (strcmp(arg, "--batch") == 0 && i + 2 < argc)
+			{
+				batchInput = argv[++i];
+				batchOutput = argv[++i];
+			}
+			else if (strcmp(arg, "--serve") == 0 && hasNext)
+			{
+				servePort = uint16(strtoul(argv[++i], nullptr, 10));
+			}
+			else if (strcmp(arg, "--query-timeout") == 0 && hasNext)
+			{
+				queryTimeoutUs = uint32(strtoul(argv[++i], nullptr, 10));
+			}
+			else if (strcmp(arg, "--query-work") == 0 && hasNext)
+			{
+				queryMaxCandidates = uint32(strtoul(argv[++i], nullptr, 10));
+			}
+			else if (strcmp(arg, "--allow-shutdown") == 0)
+			{
+				allowShutdown = true;
+			}
+			else if (strcmp(arg, "--loadgen") == 0 && i + 2 < argc)
+			{
+				loadGenerator.port = uint16(strtoul(argv[++i], nullptr, 10));
+				loadGenerator.queriesPath = argv[++i];
+			}
+			else if (strcmp(arg, "--connections") == 0 && hasNext)
+			{
+				loadGenerator.connections = uint32(strtoul(argv[++i], nullptr, 10));
+			}
+			else if (strcmp(arg, "--requests") == 0 && hasNext)
+			{
+				loadGenerator.requestsPerConnection = uint32(strtoul(argv[++i], nullptr, 10));
+			}
+			else if (strcmp(arg, "--threads") == 0 && hasNext)
+			{
+				threadCount = uint32(strtoul(argv[++i], nullptr, 10));
+			}
+			else if (strcmp(arg, "--trace") == 0 && hasNext)
+			{
+				tracePath = argv[++i];
+			}
+			else if (strcmp(arg, "--profile") == 0)
+			{
+				printProfile = true;
+			}
+			else if (strcmp(arg, "--memory-report") == 0)
+			{
+				memoryReport = true;
+			}
+			else
+			{
+				std::cout << "Unknown or incomplete argument " << arg << std::endl;
+				std::cout << "Usage: generator [--dump <path>]... [--batch <queries.txt> <results.jsonl>] [--serve <port> [--query-timeout <us>] [--query-work <candidates>] [--allow-shutdown]] [--threads <count>] [--profile] [--trace <trace.json>] [--memory-report]" << std::endl;
+				std::cout << "       generator --loadgen <port> <queries.txt> [--connections <count>] [--requests <per connection>]" << std::endl;
+				return false;
+			}
+		}
+
+		if (dumpPaths.empty())
+			dumpPaths.push_back("C:\\Users\\James\\Desktop\\DiscoDump\\Disco Elysium.json");
+
+		return true;
+	}
+};
+
+// Reports on the whole run whichever mode returns, once the thread pool has been joined
+struct ProfileOutput
+{
+	const CommandLine& commandLine;
+
+	~ProfileOutput()
+	{
+		if (commandLine.printProfile)
+		{
+			std::cout << std::endl;
+			PrintProfileSummary(std::cout);
+		}
+
+		if (commandLine.tracePath)
+		{
+			if (WriteChromeTrace(commandLine.tracePath))
+				std::cout << "Wrote trace to " << commandLine.tracePath << "." << std::endl;
+			else
+				std::cout << "Failed to write trace to " << commandLine.tracePath << std::endl;
+		}
+	}
+};
+
+int main(int argc, char* argv[])
+{
+	::SetConsoleOutputCP(CP_UTF8);
+	setvbuf(stdout, nullptr, _IOFBF, 1000);
+
+	CommandLine commandLine;
+	if (!commandLine.Parse(argc, argv))
+		return 1;
+
+	// Per-scope events are only kept when there's a trace to write them to
+	SetProfileEventRecording(commandLine.tracePath != nullptr);
+	ProfileOutput profileOutput {commandLine};
+
+	// The load generator only talks to a running server, it doesn't need the dump
+	if (commandLine.loadGenerator.queriesPath)
+	{
+		std::cout << "Running load generator with " << commandLine.loadGenerator.connections << " connections... ";
+		std::cout.flush();
+
+		LoadGeneratorResult result;
+		if (!RunLoadGenerator(commandLine.loadGenerator, result))
+		{
+			std::cout << "Failed!" << std::endl;
+			return 1;
+		}
+
+		std::cout << "Done! " << result.requestsCompleted << " requests in " << result.wallSeconds << "s (" << result.queriesPerSecond << " queries/s), " << result.failedConnections << " failed connections." << std::endl;
+		std::cout << "Latency p50 " << result.latency.p50Us << "us, p99 " << result.latency.p99Us << "us, max " << result.latency.maxUs << "us." << std::endl;
+		return 0;
+	}
+
+	ThreadPool threads(commandLine.threadCount);
+	SetMemoryReportEnabled(commandLine.memoryReport);
+
+	CorpusSet corpora;
+	if (!corpora.LoadAll(commandLine.dumpPaths, threads, &std::cout))
+		return 1;
+
+	// Several dumps load without a log, so they only get this one
+	if (commandLine.memoryReport && corpora.GetCount() > 1)
+		PrintMemoryReport(std::cout, "loading every dump");
+
+	// Batch and server modes work on the first dump
+	if (commandLine.batchInput)
+	{
+		std::cout << "Running batch queries on " << threads.GetThreadCount() << " threads... ";
+		std::cout.flush();
+
+		BatchQueryStats stats;
+		if (!RunBatchQueries(corpora.Get(0), threads, commandLine.batchInput, commandLine.batchOutput, stats))
+		{
+			std::cout << "Failed!" << std::endl;
+			return 1;
+		}
+
+		double queriesPerSecond = stats.wallSeconds > 0.0 ? stats.queryCount / stats.wallSeconds : 0.0;
+		std::cout << "Done! " << stats.queryCount << " queries, " << stats.matchCount << " matches in " << stats.wallSeconds << "s (" << queriesPerSecond << " queries/s)." << std::endl;
+		std::cout << "Latency p50 " << stats.latency.p50Us << "us, p99 " << stats.latency.p99Us << "us, max " << stats.latency.maxUs << "us." << std::endl;
+		return 0;
+	}
+
+	if (commandLine.servePort != 0)
+	{
+		LiveCorpus liveCorpus;
+		liveCorpus.Publish(corpora.Release(0));
+
+		QueryServer server(liveCorpus, commandLine.dumpPaths[0]);
+		if (!server.Listen(commandLine.servePort))
+		{
+			std::cout << "Failed to listen on port " << commandLine.servePort << std::endl;
+			return 1;
+		}
+
+		server.SetQueryBudget(std::chrono::microseconds(commandLine.queryTimeoutUs), commandLine.queryMaxCandidates);
+		server.SetAllowShutdown(commandLine.allowShutdown);
+
+		uint32 loopCount = commandLine.threadCount != 0 ? commandLine.threadCount : ThreadPool::GetHardwareThreadCount();
+		std::cout << "Serving on 127.0.0.1:" << commandLine.servePort << " with " << loopCount << " event loops." << std::endl;
+
+		server.Run(loopCount);
+
+		std::cout << "Server stopped after " << server.GetConnectionsAccepted() << " connections and " << server.GetQueriesServed() << " queries." << std::endl;
+		return 0;
+	}
+
+	// Graph queries in the REPL work on the first dump
+	GraphQueries graphQueries(corpora.Get(0).graph, corpora.Get(0).conversations, corpora.Get(0).dialogEntries);
+	graphQueries.Precompute(threads);
 
 	std::string input;
 	std::cout << "Ready to search:" << std::endl;
@@ -120,16 +655,45 @@ int main()
 	{
 		std::getline(std::cin, input);
 
-		auto matches = hasher.LookupWord(input.c_str());
-		for (ManagedString& match : matches)
+		if (input == "cachestats")
+		{
+			QueryCache::Stats stats = corpora.Get(0).index.GetCacheStats();
+			std::cout << "Cache: " << stats.hits << " hits, " << stats.misses << " misses, " << stats.evictions << " evictions, " << stats.entryCount << " entries holding " << stats.storedMatches << " matches." << std::endl;
+			std::cout << std::endl;
+			continue;
+		}
+
+		if (RunGraphCommand(input, corpora.Get(0), graphQueries, threads) || RunConditionCommand(input, corpora.Get(0), threads) || RunScanCommand(input, corpora.Get(0)) || RunDuplicateCommand(input, corpora.Get(0)) || RunSimilarityCommand(input, corpora.Get(0)))
+		{
+			std::cout << std::endl;
+			continue;
+		}
+
+		if (HasFacetFilters(input))
 		{
-			if (match.GetLookbackType() == ObjectType::DialogEntry)
+			for (uint32 i = 0; i < corpora.GetCount(); ++i)
 			{
-				std::cout << match.CStr() << std::endl;
+				if (corpora.GetCount() > 1)
+					std::cout << "[" << corpora.Get(i).name << "]" << std::endl;
+
+				RunFacetedSearch(input, corpora.Get(i));
 			}
+
+			std::cout << std::endl;
+			continue;
 		}
 
-		std::cout << std::endl;
+		// Matches go out a buffer at a time instead of being flushed line by line
+		std::cout.flush();
+		BufferedWriter output(stdout);
+
+		auto matches = corpora.Lookup(input.c_str(), threads);
+		for (FederatedMatch& match : matches)
+		{
+			PrintMatch(output, corpora.Get(match.corpusIndex), match.match, input, corpora.GetCount() > 1);
+		}
+
+		output.Put('\n');
 	}
 
 	return 0;
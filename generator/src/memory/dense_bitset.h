@@ -0,0 +1,145 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include <heart/debug/assert.h>
+#include <heart/types.h>
+
+#include <heart/stl/vector.h>
+
+#include <bit>
+
+// Fixed-size bitset backed by 64-bit words, sized at runtime
+class DenseBitset
+{
+	hrt::vector<uint64> m_words;
+	uint32 m_size = 0;
+
+public:
+	DenseBitset() = default;
+
+	explicit DenseBitset(uint32 size)
+	{
+		Resize(size);
+	}
+
+	void Resize(uint32 size)
+	{
+		m_size = size;
+		m_words.assign((size_t(size) + 63) / 64, 0);
+	}
+
+	uint32 GetSize() const
+	{
+		return m_size;
+	}
+
+	size_t GetWordCount() const
+	{
+		return m_words.size();
+	}
+
+	uint64* GetWords()
+	{
+		return m_words.data();
+	}
+
+	const uint64* GetWords() const
+	{
+		return m_words.data();
+	}
+
+	void Set(uint32 index)
+	{
+		HEART_ASSERT(index < m_size);
+		m_words[index >> 6] |= uint64(1) << (index & 63);
+	}
+
+	void Reset(uint32 index)
+	{
+		HEART_ASSERT(index < m_size);
+		m_words[index >> 6] &= ~(uint64(1) << (index & 63));
+	}
+
+	bool Test(uint32 index) const
+	{
+		HEART_ASSERT(index < m_size);
+		return (m_words[index >> 6] >> (index & 63)) & 1;
+	}
+
+	void ResetAll()
+	{
+		for (uint64& word : m_words)
+		{
+			word = 0;
+		}
+	}
+
+	void SetAll()
+	{
+		for (uint64& word : m_words)
+		{
+			word = ~uint64(0);
+		}
+
+		// Keep the bits past the end clear so Count() and ForEachSet() stay exact
+		if (m_size & 63)
+			m_words.back() = (uint64(1) << (m_size & 63)) - 1;
+	}
+
+	uint32 Count() const
+	{
+		uint32 count = 0;
+		for (uint64 word : m_words)
+		{
+			count += uint32(std::popcount(word));
+		}
+
+		return count;
+	}
+
+	DenseBitset& operator&=(const DenseBitset& other)
+	{
+		HEART_ASSERT(other.m_size == m_size);
+		for (size_t i = 0; i < m_words.size(); ++i)
+		{
+			m_words[i] &= other.m_words[i];
+		}
+
+		return *this;
+	}
+
+	DenseBitset& operator|=(const DenseBitset& other)
+	{
+		HEART_ASSERT(other.m_size == m_size);
+		for (size_t i = 0; i < m_words.size(); ++i)
+		{
+			m_words[i] |= other.m_words[i];
+		}
+
+		return *this;
+	}
+
+	// Calls func(index) for every set bit, in increasing order
+	template <typename F>
+	void ForEachSet(F&& func) const
+	{
+		for (size_t wordIndex = 0; wordIndex < m_words.size(); ++wordIndex)
+		{
+			uint64 word = m_words[wordIndex];
+			while (word != 0)
+			{
+				uint32 bit = uint32(std::countr_zero(word));
+				func(uint32(wordIndex * 64 + bit));
+				word &= word - 1;
+			}
+		}
+	}
+};
@@ -0,0 +1,109 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include <heart/debug/assert.h>
+#include <heart/types.h>
+
+#include <heart/stl/vector.h>
+
+#include <bit>
+#include <type_traits>
+
+// Open addressing map from an integer id to a dense uint32 index, built once at load
+// time. Keys and values sit side by side in one flat array and collisions probe linearly,
+// so a lookup is usually one cache line. A UINT32_MAX value marks an empty slot.
+template <typename KeyT>
+class FlatIdMap
+{
+	static_assert(std::is_integral_v<KeyT>);
+
+public:
+	static constexpr uint32 NotFound = UINT32_MAX;
+
+private:
+	struct Slot
+	{
+		KeyT key;
+		uint32 value;
+	};
+
+	hrt::vector<Slot> m_slots;
+	uint64 m_mask = 0;
+	uint32 m_count = 0;
+
+	static uint64 Mix(KeyT key)
+	{
+		// murmur3's 64-bit finalizer, ids are often sequential so they need spreading out
+		uint64 h = uint64(key);
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ull;
+		h ^= h >> 33;
+		return h;
+	}
+
+public:
+	// Sizes the table for count keys at no more than half full. Clears anything already in it.
+	void Reserve(uint32 count)
+	{
+		uint64 capacity = std::bit_ceil(uint64(count) * 2 + 1);
+		m_slots.assign(capacity, Slot {KeyT(), NotFound});
+		m_mask = capacity - 1;
+		m_count = 0;
+	}
+
+	// Returns false (and keeps the existing value) if the key is already present
+	bool Insert(KeyT key, uint32 value)
+	{
+		HEART_ASSERT(value != NotFound);
+		// Reserve() wasn't called with enough room
+		HEART_ASSERT(uint64(m_count + 1) * 2 <= m_slots.size());
+
+		for (uint64 i = Mix(key) & m_mask; true; i = (i + 1) & m_mask)
+		{
+			Slot& slot = m_slots[i];
+			if (slot.value == NotFound)
+			{
+				slot.key = key;
+				slot.value = value;
+				++m_count;
+				return true;
+			}
+
+			if (slot.key == key)
+				return false;
+		}
+	}
+
+	uint32 Find(KeyT key) const
+	{
+		if (m_slots.empty())
+			return NotFound;
+
+		for (uint64 i = Mix(key) & m_mask; true; i = (i + 1) & m_mask)
+		{
+			const Slot& slot = m_slots[i];
+			if (slot.value == NotFound || slot.key == key)
+				return slot.value;
+		}
+	}
+
+	uint32 GetCount() const
+	{
+		return m_count;
+	}
+
+	size_t GetMemoryUsage() const
+	{
+		return m_slots.size() * sizeof(Slot);
+	}
+};
@@ -9,14 +9,23 @@
 
 #include "memory/hash_lookup.h"
 
+#include "profiling/profiler.h"
+#include "threading/cancellation_token.h"
+#include "threading/thread_pool.h"
+
 #include <heart/debug/assert.h>
 #include <heart/hash/murmur.h>
 #include <heart/scope_exit.h>
 
-#include <set>
+#include <algorithm>
+#include <functional>
+#include <queue>
 
 namespace
 {
+	// Chunks smaller than this aren't worth a job of their own
+	constexpr size_t MinCompileChunkBytes = size_t(256) << 10;
+
 	// The strings are in UTF8
 	// Why
 	template <typename IterT>
@@ -107,14 +116,19 @@ namespace
 		return result;
 	}
 
+	// Finds the first occurrence of needle, comparing whole codepoints. On success, outBegin
+	// and outEnd are byte offsets into haystack.
 	template <typename T = std::string_view>
-	bool Contains(T haystack, T needle, bool insensitive = true)
+	bool FindFirst(T haystack, T needle, bool insensitive, size_t& outBegin, size_t& outEnd)
 	{
 		if (needle.size() > haystack.size())
 			return false;
 
 		if (needle.size() < 1)
+		{
+			outBegin = outEnd = 0;
 			return true;
+		}
 
 		auto haystackSearchStop = haystack.end() - (needle.size() - 1);
 		HEART_ASSERT(haystackSearchStop > haystack.begin() && haystackSearchStop <= haystack.end());
@@ -136,18 +150,121 @@ namespace
 			}
 
 			if (needleIter == needle.end())
+			{
+				outBegin = size_t(haystackPos - haystack.begin());
+				outEnd = size_t(haystackIter - haystack.begin());
 				return true;
+			}
 
 			GetCodepoint(haystackPos, haystack.end());
 		}
 
 		return false;
 	}
+
+	template <typename T = std::string_view>
+	bool Contains(T haystack, T needle, bool insensitive = true)
+	{
+		size_t begin = 0, end = 0;
+		return FindFirst(haystack, needle, insensitive, begin, end);
+	}
+
+	template <typename StringT>
+	void AppendCodepoint(StringT& target, int32 codepoint)
+	{
+		if (codepoint < 0x80)
+		{
+			target.push_back(char(codepoint));
+		}
+		else if (codepoint < 0x800)
+		{
+			target.push_back(char(0b11000000 | (codepoint >> 6)));
+			target.push_back(char(0b10000000 | (codepoint & 0b00111111)));
+		}
+		else if (codepoint < 0x10000)
+		{
+			target.push_back(char(0b11100000 | (codepoint >> 12)));
+			target.push_back(char(0b10000000 | ((codepoint >> 6) & 0b00111111)));
+			target.push_back(char(0b10000000 | (codepoint & 0b00111111)));
+		}
+		else
+		{
+			target.push_back(char(0b11110000 | (codepoint >> 18)));
+			target.push_back(char(0b10000000 | ((codepoint >> 12) & 0b00111111)));
+			target.push_back(char(0b10000000 | ((codepoint >> 6) & 0b00111111)));
+			target.push_back(char(0b10000000 | (codepoint & 0b00111111)));
+		}
+	}
+
+	// Looks at the token and the clock only every so often, they cost about as much as a
+	// short verification. The work limit is exact.
+	class BudgetCheck
+	{
+		static constexpr uint32 CheckInterval = 64;
+
+		const QueryBudget& m_budget;
+		bool m_hasDeadline;
+
+		// Starts due, so a query that's already cancelled or late doesn't verify anything
+		uint32 m_untilCheck = 0;
+
+	public:
+		explicit BudgetCheck(const QueryBudget& budget) :
+			m_budget(budget),
+			m_hasDeadline(budget.deadline != std::chrono::steady_clock::time_point::max())
+		{
+		}
+
+		QueryStop Check(uint32 verifiedCount)
+		{
+			if (m_budget.maxCandidates != 0 && verifiedCount >= m_budget.maxCandidates)
+				return QueryStop::WorkLimit;
+
+			if (m_untilCheck-- != 0)
+				return QueryStop::Completed;
+
+			m_untilCheck = CheckInterval - 1;
+			if (m_budget.cancellation && m_budget.cancellation->IsCancelled())
+				return QueryStop::Cancelled;
+
+			if (m_hasDeadline && std::chrono::steady_clock::now() >= m_budget.deadline)
+				return QueryStop::Deadline;
+
+			return QueryStop::Completed;
+		}
+	};
+
+	std::u8string_view TrimWhitespace(std::u8string_view str)
+	{
+		auto isSpace = [](char8_t c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; };
+
+		while (!str.empty() && isSpace(str.front()))
+			str.remove_prefix(1);
+		while (!str.empty() && isSpace(str.back()))
+			str.remove_suffix(1);
+
+		return str;
+	}
+
+	// Builds the cache key for a query: the options, then the query exactly as typed. Words
+	// are hashed with their case intact, so "Kim" and "kim" can find different candidates
+	// even when matching ignores case, and mustn't share an entry.
+	hrt::string MakeCacheKey(std::u8string_view query, LookupOptions options)
+	{
+		hrt::string result;
+		result.reserve(query.size() + 1);
+		result.push_back(options.caseInsensitive ? 'i' : 's');
+		result.append((const char*)query.data(), query.size());
+		return result;
+	}
 }
 
-void HashLookup::CrunchSingleString(const char* str, PoolIndex index)
+void HashLookup::CrunchSingleString(const char* str, PoolIndex index, hrt::vector<std::pair<HashType, PoolIndex>>& outPostings)
 {
 	std::u8string_view view((char8_t*)str);
+	PROFILE_COUNT(BytesTokenized, view.size());
+
+	size_t firstPosting = outPostings.size();
 	auto iterator = view.begin();
 	while (iterator != view.end())
 	{
@@ -155,81 +272,343 @@ void HashLookup::CrunchSingleString(const char* str, PoolIndex index)
 		if (word.size() > 0)
 		{
 			auto hash = HeartMurmurHash3(word);
-			m_lookup.emplace(hash, index);
+			outPostings.emplace_back(HashType(hash), index);
 		}
 	}
+
+	PROFILE_COUNT(Postings, outPostings.size() - firstPosting);
 }
 
-hrt::vector<HashLookup::PoolIndex> HashLookup::LookupSingleWord(std::u8string_view word)
+void HashLookup::CompileChunkPostings(CompileChunk& chunk) const
 {
-	hrt::vector<PoolIndex> result;
-	HashType hash = HeartMurmurHash3(word);
+	PROFILE_SCOPE("HashLookup::CompileChunkPostings");
 
-	auto&& [begin, end] = m_lookup.equal_range(hash);
-	while (begin != end)
+	const uint8* bufferStart = m_pool->m_blob;
+	const uint8* reader = bufferStart + chunk.begin;
+	const uint8* chunkEnd = bufferStart + chunk.end;
+	while (reader < chunkEnd)
 	{
-		result.push_back(begin->second);
-		++begin;
+		auto layout = (const ManagedStringPool::StringLayout*)reader;
+		auto str = &layout->firstCharacter;
+		CrunchSingleString(str, PoolIndex(reader - bufferStart), chunk.postings);
+
+		reader = (const uint8*)(str + strlen(str)) + 1;
 	}
 
-	return result;
+	// Stable, so each word's postings stay in pool order
+	std::stable_sort(chunk.postings.begin(), chunk.postings.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
 }
 
-uint32 HashLookup::Compile()
+uint32 HashLookup::Compile(const ManagedStringPool& pool, ThreadPool* threads)
 {
-	auto& pool = ManagedStringPool::Get();
+	PROFILE_SCOPE("HashLookup::Compile");
+
 	if (!HEART_CHECK(pool.m_blob))
 		return 0;
 
-	uint8* bufferStart = pool.m_blob;
-	uint8* bufferEnd = bufferStart + pool.m_size;
-	PoolIndex poolIndex = 0;
+	m_pool = &pool;
 
-	uint8* reader = bufferStart;
-	while (reader < bufferEnd)
+	// Anything cached refers to the previous build
+	m_lookup.clear();
+	m_cache.Invalidate();
+
+	// A few chunks per worker so uneven strings still balance, one chunk without workers
+	size_t chunkBytes = pool.m_size;
+	if (threads)
+		chunkBytes = std::max(pool.m_size / (size_t(threads->GetThreadCount()) * 4), MinCompileChunkBytes);
+
+	hrt::vector<CompileChunk> chunks;
 	{
-		auto layout = (ManagedStringPool::StringLayout*)reader;
-		auto str = &layout->firstCharacter;
-		auto index = PoolIndex(reader - bufferStart);
+		const uint8* bufferStart = pool.m_blob;
+		const uint8* bufferEnd = bufferStart + pool.m_size;
+		const uint8* reader = bufferStart;
+		PoolIndex chunkStart = 0;
+		while (reader < bufferEnd)
+		{
+			auto layout = (const ManagedStringPool::StringLayout*)reader;
+			auto str = &layout->firstCharacter;
+			reader = (const uint8*)(str + strlen(str)) + 1;
 
-		CrunchSingleString(str, index);
+			PoolIndex position = PoolIndex(reader - bufferStart);
+			if (position - chunkStart >= chunkBytes || reader == bufferEnd)
+			{
+				CompileChunk& chunk = chunks.emplace_back();
+				chunk.begin = chunkStart;
+				chunk.end = position;
+				chunkStart = position;
+			}
+		}
+	}
 
-		auto len = strlen(str);
-		reader = (uint8*)(str + len) + 1;
+	if (threads)
+	{
+		threads->ParallelFor(uint32(chunks.size()), [&](uint32 i) { CompileChunkPostings(chunks[i]); });
+	}
+	else
+	{
+		for (CompileChunk& chunk : chunks)
+		{
+			CompileChunkPostings(chunk);
+		}
 	}
 
+	MergeChunks(chunks);
 	return uint32(m_lookup.size());
 }
 
-hrt::vector<ManagedString> HashLookup::LookupWord(const char* word)
+void HashLookup::TokenizePart(const ManagedStringPool& part, PartPostings& outPostings)
 {
-	std::set<uint32> potentialMatches;
-	hrt::vector<ManagedString> result;
+	PROFILE_SCOPE("HashLookup::TokenizePart");
 
-	std::u8string_view str((char8_t*)word);
-	auto iterator = str.begin();
-	while (iterator != str.end())
+	if (!HEART_CHECK(part.m_builder.has_value()))
+		return;
+
+	// The same offsets Push handed out, relative to the part
+	PoolIndex index = 0;
+	for (const auto& entry : part.m_builder->storage)
 	{
-		auto word = FindNextWord<std::u8string_view>(iterator, str.end());
+		CrunchSingleString(entry.value.c_str(), index, outPostings.m_postings);
+		index += PoolIndex(sizeof(LookbackHelper) + entry.value.size() + 1);
+	}
+
+	std::stable_sort(outPostings.m_postings.begin(), outPostings.m_postings.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+}
+
+uint32 HashLookup::CompileParts(const ManagedStringPool& pool, std::span<PartPostings> parts, std::span<const uint32> offsets, ThreadPool* threads)
+{
+	PROFILE_SCOPE("HashLookup::CompileParts");
+
+	if (!HEART_CHECK(pool.m_blob) || !HEART_CHECK(parts.size() == offsets.size()))
+		return 0;
+
+	m_pool = &pool;
+
+	m_lookup.clear();
+	m_cache.Invalidate();
+
+	// Rebasing keeps each part sorted, and the parts are already in pool order
+	hrt::vector<CompileChunk> chunks(parts.size());
+	auto rebase = [&](uint32 i) {
+		chunks[i].postings = std::move(parts[i].m_postings);
+		for (auto& posting : chunks[i].postings)
+		{
+			posting.second += offsets[i];
+		}
+	};
 
+	if (threads)
+	{
+		threads->ParallelFor(uint32(chunks.size()), rebase);
+	}
+	else
+	{
+		for (uint32 i = 0; i < uint32(chunks.size()); ++i)
+		{
+			rebase(i);
+		}
+	}
+
+	MergeChunks(chunks);
+	return uint32(m_lookup.size());
+}
+
+void HashLookup::MergeChunks(hrt::vector<CompileChunk>& chunks)
+{
+	// Earlier chunks first on ties, so every posting lands at the end of the map in the
+	// same order inserting them one by one would have left them
+	typedef std::pair<HashType, uint32> Head;
+	std::priority_queue<Head, hrt::vector<Head>, std::greater<Head>> heads;
+	hrt::vector<size_t> cursors(chunks.size(), 0);
+	for (uint32 i = 0; i < uint32(chunks.size()); ++i)
+	{
+		if (!chunks[i].postings.empty())
+			heads.emplace(chunks[i].postings[0].first, i);
+	}
+
+	while (!heads.empty())
+	{
+		uint32 chunkIndex = heads.top().second;
+		heads.pop();
+
+		CompileChunk& chunk = chunks[chunkIndex];
+		const auto& posting = chunk.postings[cursors[chunkIndex]++];
+		m_lookup.emplace_hint(m_lookup.end(), posting.first, posting.second);
+
+		if (cursors[chunkIndex] < chunk.postings.size())
+			heads.emplace(chunk.postings[cursors[chunkIndex]].first, chunkIndex);
+	}
+}
+
+const char* GetQueryStopName(QueryStop stop)
+{
+	switch (stop)
+	{
+	case QueryStop::Completed: return "completed";
+	case QueryStop::Deadline: return "deadline";
+	case QueryStop::WorkLimit: return "work limit";
+	case QueryStop::Cancelled: return "cancelled";
+	}
+
+	return "";
+}
+
+hrt::vector<HashLookup::PoolIndex> HashLookup::FindMatches(std::u8string_view query, LookupOptions options, const QueryBudget& budget, QueryStop& outStop) const
+{
+	PROFILE_SCOPE("HashLookup::FindMatches");
+
+	// Each word's postings are in pool order already, so merging them visits the candidates
+	// in order without collecting them first, and each one is verified as it comes up
+	typedef decltype(m_lookup)::const_iterator PostingIter;
+	hrt::vector<std::pair<PostingIter, PostingIter>> postingLists;
+
+	auto iterator = query.begin();
+	while (iterator != query.end())
+	{
+		auto word = FindNextWord<std::u8string_view>(iterator, query.end());
 		if (word.size() > 0)
 		{
-			hrt::vector<uint32> matches = LookupSingleWord(word);
-			potentialMatches.insert(matches.begin(), matches.end());
+			auto range = m_lookup.equal_range(HashType(HeartMurmurHash3(word)));
+			if (range.first != range.second)
+				postingLists.push_back(range);
+		}
+	}
+
+	BudgetCheck budgetCheck(budget);
+	hrt::vector<PoolIndex> result;
+	uint32 verifiedCount = 0;
+	outStop = QueryStop::Completed;
+
+	while (true)
+	{
+		bool anyLeft = false;
+		PoolIndex candidate = 0;
+		for (const auto& [begin, end] : postingLists)
+		{
+			if (begin != end && (!anyLeft || begin->second < candidate))
+			{
+				candidate = begin->second;
+				anyLeft = true;
+			}
+		}
+
+		if (!anyLeft)
+			break;
+
+		// Skip it in every list, along with repeats of a word within the same string
+		for (auto& [begin, end] : postingLists)
+		{
+			while (begin != end && begin->second == candidate)
+				++begin;
 		}
+
+		outStop = budgetCheck.Check(verifiedCount);
+		if (outStop != QueryStop::Completed)
+			break;
+
+		++verifiedCount;
+		const char* s = m_pool->GetString(candidate);
+		if (Contains(std::u8string_view((char8_t*)s), query, options.caseInsensitive))
+			result.push_back(candidate);
 	}
 
-	for (uint32 potentialIndex : potentialMatches)
+	PROFILE_COUNT(CandidatesVerified, verifiedCount);
+	PROFILE_COUNT(CandidatesAccepted, result.size());
+	if (outStop != QueryStop::Completed)
+		PROFILE_COUNT(QueriesCutShort, 1);
+
+	return result;
+}
+
+bool HashLookup::FindMatchSpan(std::string_view text, std::string_view query, LookupOptions options, MatchSpan& outSpan)
+{
+	std::u8string_view needle = TrimWhitespace(std::u8string_view((const char8_t*)query.data(), query.size()));
+	if (needle.empty())
+		return false;
+
+	size_t begin = 0, end = 0;
+	if (!FindFirst(std::u8string_view((const char8_t*)text.data(), text.size()), needle, options.caseInsensitive, begin, end))
+		return false;
+
+	outSpan.offset = uint32(begin);
+	outSpan.length = uint32(end - begin);
+	return true;
+}
+
+void HashLookup::HashWords(std::string_view text, LookupOptions options, hrt::vector<uint32>& outHashes)
+{
+	std::u8string_view view((const char8_t*)text.data(), text.size());
+	hrt::string folded;
+
+	auto iterator = view.begin();
+	while (iterator != view.end())
 	{
-		const char* s = ManagedStringPool::Get().GetString(potentialIndex);
+		auto word = FindNextWord<std::u8string_view>(iterator, view.end());
+		if (word.size() == 0)
+			continue;
 
-		if (Contains(std::u8string_view((char8_t*)s), str))
+		if (!options.caseInsensitive)
 		{
-			ManagedString& match = result.emplace_back();
-			match.m_initialized = true;
-			match.m_index = potentialIndex;
-			match.m_size = uint16(strlen(s));
+			outHashes.push_back(HeartMurmurHash3(word));
+			continue;
 		}
+
+		folded.clear();
+		for (auto wordIter = word.begin(); wordIter != word.end(); ++wordIter)
+		{
+			AppendCodepoint(folded, int32(towlower(GetCodepoint(wordIter, word.end()))));
+		}
+
+		outHashes.push_back(HeartMurmurHash3(std::u8string_view((const char8_t*)folded.data(), folded.size())));
+	}
+}
+
+hrt::vector<ManagedString> HashLookup::LookupWord(const char* word, LookupOptions options) const
+{
+	return LookupWord(word, QueryBudget {}, options).matches;
+}
+
+LookupResult HashLookup::LookupWord(const char* word, const QueryBudget& budget, LookupOptions options) const
+{
+	PROFILE_SCOPE("LookupWord");
+	PROFILE_COUNT(Lookups, 1);
+
+	LookupResult result;
+
+	std::u8string_view str = TrimWhitespace(std::u8string_view((char8_t*)word));
+	if (str.empty())
+		return result;
+
+	hrt::string key = MakeCacheKey(str, options);
+
+	hrt::vector<PoolIndex> matches;
+	if (!m_cache.Find(key, matches))
+	{
+		matches = FindMatches(str, options, budget, result.stop);
+
+		// A partial result would be served as complete to everyone after
+		if (!result.IsPartial())
+			m_cache.Insert(key, matches);
+	}
+	else
+	{
+		PROFILE_COUNT(CacheHits, 1);
+
+#ifdef _DEBUG
+		// A warm answer has to be the one a cold lookup would give
+		QueryStop stop = QueryStop::Completed;
+		HEART_ASSERT(FindMatches(str, options, QueryBudget {}, stop) == matches);
+#endif
+	}
+
+	result.matches.reserve(matches.size());
+	for (PoolIndex index : matches)
+	{
+		const char* s = m_pool->GetString(index);
+
+		ManagedString& match = result.matches.emplace_back();
+		match.m_initialized = true;
+		match.m_index = index;
+		match.m_size = uint16(strlen(s));
 	}
 
 	return result;
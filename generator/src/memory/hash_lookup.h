@@ -10,27 +10,149 @@
 #pragma once
 
 #include "memory/managed_string.h"
+#include "memory/memory_tracker.h"
+#include "memory/monotonic_arena.h"
+#include "memory/query_cache.h"
 
 #include <heart/types.h>
 
 #include <heart/stl/vector.h>
 
+#include <chrono>
+#include <functional>
 #include <map>
+#include <span>
 #include <string_view>
+#include <utility>
+
+class ThreadPool;
+
+struct LookupOptions
+{
+	bool caseInsensitive = true;
+};
+
+class CancellationToken;
+
+// Limits on a single query, all optional. They're checked every few candidates while the
+// postings are merged and verified, so a query can overrun its deadline, but not by much.
+struct QueryBudget
+{
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+	// Candidates to verify before giving up, 0 for no limit
+	uint32 maxCandidates = 0;
+
+	const CancellationToken* cancellation = nullptr;
+
+	static QueryBudget FromTimeout(std::chrono::microseconds timeout)
+	{
+		QueryBudget budget;
+		budget.deadline = std::chrono::steady_clock::now() + timeout;
+		return budget;
+	}
+};
+
+enum class QueryStop : uint8
+{
+	Completed,
+	Deadline,
+	WorkLimit,
+	Cancelled,
+};
+
+const char* GetQueryStopName(QueryStop stop);
+
+struct LookupResult
+{
+	hrt::vector<ManagedString> matches;
+	QueryStop stop = QueryStop::Completed;
+
+	// Candidates are verified in pool order, so a partial result still holds only real
+	// matches, and every one of them up to where it stopped
+	bool IsPartial() const
+	{
+		return stop != QueryStop::Completed;
+	}
+};
+
+// Where a query sits within a matched string, in bytes
+struct MatchSpan
+{
+	uint32 offset = 0;
+	uint32 length = 0;
+};
 
 class HashLookup
 {
 	typedef uint32 HashType;
 	typedef uint32 PoolIndex;
+	typedef std::pair<const HashType, PoolIndex> Posting;
+
+	const ManagedStringPool* m_pool = nullptr;
+
+	// Millions of postings, all freed with the lookup, so the nodes come from an arena.
+	// Declared before the map so it outlives it. Recompiling doesn't free the old nodes.
+	MonotonicArena m_arena {MemoryTag::HashLookup};
+
+	std::multimap<HashType, PoolIndex, std::less<HashType>, ArenaAllocator<Posting>> m_lookup {ArenaAllocator<Posting>(m_arena)};
+
+	mutable QueryCache m_cache;
+
+	// A run of whole strings from the pool's blob, tokenized on its own
+	struct CompileChunk
+	{
+		PoolIndex begin = 0;
+		PoolIndex end = 0;
+		hrt::vector<std::pair<HashType, PoolIndex>> postings;
+	};
 
-	std::multimap<HashType, PoolIndex> m_lookup;
+	static void CrunchSingleString(const char* str, PoolIndex index, hrt::vector<std::pair<HashType, PoolIndex>>& outPostings);
 
-	void CrunchSingleString(const char* str, PoolIndex index);
+	void CompileChunkPostings(CompileChunk& chunk) const;
 
-	hrt::vector<PoolIndex> LookupSingleWord(std::u8string_view word);
+	// Merges the sorted chunks into the map, earlier chunks first on ties
+	void MergeChunks(hrt::vector<CompileChunk>& chunks);
+
+	hrt::vector<PoolIndex> FindMatches(std::u8string_view query, LookupOptions options, const QueryBudget& budget, QueryStop& outStop) const;
 
 public:
-	uint32 Compile();
+	// One part's postings, tokenized while the pool is still being built and indexed
+	// relative to that part
+	class PartPostings
+	{
+		friend class HashLookup;
+
+		hrt::vector<std::pair<HashType, PoolIndex>> m_postings;
+	};
+
+	// Indexes every string in a finalized pool. The pool must outlive the lookup. With a
+	// thread pool, the blob is tokenized in chunks on the workers and merged in order.
+	uint32 Compile(const ManagedStringPool& pool, ThreadPool* threads = nullptr);
+
+	// Tokenizes a part of a pool before it's finalized, see FinalizeFromParts
+	static void TokenizePart(const ManagedStringPool& part, PartPostings& outPostings);
+
+	// Indexes a pool finalized from parts that were all tokenized already, so all that's
+	// left is merging. offsets are the ones FinalizeFromParts handed back.
+	uint32 CompileParts(const ManagedStringPool& pool, std::span<PartPostings> parts, std::span<const uint32> offsets, ThreadPool* threads = nullptr);
+
+	// Safe to call from several threads at once, as long as nothing is compiling
+	hrt::vector<ManagedString> LookupWord(const char* word, LookupOptions options = {}) const;
+
+	// Stops early once the budget runs out. Only complete results are cached.
+	LookupResult LookupWord(const char* word, const QueryBudget& budget, LookupOptions options = {}) const;
+
+	// Finds the first place query occurs in text, compared the same way lookups verify
+	// their candidates. Only needed for the matches that actually get shown.
+	static bool FindMatchSpan(std::string_view text, std::string_view query, LookupOptions options, MatchSpan& outSpan);
+
+	// Appends a hash for every word in text, split the same way the index splits them, and
+	// case-folded first when the options say so
+	static void HashWords(std::string_view text, LookupOptions options, hrt::vector<uint32>& outHashes);
 
-	hrt::vector<ManagedString> LookupWord(const char* word);
+	QueryCache::Stats GetCacheStats() const
+	{
+		return m_cache.GetStats();
+	}
 };
@@ -9,6 +9,9 @@
 
 #include "memory/managed_string.h"
 
+#include "profiling/profiler.h"
+#include "threading/thread_pool.h"
+
 #include <heart/hash/string_hash.h>
 
 ManagedString::ManagedString() :
@@ -18,47 +21,56 @@ ManagedString::ManagedString() :
 {
 }
 
-ManagedString::ManagedString(const char* value)
+ManagedString::ManagedString(ManagedStringPool& pool, const char* value)
 {
 	uint32 index;
-	ManagedStringPool::Get().AddString(index, m_size, value);
+	pool.AddString(index, m_size, value);
 
 	HEART_ASSERT(index < (UINT_MAX >> 1));
 	m_index = index;
 	m_initialized = true;
 }
 
-void ManagedString::InitializeLookback(ObjectType type, size_t index)
+void ManagedString::InitializeLookback(ManagedStringPool& pool, ObjectType type, size_t index)
 {
 	if (!m_initialized)
 		return;
 
 	HEART_ASSERT(index < UINT_MAX);
-	ManagedStringPool::Get().InitializeLookback(m_index, LookbackHelper {type, uint32(index)});
+	pool.InitializeLookback(m_index, LookbackHelper {type, uint32(index)});
+}
+
+void ManagedString::Rebase(uint32 offset)
+{
+	if (!m_initialized)
+		return;
+
+	HEART_ASSERT(m_index + offset < (UINT_MAX >> 1));
+	m_index = m_index + offset;
 }
 
-const char* ManagedString::CStr() const
+const char* ManagedString::CStr(const ManagedStringPool& pool) const
 {
 	if (!m_initialized)
 		return "";
 
-	return ManagedStringPool::Get().GetString(m_index);
+	return pool.GetString(m_index);
 }
 
-ObjectType ManagedString::GetLookbackType() const
+ObjectType ManagedString::GetLookbackType(const ManagedStringPool& pool) const
 {
 	if (!m_initialized)
 		return ObjectType::Unknown;
 
-	return ManagedStringPool::Get().GetLookback(m_index).type;
+	return pool.GetLookback(m_index).type;
 }
 
-uint32 ManagedString::GetLookbackIndex() const
+uint32 ManagedString::GetLookbackIndex(const ManagedStringPool& pool) const
 {
 	if (!m_initialized)
 		return -1;
 
-	return ManagedStringPool::Get().GetLookback(m_index).index;
+	return pool.GetLookback(m_index).index;
 }
 
 ManagedStringPool::Builder::IndexIntoBlob ManagedStringPool::Builder::Push(const char* entry)
@@ -75,7 +87,7 @@ ManagedStringPool::Builder::IndexIntoBlob ManagedStringPool::Builder::Push(const
 	// }
 
 	auto storageIndex = storage.size();
-	storage.emplace_back(entry);
+	storage.push_back(TemporaryString {String(entry, ArenaAllocator<char>(arena)), {}});
 
 	reverse[blobIndexIfInserted] = storageIndex;
 
@@ -88,12 +100,17 @@ ManagedStringPool::Builder::IndexIntoBlob ManagedStringPool::Builder::Push(const
 void ManagedStringPool::Builder::Finalize(uint8*& outBlob, size_t& outSize)
 {
 	outSize = runningSize;
-	outBlob = (uint8*)malloc(outSize);
+	outBlob = (uint8*)TrackedMalloc(outSize, MemoryTag::StringPoolBlob);
 	HEART_ASSERT(outBlob != nullptr);
 
-	uint8* writer = outBlob;
-	uint8* end = outBlob + outSize;
-	for (auto& entry : storage)
+	WriteTo(outBlob);
+}
+
+void ManagedStringPool::Builder::WriteTo(uint8* out) const
+{
+	uint8* writer = out;
+	uint8* end = out + runningSize;
+	for (const auto& entry : storage)
 	{
 		StringLayout* layout = (StringLayout*)writer;
 		layout->lookback = entry.lookback;
@@ -106,27 +123,11 @@ void ManagedStringPool::Builder::Finalize(uint8*& outBlob, size_t& outSize)
 	}
 
 	HEART_ASSERT(writer == end);
-
-	decltype(reverse) tmp1 {};
-	reverse.swap(tmp1);
-
-	decltype(previous) tmp2 {};
-	previous.swap(tmp2);
-
-	decltype(storage) tmp3 {};
-	storage.swap(tmp3);
-}
-
-ManagedStringPool& ManagedStringPool::Get()
-{
-	static ManagedStringPool s_globalStringPool;
-	return s_globalStringPool;
 }
 
 ManagedStringPool::~ManagedStringPool()
 {
-	if (m_blob)
-		free(m_blob);
+	TrackedFree(m_blob, m_size, MemoryTag::StringPoolBlob);
 
 	m_blob = nullptr;
 	m_size = 0;
@@ -134,10 +135,13 @@ ManagedStringPool::~ManagedStringPool()
 
 void ManagedStringPool::AddString(uint32& index, uint16& size, const char* str)
 {
-	HEART_ASSERT(!m_blob);
+	HEART_ASSERT(!m_blob && m_builder);
 
-	index = m_builder.Push(str);
+	index = m_builder->Push(str);
 	size = uint16(strlen(str));
+
+	PROFILE_COUNT(StringsPooled, 1);
+	PROFILE_COUNT(BytesPooled, size);
 }
 
 const char* ManagedStringPool::GetString(uint32 index) const
@@ -148,10 +152,13 @@ const char* ManagedStringPool::GetString(uint32 index) const
 		return &str->firstCharacter;
 	}
 
-	if (auto reverseIter = m_builder.reverse.find(index); reverseIter != m_builder.reverse.end())
+	if (!HEART_CHECK(m_builder.has_value()))
+		return nullptr;
+
+	if (auto reverseIter = m_builder->reverse.find(index); reverseIter != m_builder->reverse.end())
 	{
 		Builder::IndexIntoStorage storageIndex = reverseIter->second;
-		const Builder::TemporaryString& temp = m_builder.storage[storageIndex];
+		const Builder::TemporaryString& temp = m_builder->storage[storageIndex];
 		return temp.value.c_str();
 	}
 
@@ -161,11 +168,14 @@ const char* ManagedStringPool::GetString(uint32 index) const
 
 void ManagedStringPool::InitializeLookback(uint32 index, LookbackHelper lookback)
 {
-	auto reverseIter = m_builder.reverse.find(index);
-	if (reverseIter != m_builder.reverse.end())
+	if (!m_builder)
+		return;
+
+	auto reverseIter = m_builder->reverse.find(index);
+	if (reverseIter != m_builder->reverse.end())
 	{
 		Builder::IndexIntoStorage storageIndex = reverseIter->second;
-		Builder::TemporaryString& temp = m_builder.storage[storageIndex];
+		Builder::TemporaryString& temp = m_builder->storage[storageIndex];
 		temp.lookback = lookback;
 	}
 }
@@ -178,10 +188,13 @@ LookbackHelper ManagedStringPool::GetLookback(uint32 index) const
 		return str->lookback;
 	}
 
-	if (auto reverseIter = m_builder.reverse.find(index); reverseIter != m_builder.reverse.end())
+	if (!HEART_CHECK(m_builder.has_value()))
+		return {};
+
+	if (auto reverseIter = m_builder->reverse.find(index); reverseIter != m_builder->reverse.end())
 	{
 		Builder::IndexIntoStorage storageIndex = reverseIter->second;
-		const Builder::TemporaryString& temp = m_builder.storage[storageIndex];
+		const Builder::TemporaryString& temp = m_builder->storage[storageIndex];
 		return temp.lookback;
 	}
 
@@ -191,7 +204,52 @@ LookbackHelper ManagedStringPool::GetLookback(uint32 index) const
 
 uint32 ManagedStringPool::FinalizeBuilder()
 {
-	uint32 stringCount = uint32(m_builder.storage.size());
-	m_builder.Finalize(m_blob, m_size);
+	PROFILE_SCOPE("ManagedStringPool::FinalizeBuilder");
+
+	uint32 stringCount = uint32(m_builder->storage.size());
+	m_builder->Finalize(m_blob, m_size);
+	m_builder.reset();
+	return stringCount;
+}
+
+uint32 ManagedStringPool::FinalizeFromParts(std::span<ManagedStringPool* const> parts, hrt::vector<uint32>& outOffsets, ThreadPool* threads)
+{
+	PROFILE_SCOPE("ManagedStringPool::FinalizeFromParts");
+	HEART_ASSERT(!m_blob && m_builder && m_builder->storage.empty());
+
+	uint32 stringCount = 0;
+	outOffsets.resize(parts.size());
+	for (size_t i = 0; i < parts.size(); ++i)
+	{
+		HEART_ASSERT(parts[i]->m_builder.has_value());
+		HEART_ASSERT(m_size + parts[i]->m_builder->runningSize < (UINT_MAX >> 1));
+
+		outOffsets[i] = uint32(m_size);
+		m_size += parts[i]->m_builder->runningSize;
+		stringCount += uint32(parts[i]->m_builder->storage.size());
+	}
+
+	m_blob = (uint8*)TrackedMalloc(m_size, MemoryTag::StringPoolBlob);
+	HEART_ASSERT(m_blob != nullptr);
+	m_builder.reset();
+
+	// Each part only writes its own range of the blob
+	auto writePart = [&](uint32 i) {
+		parts[i]->m_builder->WriteTo(m_blob + outOffsets[i]);
+		parts[i]->m_builder.reset();
+	};
+
+	if (threads)
+	{
+		threads->ParallelFor(uint32(parts.size()), writePart);
+	}
+	else
+	{
+		for (uint32 i = 0; i < uint32(parts.size()); ++i)
+		{
+			writePart(i);
+		}
+	}
+
 	return stringCount;
 }
@@ -9,6 +9,8 @@
 
 #pragma once
 
+#include "memory/memory_tracker.h"
+#include "memory/monotonic_arena.h"
 #include "types/object_type.h"
 
 #include <heart/copy_move_semantics.h>
@@ -19,7 +21,13 @@
 #include <heart/stl/unordered_map.h>
 #include <heart/stl/vector.h>
 
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+
 class ManagedStringPool;
+class ThreadPool;
 
 struct LookbackHelper
 {
@@ -27,6 +35,8 @@ struct LookbackHelper
 	uint32 index = 0;
 };
 
+// Handle to a string in a ManagedStringPool. Doesn't know which pool it came from, every
+// accessor takes the pool explicitly so several pools can live side by side.
 class ManagedString
 {
 private:
@@ -40,15 +50,19 @@ public:
 	ManagedString();
 	~ManagedString() = default;
 
-	ManagedString(const char* value);
+	ManagedString(ManagedStringPool& pool, const char* value);
+
+	void InitializeLookback(ManagedStringPool& pool, ObjectType type, size_t index);
 
-	void InitializeLookback(ObjectType type, size_t index);
+	// Moves a handle made with one part of a pool to where that part ended up, see
+	// ManagedStringPool::FinalizeFromParts
+	void Rebase(uint32 offset);
 
-	const char* CStr() const;
+	const char* CStr(const ManagedStringPool& pool) const;
 
-	ObjectType GetLookbackType() const;
+	ObjectType GetLookbackType(const ManagedStringPool& pool) const;
 
-	uint32 GetLookbackIndex() const;
+	uint32 GetLookbackIndex(const ManagedStringPool& pool) const;
 
 	uint32 GetSize() const
 	{
@@ -58,9 +72,6 @@ public:
 
 class ManagedStringPool
 {
-public:
-	static ManagedStringPool& Get();
-
 private:
 	friend class HashLookup;
 
@@ -70,20 +81,33 @@ private:
 		typedef uint32 IndexIntoBlob;
 		typedef size_t IndexIntoStorage;
 
+		// The strings and map nodes all die together in Finalize, so they come from one arena
+		// that goes with the builder. The storage array is one big block and stays on the heap.
+		template <typename K, typename V>
+		using Map = hrt::unordered_map<K, V, std::hash<K>, std::equal_to<K>, ArenaAllocator<std::pair<const K, V>>>;
+
+		typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>> String;
+
 		struct TemporaryString
 		{
-			hrt::string value;
+			String value;
 			LookbackHelper lookback;
 		};
 
-		hrt::vector<TemporaryString> storage;
-		hrt::unordered_map<StringHash, IndexIntoBlob> previous;
-		hrt::unordered_map<IndexIntoBlob, IndexIntoStorage> reverse;
+		// Declared first so it's destroyed last
+		MonotonicArena arena {MemoryTag::StringPoolBuilder};
+
+		TrackedVector<TemporaryString, MemoryTag::StringPoolBuilder> storage;
+		Map<StringHash, IndexIntoBlob> previous {ArenaAllocator<std::pair<const StringHash, IndexIntoBlob>>(arena)};
+		Map<IndexIntoBlob, IndexIntoStorage> reverse {ArenaAllocator<std::pair<const IndexIntoBlob, IndexIntoStorage>>(arena)};
 
 		IndexIntoBlob runningSize = 0;
 
 		IndexIntoBlob Push(const char* entry);
 		void Finalize(uint8*& outBlob, size_t& outSize);
+
+		// Lays the strings out at out, which needs runningSize bytes
+		void WriteTo(uint8* out) const;
 	};
 
 #pragma pack(push)
@@ -98,7 +122,8 @@ private:
 	uint8* m_blob = nullptr;
 	size_t m_size = 0;
 
-	Builder m_builder;
+	// Only there until FinalizeBuilder, which drops it and its arena in one go
+	std::optional<Builder> m_builder {std::in_place};
 
 public:
 	ManagedStringPool() = default;
@@ -112,4 +137,9 @@ public:
 	LookbackHelper GetLookback(uint32 index) const;
 
 	uint32 FinalizeBuilder();
+
+	// Finalizes this still empty pool as the parts laid end to end, so several builders can
+	// be filled at once. Every part's builder is dropped. A string at index i of parts[p]
+	// ends up at outOffsets[p] + i, and its handles need rebasing by that much.
+	uint32 FinalizeFromParts(std::span<ManagedStringPool* const> parts, hrt::vector<uint32>& outOffsets, ThreadPool* threads = nullptr);
 };
@@ -0,0 +1,150 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "memory/memory_tracker.h"
+
+#include <heart/debug/assert.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <ostream>
+
+namespace
+{
+	constexpr const char* TagNames[] = {
+		"Json document",
+		"String pool builder",
+		"String pool blob",
+		"Hash lookup",
+		"Entities",
+	};
+	static_assert(sizeof(TagNames) / sizeof(TagNames[0]) == size_t(MemoryTag::Count));
+
+	struct TagCounters
+	{
+		std::atomic<uint64> currentBytes = 0;
+		std::atomic<uint64> peakBytes = 0;
+		std::atomic<uint64> allocations = 0;
+		std::atomic<uint64> frees = 0;
+	};
+
+	TagCounters g_counters[size_t(MemoryTag::Count)];
+
+	std::atomic<bool> g_reportEnabled = false;
+
+	void PrintBytes(std::ostream& out, uint64 bytes)
+	{
+		out << std::setw(12) << double(bytes) / (1024.0 * 1024.0);
+	}
+}
+
+const char* GetMemoryTagName(MemoryTag tag)
+{
+	return tag < MemoryTag::Count ? TagNames[size_t(tag)] : "";
+}
+
+void RecordAllocation(MemoryTag tag, size_t bytes)
+{
+	HEART_ASSERT(tag < MemoryTag::Count);
+	TagCounters& counters = g_counters[size_t(tag)];
+
+	uint64 current = counters.currentBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	counters.allocations.fetch_add(1, std::memory_order_relaxed);
+
+	// Several threads can race to raise the peak, the largest one wins
+	uint64 peak = counters.peakBytes.load(std::memory_order_relaxed);
+	while (current > peak && !counters.peakBytes.compare_exchange_weak(peak, current, std::memory_order_relaxed))
+	{
+	}
+}
+
+void RecordFree(MemoryTag tag, size_t bytes)
+{
+	HEART_ASSERT(tag < MemoryTag::Count);
+	TagCounters& counters = g_counters[size_t(tag)];
+
+	counters.currentBytes.fetch_sub(bytes, std::memory_order_relaxed);
+	counters.frees.fetch_add(1, std::memory_order_relaxed);
+}
+
+MemoryTagStats GetMemoryStats(MemoryTag tag)
+{
+	HEART_ASSERT(tag < MemoryTag::Count);
+	const TagCounters& counters = g_counters[size_t(tag)];
+
+	MemoryTagStats stats;
+	stats.currentBytes = counters.currentBytes.load(std::memory_order_relaxed);
+	stats.peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+	stats.allocations = counters.allocations.load(std::memory_order_relaxed);
+	stats.frees = counters.frees.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void* TrackedMalloc(size_t bytes, MemoryTag tag)
+{
+	void* ptr = malloc(bytes);
+	if (ptr)
+		RecordAllocation(tag, bytes);
+
+	return ptr;
+}
+
+void TrackedFree(void* ptr, size_t bytes, MemoryTag tag)
+{
+	if (!ptr)
+		return;
+
+	RecordFree(tag, bytes);
+	free(ptr);
+}
+
+void SetMemoryReportEnabled(bool enabled)
+{
+	g_reportEnabled = enabled;
+}
+
+bool IsMemoryReportEnabled()
+{
+	return g_reportEnabled;
+}
+
+void PrintMemoryReport(std::ostream& out, const char* phase)
+{
+	std::ios::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+	out << std::fixed << std::setprecision(2);
+
+	out << "Memory after " << phase << ":" << std::endl;
+	out << std::left << std::setw(24) << "  Tag" << std::right << std::setw(12) << "current MB" << std::setw(12) << "peak MB" << std::setw(12) << "allocs" << std::setw(12) << "frees" << std::endl;
+
+	MemoryTagStats total;
+	for (size_t i = 0; i < size_t(MemoryTag::Count); ++i)
+	{
+		MemoryTagStats stats = GetMemoryStats(MemoryTag(i));
+		out << "  " << std::left << std::setw(22) << TagNames[i] << std::right;
+		PrintBytes(out, stats.currentBytes);
+		PrintBytes(out, stats.peakBytes);
+		out << std::setw(12) << stats.allocations << std::setw(12) << stats.frees << std::endl;
+
+		// Tags peak at different times, so the summed peak is an upper bound
+		total.currentBytes += stats.currentBytes;
+		total.peakBytes += stats.peakBytes;
+		total.allocations += stats.allocations;
+		total.frees += stats.frees;
+	}
+
+	out << "  " << std::left << std::setw(22) << "Total" << std::right;
+	PrintBytes(out, total.currentBytes);
+	PrintBytes(out, total.peakBytes);
+	out << std::setw(12) << total.allocations << std::setw(12) << total.frees << std::endl;
+
+	out.flags(flags);
+	out.precision(precision);
+}
@@ -0,0 +1,105 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include <heart/types.h>
+
+#include <heart/stl/vector.h>
+
+#include <cstddef>
+#include <iosfwd>
+
+// Who owns a tracked allocation. Anything that isn't tagged doesn't show up in the report.
+enum class MemoryTag : uint8
+{
+	JsonDocument,
+	StringPoolBuilder,
+	StringPoolBlob,
+	HashLookup,
+	Entities,
+	Count,
+};
+
+const char* GetMemoryTagName(MemoryTag tag);
+
+struct MemoryTagStats
+{
+	uint64 currentBytes = 0;
+	uint64 peakBytes = 0;
+	uint64 allocations = 0;
+	uint64 frees = 0;
+};
+
+// Relaxed atomics per tag, so tracked allocations from any thread cost a couple of adds
+void RecordAllocation(MemoryTag tag, size_t bytes);
+void RecordFree(MemoryTag tag, size_t bytes);
+
+MemoryTagStats GetMemoryStats(MemoryTag tag);
+
+// malloc and free that charge a tag. The caller passes the size back in when freeing.
+void* TrackedMalloc(size_t bytes, MemoryTag tag);
+void TrackedFree(void* ptr, size_t bytes, MemoryTag tag);
+
+// Drop-in allocator for the hrt containers, e.g. hrt::vector<T, TrackedAllocator<T, Tag>>
+template <typename T, MemoryTag Tag>
+class TrackedAllocator
+{
+public:
+	typedef T value_type;
+
+	template <typename U>
+	struct rebind
+	{
+		typedef TrackedAllocator<U, Tag> other;
+	};
+
+	TrackedAllocator() = default;
+
+	template <typename U>
+	TrackedAllocator(const TrackedAllocator<U, Tag>&)
+	{
+	}
+
+	T* allocate(size_t count)
+	{
+		return (T*)TrackedMalloc(count * sizeof(T), Tag);
+	}
+
+	void deallocate(T* ptr, size_t count)
+	{
+		TrackedFree(ptr, count * sizeof(T), Tag);
+	}
+
+	template <typename U>
+	bool operator==(const TrackedAllocator<U, Tag>&) const
+	{
+		return true;
+	}
+
+	template <typename U>
+	bool operator!=(const TrackedAllocator<U, Tag>&) const
+	{
+		return false;
+	}
+};
+
+template <typename T, MemoryTag Tag>
+using TrackedVector = hrt::vector<T, TrackedAllocator<T, Tag>>;
+
+// The corpus' actors, variables, conversations and dialog entries
+template <typename T>
+using EntityVector = TrackedVector<T, MemoryTag::Entities>;
+
+// Set by --memory-report, LoadCorpus then prints a report after each phase
+void SetMemoryReportEnabled(bool enabled);
+bool IsMemoryReportEnabled();
+
+// Current, peak and counts per tag, plus the totals
+void PrintMemoryReport(std::ostream& out, const char* phase);
@@ -0,0 +1,111 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "memory/monotonic_arena.h"
+
+#include <heart/debug/assert.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+	uint8* AlignUp(uint8* ptr, size_t alignment)
+	{
+		uintptr_t value = uintptr_t(ptr);
+		return (uint8*)((value + alignment - 1) & ~uintptr_t(alignment - 1));
+	}
+}
+
+MonotonicArena::MonotonicArena(MemoryTag tag, size_t chunkSize) :
+	m_tag(tag),
+	m_chunkSize(chunkSize)
+{
+}
+
+MonotonicArena::~MonotonicArena()
+{
+	Release();
+}
+
+void MonotonicArena::AddChunk(size_t minimumBytes)
+{
+	// Anything bigger than a chunk gets a chunk of its own
+	size_t size = std::max(m_chunkSize, minimumBytes + sizeof(Chunk) + alignof(std::max_align_t));
+
+	Chunk* chunk = (Chunk*)TrackedMalloc(size, m_tag);
+	HEART_ASSERT(chunk != nullptr);
+
+	chunk->next = m_head;
+	chunk->size = size;
+	m_head = chunk;
+
+	m_cursor = (uint8*)(chunk + 1);
+	m_end = (uint8*)chunk + size;
+	m_last = nullptr;
+	m_reservedBytes += size;
+}
+
+void* MonotonicArena::Allocate(size_t bytes, size_t alignment)
+{
+	HEART_ASSERT(std::has_single_bit(alignment));
+
+	uint8* start = m_cursor ? AlignUp(m_cursor, alignment) : nullptr;
+	if (!start || start + bytes > m_end)
+	{
+		AddChunk(bytes + alignment);
+		start = AlignUp(m_cursor, alignment);
+	}
+
+	m_cursor = start + bytes;
+	m_last = start;
+	m_usedBytes += bytes;
+	++m_allocationCount;
+	return start;
+}
+
+void* MonotonicArena::Reallocate(void* ptr, size_t oldBytes, size_t newBytes)
+{
+	if (!ptr)
+		return Allocate(newBytes);
+
+	uint8* bytes = (uint8*)ptr;
+	if (bytes == m_last && bytes + newBytes <= m_end)
+	{
+		m_cursor = bytes + newBytes;
+		m_usedBytes = m_usedBytes - oldBytes + newBytes;
+		return ptr;
+	}
+
+	if (newBytes <= oldBytes)
+		return ptr;
+
+	void* moved = Allocate(newBytes);
+	memcpy(moved, ptr, oldBytes);
+	return moved;
+}
+
+void MonotonicArena::Release()
+{
+	while (m_head)
+	{
+		Chunk* next = m_head->next;
+		TrackedFree(m_head, m_head->size, m_tag);
+		m_head = next;
+	}
+
+	m_cursor = nullptr;
+	m_end = nullptr;
+	m_last = nullptr;
+	m_reservedBytes = 0;
+	m_usedBytes = 0;
+	m_allocationCount = 0;
+}
@@ -0,0 +1,127 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "memory/memory_tracker.h"
+
+#include <heart/copy_move_semantics.h>
+#include <heart/types.h>
+
+#include <cstddef>
+
+// Bump allocator over large chunks from TrackedMalloc. Individual frees do nothing, Release
+// drops every chunk in one go, so a whole phase's temporaries cost a handful of mallocs.
+// Not thread safe, give each thread or each owner its own.
+class MonotonicArena
+{
+	struct Chunk
+	{
+		Chunk* next;
+		size_t size;
+	};
+
+	MemoryTag m_tag;
+	size_t m_chunkSize;
+
+	Chunk* m_head = nullptr;
+	uint8* m_cursor = nullptr;
+	uint8* m_end = nullptr;
+
+	// Only the most recent allocation can grow in place
+	uint8* m_last = nullptr;
+
+	size_t m_reservedBytes = 0;
+	size_t m_usedBytes = 0;
+	uint64 m_allocationCount = 0;
+
+	void AddChunk(size_t minimumBytes);
+
+public:
+	static constexpr size_t DefaultChunkSize = size_t(1) << 20;
+
+	explicit MonotonicArena(MemoryTag tag, size_t chunkSize = DefaultChunkSize);
+	~MonotonicArena();
+	DISABLE_COPY_AND_MOVE_SEMANTICS(MonotonicArena);
+
+	void* Allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+	// Grows ptr in place if it's the last allocation and the chunk has room, else copies
+	void* Reallocate(void* ptr, size_t oldBytes, size_t newBytes);
+
+	// Everything allocated so far is gone after this
+	void Release();
+
+	size_t GetReservedBytes() const
+	{
+		return m_reservedBytes;
+	}
+
+	size_t GetUsedBytes() const
+	{
+		return m_usedBytes;
+	}
+
+	uint64 GetAllocationCount() const
+	{
+		return m_allocationCount;
+	}
+};
+
+// Lets the hrt containers allocate from an arena. Deallocating is a no-op, the memory comes
+// back when the arena is released, so the arena has to outlive the container.
+template <typename T>
+class ArenaAllocator
+{
+	template <typename U>
+	friend class ArenaAllocator;
+
+	MonotonicArena* m_arena;
+
+public:
+	typedef T value_type;
+
+	template <typename U>
+	struct rebind
+	{
+		typedef ArenaAllocator<U> other;
+	};
+
+	explicit ArenaAllocator(MonotonicArena& arena) :
+		m_arena(&arena)
+	{
+	}
+
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) :
+		m_arena(other.m_arena)
+	{
+	}
+
+	T* allocate(size_t count)
+	{
+		return (T*)m_arena->Allocate(count * sizeof(T), alignof(T));
+	}
+
+	void deallocate(T*, size_t)
+	{
+	}
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U>& other) const
+	{
+		return m_arena == other.m_arena;
+	}
+
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const
+	{
+		return m_arena != other.m_arena;
+	}
+};
@@ -0,0 +1,173 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "memory/query_cache.h"
+
+#include <heart/debug/assert.h>
+
+#include <functional>
+
+QueryCache::QueryCache(uint32 maxEntries, size_t maxStoredMatches) :
+	m_maxEntriesPerShard((maxEntries + ShardCount - 1) / ShardCount),
+	m_maxMatchesPerShard(maxStoredMatches / ShardCount)
+{
+	HEART_ASSERT(maxEntries > 0);
+
+	for (Shard& shard : m_shards)
+	{
+		shard.slots.reserve(m_maxEntriesPerShard);
+		shard.referenced = std::make_unique<std::atomic<bool>[]>(m_maxEntriesPerShard);
+	}
+}
+
+QueryCache::Shard& QueryCache::GetShard(std::string_view key)
+{
+	return m_shards[std::hash<std::string_view> {}(key) % ShardCount];
+}
+
+void QueryCache::Remove(Shard& shard, uint32 slot)
+{
+	Slot& target = shard.slots[slot];
+	HEART_ASSERT(target.occupied);
+
+	shard.lookup.erase(target.key);
+	shard.storedMatches -= target.matches.size();
+	--shard.entryCount;
+
+	target.key.clear();
+	target.matches = {};
+	target.occupied = false;
+	shard.referenced[slot].store(false, std::memory_order_relaxed);
+	shard.freeSlots.push_back(slot);
+}
+
+void QueryCache::EvictOne(Shard& shard)
+{
+	HEART_ASSERT(shard.entryCount > 0);
+
+	// Every occupied slot is passed at most twice: once to clear its bit, once to take it
+	while (true)
+	{
+		uint32 slot = shard.hand;
+		shard.hand = (shard.hand + 1) % uint32(shard.slots.size());
+
+		if (!shard.slots[slot].occupied)
+			continue;
+
+		if (shard.referenced[slot].exchange(false, std::memory_order_relaxed))
+			continue;
+
+		Remove(shard, slot);
+		++shard.evictions;
+		return;
+	}
+}
+
+bool QueryCache::Find(std::string_view key, hrt::vector<PoolIndex>& outMatches)
+{
+	Shard& shard = GetShard(key);
+	std::shared_lock lock(shard.mutex);
+
+	auto iter = shard.lookup.find(key);
+	if (iter == shard.lookup.end())
+	{
+		shard.misses.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	// Only store when it changes, so hits on a hot entry don't keep bouncing its cache line
+	std::atomic<bool>& referenced = shard.referenced[iter->second];
+	if (!referenced.load(std::memory_order_relaxed))
+		referenced.store(true, std::memory_order_relaxed);
+
+	outMatches = shard.slots[iter->second].matches;
+	shard.hits.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+void QueryCache::Insert(std::string_view key, const hrt::vector<PoolIndex>& matches)
+{
+	// A single result set bigger than a shard's whole budget would just flush everything else
+	if (matches.size() > m_maxMatchesPerShard)
+		return;
+
+	Shard& shard = GetShard(key);
+	std::unique_lock lock(shard.mutex);
+
+	if (auto iter = shard.lookup.find(key); iter != shard.lookup.end())
+		Remove(shard, iter->second);
+
+	while (shard.entryCount > 0 && (shard.entryCount >= m_maxEntriesPerShard || shard.storedMatches + matches.size() > m_maxMatchesPerShard))
+	{
+		EvictOne(shard);
+	}
+
+	uint32 slot = 0;
+	if (!shard.freeSlots.empty())
+	{
+		slot = shard.freeSlots.back();
+		shard.freeSlots.pop_back();
+	}
+	else
+	{
+		HEART_ASSERT(shard.slots.size() < m_maxEntriesPerShard);
+		slot = uint32(shard.slots.size());
+		shard.slots.emplace_back();
+	}
+
+	Slot& target = shard.slots[slot];
+	target.key = key;
+	target.matches = matches;
+	target.matches.shrink_to_fit();
+	target.occupied = true;
+
+	// New entries start unreferenced, a query seen once is the first to go
+	shard.referenced[slot].store(false, std::memory_order_relaxed);
+
+	shard.lookup.emplace(std::string_view(target.key), slot);
+	shard.storedMatches += matches.size();
+	++shard.entryCount;
+}
+
+void QueryCache::Invalidate()
+{
+	for (Shard& shard : m_shards)
+	{
+		std::unique_lock lock(shard.mutex);
+
+		shard.lookup.clear();
+		shard.slots.clear();
+		shard.freeSlots.clear();
+		shard.hand = 0;
+		shard.entryCount = 0;
+		shard.storedMatches = 0;
+
+		// Counted once, on the first shard
+		if (&shard == &m_shards[0])
+			++shard.invalidations;
+	}
+}
+
+QueryCache::Stats QueryCache::GetStats() const
+{
+	Stats result;
+	for (const Shard& shard : m_shards)
+	{
+		std::shared_lock lock(shard.mutex);
+
+		result.hits += shard.hits.load(std::memory_order_relaxed);
+		result.misses += shard.misses.load(std::memory_order_relaxed);
+		result.evictions += shard.evictions;
+		result.invalidations += shard.invalidations;
+		result.entryCount += shard.entryCount;
+		result.storedMatches += shard.storedMatches;
+	}
+
+	return result;
+}
@@ -0,0 +1,102 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include <heart/types.h>
+
+#include <heart/stl/string.h>
+#include <heart/stl/unordered_map.h>
+#include <heart/stl/vector.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+
+// Bounded cache of query results. Keys are normalized queries (see HashLookup),
+// values are the verified pool offsets of every match, so a hit skips tokenizing,
+// postings merging and verification entirely. Safe to use from several threads at once.
+//
+// Keys are spread over shards with a lock each. Eviction is CLOCK rather than LRU, so a hit
+// only sets the entry's reference bit and holds the lock shared; threads only wait on each
+// other when one of them is inserting into the same shard.
+class QueryCache
+{
+public:
+	typedef uint32 PoolIndex;
+
+	static constexpr uint32 ShardCount = 16;
+
+	struct Stats
+	{
+		uint64 hits = 0;
+		uint64 misses = 0;
+		uint64 evictions = 0;
+		uint64 invalidations = 0;
+		uint32 entryCount = 0;
+		size_t storedMatches = 0;
+	};
+
+private:
+	struct Slot
+	{
+		hrt::string key;
+		hrt::vector<PoolIndex> matches;
+		bool occupied = false;
+	};
+
+	struct Shard
+	{
+		mutable std::shared_mutex mutex;
+
+		// Reserved up front and never grown past it, so the map's keys can view into the slots
+		hrt::vector<Slot> slots;
+		hrt::vector<uint32> freeSlots;
+		hrt::unordered_map<std::string_view, uint32> lookup;
+
+		// One per slot. Set by every hit, cleared as the hand passes; only unset entries are
+		// evicted. Hits only hold the lock shared, so these and the hit counts are atomic.
+		std::unique_ptr<std::atomic<bool>[]> referenced;
+		std::atomic<uint64> hits = 0;
+		std::atomic<uint64> misses = 0;
+
+		uint32 hand = 0;
+		uint32 entryCount = 0;
+		size_t storedMatches = 0;
+		uint64 evictions = 0;
+		uint64 invalidations = 0;
+	};
+
+	Shard m_shards[ShardCount];
+
+	uint32 m_maxEntriesPerShard;
+	size_t m_maxMatchesPerShard;
+
+	Shard& GetShard(std::string_view key);
+
+	static void Remove(Shard& shard, uint32 slot);
+
+	// Frees one slot, moving the hand past recently used entries. The shard can't be empty.
+	static void EvictOne(Shard& shard);
+
+public:
+	explicit QueryCache(uint32 maxEntries = 1024, size_t maxStoredMatches = 1 << 20);
+
+	bool Find(std::string_view key, hrt::vector<PoolIndex>& outMatches);
+
+	void Insert(std::string_view key, const hrt::vector<PoolIndex>& matches);
+
+	// Drops every entry. Must be called whenever the index is rebuilt, since pool offsets
+	// from a previous build are meaningless afterwards.
+	void Invalidate();
+
+	Stats GetStats() const;
+};
@@ -0,0 +1,262 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "memory/roaring_bitmap.h"
+
+#include <heart/debug/assert.h>
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+void RoaringBitmap::ToBitmap(Container& container)
+{
+	container.bitmap.assign(BitmapWords, 0);
+	for (uint16 low : container.array)
+	{
+		container.bitmap[low >> 6] |= uint64(1) << (low & 63);
+	}
+
+	container.array = {};
+}
+
+void RoaringBitmap::ToArrayIfSmall(Container& container)
+{
+	if (!container.IsBitmap() || container.cardinality > ArrayLimit)
+		return;
+
+	container.array.clear();
+	container.array.reserve(container.cardinality);
+	for (uint32 wordIndex = 0; wordIndex < BitmapWords; ++wordIndex)
+	{
+		uint64 word = container.bitmap[wordIndex];
+		while (word != 0)
+		{
+			container.array.push_back(uint16(wordIndex * 64 + uint32(std::countr_zero(word))));
+			word &= word - 1;
+		}
+	}
+
+	container.bitmap = {};
+}
+
+void RoaringBitmap::Intersect(const Container& a, const Container& b, Container& out)
+{
+	out.key = a.key;
+
+	if (a.IsBitmap() && b.IsBitmap())
+	{
+		out.bitmap.resize(BitmapWords);
+		out.cardinality = 0;
+		for (uint32 i = 0; i < BitmapWords; ++i)
+		{
+			out.bitmap[i] = a.bitmap[i] & b.bitmap[i];
+			out.cardinality += uint32(std::popcount(out.bitmap[i]));
+		}
+
+		ToArrayIfSmall(out);
+		return;
+	}
+
+	if (a.IsBitmap() || b.IsBitmap())
+	{
+		const Container& array = a.IsBitmap() ? b : a;
+		const Container& bitmap = a.IsBitmap() ? a : b;
+
+		for (uint16 low : array.array)
+		{
+			if ((bitmap.bitmap[low >> 6] >> (low & 63)) & 1)
+				out.array.push_back(low);
+		}
+	}
+	else
+	{
+		std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), std::back_inserter(out.array));
+	}
+
+	out.cardinality = uint32(out.array.size());
+}
+
+void RoaringBitmap::Unite(const Container& a, const Container& b, Container& out)
+{
+	out.key = a.key;
+
+	if (!a.IsBitmap() && !b.IsBitmap())
+	{
+		out.array.reserve(a.array.size() + b.array.size());
+		std::set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), std::back_inserter(out.array));
+		out.cardinality = uint32(out.array.size());
+
+		if (out.cardinality > ArrayLimit)
+			ToBitmap(out);
+
+		return;
+	}
+
+	out.bitmap.assign(BitmapWords, 0);
+	for (const Container* source : {&a, &b})
+	{
+		if (source->IsBitmap())
+		{
+			for (uint32 i = 0; i < BitmapWords; ++i)
+			{
+				out.bitmap[i] |= source->bitmap[i];
+			}
+		}
+		else
+		{
+			for (uint16 low : source->array)
+			{
+				out.bitmap[low >> 6] |= uint64(1) << (low & 63);
+			}
+		}
+	}
+
+	out.cardinality = 0;
+	for (uint64 word : out.bitmap)
+	{
+		out.cardinality += uint32(std::popcount(word));
+	}
+}
+
+void RoaringBitmap::Append(uint32 value)
+{
+	uint16 key = uint16(value >> 16);
+	uint16 low = uint16(value & 0xFFFF);
+
+	if (m_containers.empty() || m_containers.back().key != key)
+	{
+		HEART_ASSERT(m_containers.empty() || m_containers.back().key < key);
+		m_containers.emplace_back().key = key;
+	}
+
+	Container& container = m_containers.back();
+	if (container.IsBitmap())
+	{
+		container.bitmap[low >> 6] |= uint64(1) << (low & 63);
+	}
+	else
+	{
+		HEART_ASSERT(container.array.empty() || container.array.back() < low);
+		container.array.push_back(low);
+	}
+
+	++container.cardinality;
+	if (!container.IsBitmap() && container.cardinality > ArrayLimit)
+		ToBitmap(container);
+}
+
+RoaringBitmap RoaringBitmap::FromSorted(std::span<const uint32> values)
+{
+	RoaringBitmap result;
+	for (uint32 value : values)
+	{
+		result.Append(value);
+	}
+
+	return result;
+}
+
+uint32 RoaringBitmap::GetCardinality() const
+{
+	uint32 count = 0;
+	for (const Container& container : m_containers)
+	{
+		count += container.cardinality;
+	}
+
+	return count;
+}
+
+bool RoaringBitmap::Contains(uint32 value) const
+{
+	uint16 key = uint16(value >> 16);
+	uint16 low = uint16(value & 0xFFFF);
+
+	auto iter = std::lower_bound(m_containers.begin(), m_containers.end(), key, [](const Container& c, uint16 k) { return c.key < k; });
+	if (iter == m_containers.end() || iter->key != key)
+		return false;
+
+	if (iter->IsBitmap())
+		return (iter->bitmap[low >> 6] >> (low & 63)) & 1;
+
+	return std::binary_search(iter->array.begin(), iter->array.end(), low);
+}
+
+RoaringBitmap RoaringBitmap::And(const RoaringBitmap& other) const
+{
+	RoaringBitmap result;
+
+	size_t i = 0;
+	size_t j = 0;
+	while (i < m_containers.size() && j < other.m_containers.size())
+	{
+		const Container& a = m_containers[i];
+		const Container& b = other.m_containers[j];
+
+		if (a.key < b.key)
+		{
+			++i;
+		}
+		else if (b.key < a.key)
+		{
+			++j;
+		}
+		else
+		{
+			Container out;
+			Intersect(a, b, out);
+			if (out.cardinality > 0)
+				result.m_containers.push_back(std::move(out));
+
+			++i;
+			++j;
+		}
+	}
+
+	return result;
+}
+
+RoaringBitmap RoaringBitmap::Or(const RoaringBitmap& other) const
+{
+	RoaringBitmap result;
+
+	size_t i = 0;
+	size_t j = 0;
+	while (i < m_containers.size() || j < other.m_containers.size())
+	{
+		if (j == other.m_containers.size() || (i < m_containers.size() && m_containers[i].key < other.m_containers[j].key))
+		{
+			result.m_containers.push_back(m_containers[i++]);
+		}
+		else if (i == m_containers.size() || other.m_containers[j].key < m_containers[i].key)
+		{
+			result.m_containers.push_back(other.m_containers[j++]);
+		}
+		else
+		{
+			Container out;
+			Unite(m_containers[i++], other.m_containers[j++], out);
+			result.m_containers.push_back(std::move(out));
+		}
+	}
+
+	return result;
+}
+
+size_t RoaringBitmap::GetMemoryUsage() const
+{
+	size_t bytes = m_containers.capacity() * sizeof(Container);
+	for (const Container& container : m_containers)
+	{
+		bytes += container.array.capacity() * sizeof(uint16) + container.bitmap.capacity() * sizeof(uint64);
+	}
+
+	return bytes;
+}
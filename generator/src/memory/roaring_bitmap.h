@@ -0,0 +1,102 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include <heart/types.h>
+
+#include <heart/stl/vector.h>
+
+#include <bit>
+#include <span>
+
+// Compressed set of uint32, split like Roaring: values are grouped by their top 16 bits,
+// and each group keeps its low halves either as a sorted array (while it has at most
+// ArrayLimit of them) or as a 65536-bit bitmap. Sparse sets stay small, dense ones stay
+// fast, and intersections pick the cheapest routine per pair of groups.
+class RoaringBitmap
+{
+public:
+	static constexpr uint32 ArrayLimit = 4096;
+
+private:
+	static constexpr uint32 BitmapWords = 65536 / 64;
+
+	struct Container
+	{
+		uint16 key = 0;
+		uint32 cardinality = 0;
+
+		// Exactly one of these is in use, the bitmap once cardinality passes ArrayLimit
+		hrt::vector<uint16> array;
+		hrt::vector<uint64> bitmap;
+
+		bool IsBitmap() const
+		{
+			return !bitmap.empty();
+		}
+	};
+
+	hrt::vector<Container> m_containers;
+
+	static void ToBitmap(Container& container);
+	static void ToArrayIfSmall(Container& container);
+	static void Intersect(const Container& a, const Container& b, Container& out);
+	static void Unite(const Container& a, const Container& b, Container& out);
+
+public:
+	// Values must arrive in strictly increasing order
+	void Append(uint32 value);
+
+	static RoaringBitmap FromSorted(std::span<const uint32> values);
+
+	uint32 GetCardinality() const;
+
+	bool Contains(uint32 value) const;
+
+	bool IsEmpty() const
+	{
+		return m_containers.empty();
+	}
+
+	RoaringBitmap And(const RoaringBitmap& other) const;
+
+	RoaringBitmap Or(const RoaringBitmap& other) const;
+
+	size_t GetMemoryUsage() const;
+
+	// Calls func(value) for every value, in increasing order
+	template <typename F>
+	void ForEach(F&& func) const
+	{
+		for (const Container& container : m_containers)
+		{
+			uint32 high = uint32(container.key) << 16;
+			if (!container.IsBitmap())
+			{
+				for (uint16 low : container.array)
+				{
+					func(high | low);
+				}
+
+				continue;
+			}
+
+			for (uint32 wordIndex = 0; wordIndex < BitmapWords; ++wordIndex)
+			{
+				uint64 word = container.bitmap[wordIndex];
+				while (word != 0)
+				{
+					func(high | (wordIndex * 64 + uint32(std::countr_zero(word))));
+					word &= word - 1;
+				}
+			}
+		}
+	}
+};
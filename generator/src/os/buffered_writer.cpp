@@ -0,0 +1,40 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "os/buffered_writer.h"
+
+BufferedWriter::BufferedWriter(FILE* file, size_t capacity) :
+	m_file(file),
+	m_capacity(capacity)
+{
+	// Room for whatever pushes it over capacity, so the last append before a flush
+	// doesn't have to grow it
+	m_buffer.reserve(capacity + capacity / 4);
+}
+
+BufferedWriter::~BufferedWriter()
+{
+	Flush();
+}
+
+bool BufferedWriter::Flush()
+{
+	if (!m_buffer.empty())
+	{
+		if (fwrite(m_buffer.data(), 1, m_buffer.size(), m_file) != m_buffer.size())
+			m_failed = true;
+
+		m_buffer.clear();
+	}
+
+	if (fflush(m_file) != 0)
+		m_failed = true;
+
+	return !m_failed;
+}
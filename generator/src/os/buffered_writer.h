@@ -0,0 +1,66 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include <heart/copy_move_semantics.h>
+
+#include <heart/stl/string.h>
+
+#include <cstdio>
+#include <string_view>
+
+// Collects output in one large buffer and hands it to the file a buffer at a time, rather
+// than flushing per line. Flush() first if anything else writes to the same file.
+class BufferedWriter
+{
+	FILE* m_file;
+	size_t m_capacity;
+	hrt::string m_buffer;
+	bool m_failed = false;
+
+public:
+	static constexpr size_t DefaultCapacity = size_t(1) << 20;
+
+	explicit BufferedWriter(FILE* file, size_t capacity = DefaultCapacity);
+	DISABLE_COPY_AND_MOVE_SEMANTICS(BufferedWriter);
+	~BufferedWriter();
+
+	void Write(std::string_view text)
+	{
+		m_buffer.append(text);
+		FlushIfFull();
+	}
+
+	void Put(char c)
+	{
+		m_buffer.push_back(c);
+		FlushIfFull();
+	}
+
+	// For appending in place (snippets, JSON); call FlushIfFull() once done
+	hrt::string& GetBuffer()
+	{
+		return m_buffer;
+	}
+
+	void FlushIfFull()
+	{
+		if (m_buffer.size() >= m_capacity)
+			Flush();
+	}
+
+	// Writes out everything buffered so far in one go. Returns false if any write has failed.
+	bool Flush();
+
+	bool HasFailed() const
+	{
+		return m_failed;
+	}
+};
@@ -0,0 +1,43 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+
+#include <heart/copy_move_semantics.h>
+
+// Keeps Winsock initialized for as long as it's alive
+struct WinsockScope
+{
+	bool initialized = false;
+
+	WinsockScope()
+	{
+		WSADATA data;
+		initialized = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+	}
+
+	DISABLE_COPY_AND_MOVE_SEMANTICS(WinsockScope);
+
+	~WinsockScope()
+	{
+		if (initialized)
+			WSACleanup();
+	}
+};
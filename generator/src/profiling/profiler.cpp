@@ -0,0 +1,313 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "profiling/profiler.h"
+
+#include <heart/debug/assert.h>
+
+#include <heart/stl/vector.h>
+
+#include <rapidjson/filewritestream.h>
+#include <rapidjson/writer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+
+namespace
+{
+	constexpr uint32 MaxSites = 256;
+
+	// Past this the thread keeps its totals but stops recording individual events
+	constexpr size_t MaxEventsPerThread = size_t(1) << 20;
+
+	constexpr const char* CounterNames[] = {
+		"Strings pooled",
+		"Bytes pooled",
+		"Bytes tokenized",
+		"Postings",
+		"Lookups",
+		"Cache hits",
+		"Candidates verified",
+		"Candidates accepted",
+		"Queries cut short",
+	};
+	static_assert(sizeof(CounterNames) / sizeof(CounterNames[0]) == size_t(ProfileCounter::Count));
+
+	struct TraceEvent
+	{
+		uint32 site = 0;
+		uint64 startNs = 0;
+		uint64 durationNs = 0;
+	};
+
+	struct SiteStats
+	{
+		uint64 count = 0;
+		uint64 totalNs = 0;
+		uint64 maxNs = 0;
+	};
+
+	struct ThreadTrace
+	{
+		uint32 threadIndex = 0;
+		hrt::vector<TraceEvent> events;
+		uint64 droppedEvents = 0;
+
+		SiteStats sites[MaxSites] = {};
+		uint64 counters[size_t(ProfileCounter::Count)] = {};
+	};
+
+	struct ProfileState
+	{
+		std::mutex mutex;
+		hrt::vector<std::unique_ptr<ThreadTrace>> threads;
+
+		std::atomic<bool> recordEvents = false;
+
+		std::atomic<uint32> siteCount = 0;
+		const char* siteNames[MaxSites] = {};
+
+		std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	};
+
+	ProfileState& GetState()
+	{
+		static ProfileState state;
+		return state;
+	}
+
+	// Traces belong to the state, not the thread, so they can still be read after workers exit
+	ThreadTrace& GetThreadTrace()
+	{
+		thread_local ThreadTrace* trace = nullptr;
+		if (!trace)
+		{
+			ProfileState& state = GetState();
+			std::lock_guard lock(state.mutex);
+
+			std::unique_ptr<ThreadTrace>& created = state.threads.emplace_back(std::make_unique<ThreadTrace>());
+			created->threadIndex = uint32(state.threads.size());
+			trace = created.get();
+		}
+
+		return *trace;
+	}
+}
+
+const char* GetProfileCounterName(ProfileCounter counter)
+{
+	return counter < ProfileCounter::Count ? CounterNames[size_t(counter)] : "";
+}
+
+ProfileSite::ProfileSite(const char* name) :
+	m_name(name)
+{
+	ProfileState& state = GetState();
+
+	// Sites past the limit all share the last slot rather than write out of bounds
+	m_id = std::min(state.siteCount++, MaxSites - 1);
+	HEART_ASSERT(m_id < MaxSites - 1);
+	state.siteNames[m_id] = name;
+}
+
+uint64 GetProfileTimeNs()
+{
+	return uint64(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - GetState().epoch).count());
+}
+
+void RecordProfileScope(const ProfileSite& site, uint64 startNs, uint64 endNs)
+{
+	ThreadTrace& trace = GetThreadTrace();
+	uint64 durationNs = endNs - startNs;
+
+	SiteStats& stats = trace.sites[site.GetId()];
+	++stats.count;
+	stats.totalNs += durationNs;
+	stats.maxNs = std::max(stats.maxNs, durationNs);
+
+	if (!GetState().recordEvents.load(std::memory_order_relaxed))
+		return;
+
+	if (trace.events.size() < MaxEventsPerThread)
+		trace.events.push_back(TraceEvent {site.GetId(), startNs, durationNs});
+	else
+		++trace.droppedEvents;
+}
+
+void SetProfileEventRecording(bool enabled)
+{
+	GetState().recordEvents = enabled;
+}
+
+void AddProfileCounter(ProfileCounter counter, uint64 value)
+{
+	GetThreadTrace().counters[size_t(counter)] += value;
+}
+
+bool WriteChromeTrace(const char* path)
+{
+	ProfileState& state = GetState();
+	std::lock_guard lock(state.mutex);
+
+	FILE* file = nullptr;
+	fopen_s(&file, path, "wb");
+	if (!file)
+		return false;
+
+	constexpr size_t BufferSize = 1ull << 16;
+	char* buffer = (char*)malloc(BufferSize);
+	rapidjson::FileWriteStream stream(file, buffer, BufferSize);
+	rapidjson::Writer<rapidjson::FileWriteStream> writer(stream);
+
+	uint64 counters[size_t(ProfileCounter::Count)] = {};
+	uint64 lastNs = 0;
+
+	writer.StartObject();
+	writer.Key("displayTimeUnit");
+	writer.String("ms");
+	writer.Key("traceEvents");
+	writer.StartArray();
+	for (const std::unique_ptr<ThreadTrace>& trace : state.threads)
+	{
+		for (const TraceEvent& event : trace->events)
+		{
+			writer.StartObject();
+			writer.Key("name");
+			writer.String(state.siteNames[event.site]);
+			writer.Key("ph");
+			writer.String("X");
+			writer.Key("ts");
+			writer.Double(double(event.startNs) / 1000.0);
+			writer.Key("dur");
+			writer.Double(double(event.durationNs) / 1000.0);
+			writer.Key("pid");
+			writer.Uint(1);
+			writer.Key("tid");
+			writer.Uint(trace->threadIndex);
+			writer.EndObject();
+
+			lastNs = std::max(lastNs, event.startNs + event.durationNs);
+		}
+
+		for (size_t i = 0; i < size_t(ProfileCounter::Count); ++i)
+		{
+			counters[i] += trace->counters[i];
+		}
+	}
+
+	writer.StartObject();
+	writer.Key("name");
+	writer.String("Counters");
+	writer.Key("ph");
+	writer.String("C");
+	writer.Key("ts");
+	writer.Double(double(lastNs) / 1000.0);
+	writer.Key("pid");
+	writer.Uint(1);
+	writer.Key("args");
+	writer.StartObject();
+	for (size_t i = 0; i < size_t(ProfileCounter::Count); ++i)
+	{
+		writer.Key(CounterNames[i]);
+		writer.Uint64(counters[i]);
+	}
+	writer.EndObject();
+	writer.EndObject();
+
+	writer.EndArray();
+	writer.EndObject();
+
+	stream.Flush();
+	bool succeeded = ferror(file) == 0;
+
+	fclose(file);
+	free(buffer);
+	return succeeded;
+}
+
+void PrintProfileSummary(std::ostream& out)
+{
+	ProfileState& state = GetState();
+	std::lock_guard lock(state.mutex);
+
+	uint32 siteCount = std::min(state.siteCount.load(), MaxSites);
+	hrt::vector<SiteStats> sites(siteCount);
+	uint64 counters[size_t(ProfileCounter::Count)] = {};
+	uint64 droppedEvents = 0;
+
+	for (const std::unique_ptr<ThreadTrace>& trace : state.threads)
+	{
+		for (uint32 i = 0; i < siteCount; ++i)
+		{
+			sites[i].count += trace->sites[i].count;
+			sites[i].totalNs += trace->sites[i].totalNs;
+			sites[i].maxNs = std::max(sites[i].maxNs, trace->sites[i].maxNs);
+		}
+
+		for (size_t i = 0; i < size_t(ProfileCounter::Count); ++i)
+		{
+			counters[i] += trace->counters[i];
+		}
+
+		droppedEvents += trace->droppedEvents;
+	}
+
+	hrt::vector<uint32> order;
+	for (uint32 i = 0; i < siteCount; ++i)
+	{
+		if (sites[i].count != 0)
+			order.push_back(i);
+	}
+	std::sort(order.begin(), order.end(), [&sites](uint32 a, uint32 b) { return sites[a].totalNs > sites[b].totalNs; });
+
+	std::ios::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+	out << std::fixed << std::setprecision(3);
+
+	out << std::left << std::setw(32) << "Scope" << std::right << std::setw(12) << "calls" << std::setw(14) << "total ms" << std::setw(14) << "mean us" << std::setw(14) << "max us" << std::endl;
+	for (uint32 i : order)
+	{
+		const SiteStats& stats = sites[i];
+		out << std::left << std::setw(32) << state.siteNames[i] << std::right << std::setw(12) << stats.count << std::setw(14) << double(stats.totalNs) / 1e6;
+		out << std::setw(14) << double(stats.totalNs) / 1e3 / double(stats.count) << std::setw(14) << double(stats.maxNs) / 1e3 << std::endl;
+	}
+
+	out << std::endl;
+	for (size_t i = 0; i < size_t(ProfileCounter::Count); ++i)
+	{
+		out << std::left << std::setw(32) << CounterNames[i] << std::right << std::setw(12) << counters[i] << std::endl;
+	}
+
+	if (droppedEvents != 0)
+		out << droppedEvents << " trace events dropped after the per-thread limit, the totals above still count them." << std::endl;
+
+	out.flags(flags);
+	out.precision(precision);
+}
+
+void ResetProfile()
+{
+	ProfileState& state = GetState();
+	std::lock_guard lock(state.mutex);
+
+	for (std::unique_ptr<ThreadTrace>& trace : state.threads)
+	{
+		trace->events.clear();
+		trace->droppedEvents = 0;
+		std::fill(std::begin(trace->sites), std::end(trace->sites), SiteStats {});
+		std::fill(std::begin(trace->counters), std::end(trace->counters), uint64(0));
+	}
+}
@@ -0,0 +1,107 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include <heart/copy_move_semantics.h>
+#include <heart/types.h>
+
+#include <iosfwd>
+
+// Build with PROFILING_ENABLED=0 and every PROFILE_ macro compiles to nothing
+#ifndef PROFILING_ENABLED
+#define PROFILING_ENABLED 1
+#endif
+
+enum class ProfileCounter : uint8
+{
+	StringsPooled,
+	BytesPooled,
+	BytesTokenized,
+	Postings,
+	Lookups,
+	CacheHits,
+	CandidatesVerified,
+	CandidatesAccepted,
+	QueriesCutShort,
+	Count,
+};
+
+const char* GetProfileCounterName(ProfileCounter counter);
+
+// One per PROFILE_SCOPE line, created the first time it's reached. The id indexes straight
+// into each thread's stats, so closing a scope never searches for its name.
+class ProfileSite
+{
+	uint32 m_id;
+	const char* m_name;
+
+public:
+	explicit ProfileSite(const char* name);
+	DISABLE_COPY_AND_MOVE_SEMANTICS(ProfileSite);
+
+	uint32 GetId() const
+	{
+		return m_id;
+	}
+
+	const char* GetName() const
+	{
+		return m_name;
+	}
+};
+
+uint64 GetProfileTimeNs();
+
+// Adds to the calling thread's own totals, no locking after the thread's first scope. Only
+// appends an event for the trace once SetProfileEventRecording has turned that on.
+void RecordProfileScope(const ProfileSite& site, uint64 startNs, uint64 endNs);
+void SetProfileEventRecording(bool enabled);
+
+void AddProfileCounter(ProfileCounter counter, uint64 value);
+
+class ScopedProfileTimer
+{
+	const ProfileSite& m_site;
+	uint64 m_startNs;
+
+public:
+	explicit ScopedProfileTimer(const ProfileSite& site) :
+		m_site(site),
+		m_startNs(GetProfileTimeNs())
+	{
+	}
+
+	~ScopedProfileTimer()
+	{
+		RecordProfileScope(m_site, m_startNs, GetProfileTimeNs());
+	}
+
+	DISABLE_COPY_AND_MOVE_SEMANTICS(ScopedProfileTimer);
+};
+
+#if PROFILING_ENABLED
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) static const ProfileSite PROFILE_CONCAT(profileSite_, __LINE__)(name); ScopedProfileTimer PROFILE_CONCAT(profileTimer_, __LINE__)(PROFILE_CONCAT(profileSite_, __LINE__))
+#define PROFILE_COUNT(counter, value) AddProfileCounter(ProfileCounter::counter, uint64(value))
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_COUNT(counter, value) ((void)sizeof(value))
+#endif
+
+// These read every thread's buffer, so only call them while nothing is recording
+
+// Chrome's about://tracing / Perfetto format, an event per scope plus the counter totals
+bool WriteChromeTrace(const char* path);
+
+// Calls, total, mean and max per scope, heaviest first, then the counters
+void PrintProfileSummary(std::ostream& out);
+
+void ResetProfile();
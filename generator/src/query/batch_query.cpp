@@ -0,0 +1,102 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "query/batch_query.h"
+
+#include "corpus/corpus.h"
+#include "os/buffered_writer.h"
+#include "query/latency_stats.h"
+#include "query/query_json.h"
+#include "threading/thread_pool.h"
+
+#include <heart/debug/assert.h>
+
+#include <heart/stl/string.h>
+#include <heart/stl/vector.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+	struct BatchResult
+	{
+		hrt::string json;
+		uint32 matchCount = 0;
+		double latencyUs = 0.0;
+	};
+
+	void RunSingleQuery(const Corpus& corpus, const hrt::string& query, BatchResult& outResult)
+	{
+		auto start = std::chrono::steady_clock::now();
+		auto matches = corpus.index.LookupWord(query.c_str());
+		auto end = std::chrono::steady_clock::now();
+
+		outResult.latencyUs = std::chrono::duration<double, std::micro>(end - start).count();
+		outResult.matchCount = AppendQueryResultJson(outResult.json, corpus, query, matches, outResult.latencyUs);
+	}
+}
+
+bool RunBatchQueries(const Corpus& corpus, ThreadPool& threads, const char* inputPath, const char* outputPath, BatchQueryStats& outStats)
+{
+	outStats = {};
+
+	hrt::vector<hrt::string> queries;
+	{
+		std::ifstream input(inputPath);
+		if (!input)
+			return false;
+
+		hrt::string line;
+		while (std::getline(input, line))
+		{
+			if (!line.empty() && line.back() == '\r')
+				line.pop_back();
+
+			queries.push_back(std::move(line));
+		}
+	}
+
+	FILE* file = nullptr;
+	fopen_s(&file, outputPath, "wb");
+	if (!file)
+		return false;
+
+	hrt::vector<BatchResult> results(queries.size());
+
+	auto start = std::chrono::steady_clock::now();
+	threads.ParallelFor(uint32(queries.size()), [&](uint32 index) { RunSingleQuery(corpus, queries[index], results[index]); });
+	auto end = std::chrono::steady_clock::now();
+
+	hrt::vector<double> latencies;
+	latencies.reserve(results.size());
+
+	bool written = false;
+	{
+		BufferedWriter output(file);
+		for (BatchResult& result : results)
+		{
+			output.Write(result.json);
+			output.Put('\n');
+
+			outStats.matchCount += result.matchCount;
+			latencies.push_back(result.latencyUs);
+		}
+
+		written = output.Flush();
+	}
+	fclose(file);
+
+	outStats.queryCount = uint32(queries.size());
+	outStats.wallSeconds = std::chrono::duration<double>(end - start).count();
+	outStats.latency = SummarizeLatencies(latencies);
+
+	return written;
+}
@@ -0,0 +1,32 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "query/latency_stats.h"
+
+#include <heart/types.h>
+
+struct Corpus;
+class ThreadPool;
+
+struct BatchQueryStats
+{
+	uint32 queryCount = 0;
+	uint64 matchCount = 0;
+
+	double wallSeconds = 0.0;
+
+	LatencySummary latency;
+};
+
+// Reads one query per line from inputPath, runs them concurrently on the pool against the
+// (already loaded, no longer changing) corpus, and writes one JSON object per query to
+// outputPath in the same order as the input.
+bool RunBatchQueries(const Corpus& corpus, ThreadPool& threads, const char* inputPath, const char* outputPath, BatchQueryStats& outStats);
@@ -0,0 +1,83 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "query/facet_index.h"
+
+#include "columns/dialog_entry_table.h"
+
+#include <algorithm>
+#include <numeric>
+#include <span>
+
+namespace
+{
+	template <typename T>
+	void BuildField(std::span<const T> column, hrt::vector<int32>& outValues, hrt::vector<RoaringBitmap>& outBitmaps)
+	{
+		outValues.clear();
+		outBitmaps.clear();
+
+		// Rows grouped by value; stable, so each group's rows stay in increasing order for Append
+		hrt::vector<uint32> rows(column.size());
+		std::iota(rows.begin(), rows.end(), 0u);
+		std::stable_sort(rows.begin(), rows.end(), [&](uint32 a, uint32 b) { return column[a] < column[b]; });
+
+		for (uint32 row : rows)
+		{
+			int32 value = int32(column[row]);
+			if (outValues.empty() || outValues.back() != value)
+			{
+				outValues.push_back(value);
+				outBitmaps.emplace_back();
+			}
+
+			outBitmaps.back().Append(row);
+		}
+	}
+}
+
+void FacetIndex::Build(const DialogEntryTable& table)
+{
+	auto build = [this](FacetField field, auto column) {
+		Field& target = m_fields[size_t(field)];
+		BuildField(column, target.values, target.bitmaps);
+	};
+
+	build(FacetField::Actor, table.GetActors());
+	build(FacetField::Conversant, table.GetConversants());
+	build(FacetField::Conversation, table.GetConversations());
+	build(FacetField::IsRoot, table.GetIsRoot());
+	build(FacetField::IsGroup, table.GetIsGroup());
+}
+
+const RoaringBitmap* FacetIndex::Find(FacetField field, int32 value) const
+{
+	const Field& source = m_fields[size_t(field)];
+
+	auto iter = std::lower_bound(source.values.begin(), source.values.end(), value);
+	if (iter == source.values.end() || *iter != value)
+		return nullptr;
+
+	return &source.bitmaps[size_t(iter - source.values.begin())];
+}
+
+size_t FacetIndex::GetMemoryUsage() const
+{
+	size_t bytes = 0;
+	for (const Field& field : m_fields)
+	{
+		bytes += field.values.capacity() * sizeof(int32);
+		for (const RoaringBitmap& bitmap : field.bitmaps)
+		{
+			bytes += bitmap.GetMemoryUsage();
+		}
+	}
+
+	return bytes;
+}
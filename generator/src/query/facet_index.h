@@ -0,0 +1,55 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "memory/roaring_bitmap.h"
+
+#include <heart/types.h>
+
+#include <heart/stl/vector.h>
+
+class DialogEntryTable;
+
+enum class FacetField : uint8
+{
+	Actor, // actor id
+	Conversant, // actor id
+	Conversation, // dense conversation index
+	IsRoot, // 0 or 1
+	IsGroup, // 0 or 1
+
+	Count
+};
+
+// One compressed bitmap of dialog entries per distinct value of each facet field
+class FacetIndex
+{
+	struct Field
+	{
+		// Sorted, bitmaps[i] holds the entries whose field equals values[i]
+		hrt::vector<int32> values;
+		hrt::vector<RoaringBitmap> bitmaps;
+	};
+
+	Field m_fields[size_t(FacetField::Count)];
+
+public:
+	void Build(const DialogEntryTable& table);
+
+	// Null if no entry has that value
+	const RoaringBitmap* Find(FacetField field, int32 value) const;
+
+	uint32 GetValueCount(FacetField field) const
+	{
+		return uint32(m_fields[size_t(field)].values.size());
+	}
+
+	size_t GetMemoryUsage() const;
+};
@@ -0,0 +1,285 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "query/faceted_search.h"
+
+#include "corpus/corpus.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+namespace
+{
+	struct QueryToken
+	{
+		std::string_view key;
+		std::string_view value;
+	};
+
+	std::string_view StripQuotes(std::string_view text)
+	{
+		if (text.size() >= 2 && text.front() == '"' && text.back() == '"')
+			return text.substr(1, text.size() - 2);
+
+		return text;
+	}
+
+	bool IsFacetKey(std::string_view key)
+	{
+		return key == "actor" || key == "conversant" || key == "conversation" || key == "root" || key == "group";
+	}
+
+	// Splits on spaces outside of quotes. Anything that isn't a known key:value is text.
+	hrt::vector<QueryToken> Tokenize(std::string_view input)
+	{
+		hrt::vector<QueryToken> tokens;
+
+		size_t position = 0;
+		while (position < input.size())
+		{
+			if (input[position] == ' ')
+			{
+				++position;
+				continue;
+			}
+
+			size_t start = position;
+			bool quoted = false;
+			while (position < input.size() && (quoted || input[position] != ' '))
+			{
+				if (input[position] == '"')
+					quoted = !quoted;
+
+				++position;
+			}
+
+			std::string_view token = input.substr(start, position - start);
+			size_t colon = token.find(':');
+
+			QueryToken& result = tokens.emplace_back();
+			if (token.front() != '"' && colon != std::string_view::npos && IsFacetKey(token.substr(0, colon)))
+			{
+				result.key = token.substr(0, colon);
+				result.value = StripQuotes(token.substr(colon + 1));
+			}
+			else
+			{
+				result.value = StripQuotes(token);
+			}
+		}
+
+		return tokens;
+	}
+
+	bool ContainsIgnoringCase(std::string_view haystack, std::string_view needle)
+	{
+		auto iter = std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end(), [](char a, char b) { return std::tolower((unsigned char)a) == std::tolower((unsigned char)b); });
+		return iter != haystack.end();
+	}
+
+	bool ParseInt(std::string_view text, int32& outValue)
+	{
+		auto result = std::from_chars(text.data(), text.data() + text.size(), outValue);
+		return result.ec == std::errc() && result.ptr == text.data() + text.size();
+	}
+
+	bool ParseActorValues(const Corpus& corpus, std::string_view value, hrt::vector<int32>& outValues)
+	{
+		int32 id = 0;
+		if (ParseInt(value, id))
+		{
+			outValues.push_back(id);
+			return true;
+		}
+
+		for (const Actor& actor : corpus.actors)
+		{
+			if (ContainsIgnoringCase(actor.name.CStr(corpus.pool), value))
+				outValues.push_back(int32(actor.id));
+		}
+
+		return !outValues.empty();
+	}
+
+	bool ParseConversationValues(const Corpus& corpus, std::string_view value, hrt::vector<int32>& outValues)
+	{
+		int32 id = 0;
+		if (ParseInt(value, id))
+		{
+			uint32 index = corpus.ids.FindConversation(id);
+			if (index != UINT32_MAX)
+				outValues.push_back(int32(index));
+
+			return !outValues.empty();
+		}
+
+		for (uint32 i = 0; i < corpus.conversations.size(); ++i)
+		{
+			if (ContainsIgnoringCase(corpus.conversations[i].title.CStr(corpus.pool), value))
+				outValues.push_back(int32(i));
+		}
+
+		return !outValues.empty();
+	}
+
+	bool ParseFlagValue(std::string_view value, hrt::vector<int32>& outValues)
+	{
+		if (value == "true" || value == "1")
+			outValues.push_back(1);
+		else if (value == "false" || value == "0")
+			outValues.push_back(0);
+
+		return !outValues.empty();
+	}
+
+	// Largest counts first, dense counts in, zeroes dropped
+	hrt::vector<FacetCount> SortCounts(const hrt::vector<uint32>& counts, const hrt::vector<int32>& values)
+	{
+		hrt::vector<FacetCount> result;
+		for (size_t i = 0; i < counts.size(); ++i)
+		{
+			if (counts[i] > 0)
+				result.push_back(FacetCount {values[i], counts[i]});
+		}
+
+		std::sort(result.begin(), result.end(), [](const FacetCount& a, const FacetCount& b) { return a.count > b.count || (a.count == b.count && a.value < b.value); });
+		return result;
+	}
+}
+
+bool HasFacetFilters(std::string_view input)
+{
+	for (const QueryToken& token : Tokenize(input))
+	{
+		if (!token.key.empty())
+			return true;
+	}
+
+	return false;
+}
+
+bool ParseFacetedQuery(std::string_view input, const Corpus& corpus, FacetedQuery& outQuery, hrt::string& outError)
+{
+	outQuery = FacetedQuery {};
+
+	for (const QueryToken& token : Tokenize(input))
+	{
+		if (token.key.empty())
+		{
+			if (!outQuery.text.empty())
+				outQuery.text.push_back(' ');
+
+			outQuery.text.append(token.value.data(), token.value.size());
+			continue;
+		}
+
+		FacetFilter& filter = outQuery.filters.emplace_back();
+		bool parsed = false;
+
+		if (token.key == "actor" || token.key == "conversant")
+		{
+			filter.field = token.key == "actor" ? FacetField::Actor : FacetField::Conversant;
+			parsed = ParseActorValues(corpus, token.value, filter.values);
+		}
+		else if (token.key == "conversation")
+		{
+			filter.field = FacetField::Conversation;
+			parsed = ParseConversationValues(corpus, token.value, filter.values);
+		}
+		else if (token.key == "root" || token.key == "group")
+		{
+			filter.field = token.key == "root" ? FacetField::IsRoot : FacetField::IsGroup;
+			parsed = ParseFlagValue(token.value, filter.values);
+		}
+
+		if (!parsed)
+		{
+			outError.assign("Nothing matches ");
+			outError.append(token.key.data(), token.key.size());
+			outError.push_back(':');
+			outError.append(token.value.data(), token.value.size());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+FacetedResult RunFacetedQuery(const Corpus& corpus, const FacetedQuery& query)
+{
+	FacetedResult result;
+
+	// Each filter is the union of its values' bitmaps
+	hrt::vector<RoaringBitmap> filterSets;
+	for (const FacetFilter& filter : query.filters)
+	{
+		RoaringBitmap& set = filterSets.emplace_back();
+		for (int32 value : filter.values)
+		{
+			if (const RoaringBitmap* bitmap = corpus.facets.Find(filter.field, value))
+				set = set.Or(*bitmap);
+		}
+	}
+
+	if (!query.text.empty())
+	{
+		hrt::vector<uint32> candidates;
+		for (const ManagedString& match : corpus.index.LookupWord(query.text.c_str()))
+		{
+			if (match.GetLookbackType(corpus.pool) == ObjectType::DialogEntry)
+				candidates.push_back(match.GetLookbackIndex(corpus.pool));
+		}
+
+		std::sort(candidates.begin(), candidates.end());
+		candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+		filterSets.push_back(RoaringBitmap::FromSorted(std::span<const uint32>(candidates.data(), candidates.size())));
+	}
+
+	if (filterSets.empty())
+		return result;
+
+	// Smallest first keeps every intermediate as small as it can be
+	std::sort(filterSets.begin(), filterSets.end(), [](const RoaringBitmap& a, const RoaringBitmap& b) { return a.GetCardinality() < b.GetCardinality(); });
+
+	result.entries = std::move(filterSets[0]);
+	for (size_t i = 1; i < filterSets.size() && !result.entries.IsEmpty(); ++i)
+	{
+		result.entries = result.entries.And(filterSets[i]);
+	}
+
+	// Actor ids go through the id map to a dense slot, with one extra for unknown actors
+	uint32 actorCount = uint32(corpus.actors.size());
+	hrt::vector<uint32> actorCounts(actorCount + 1, 0);
+	hrt::vector<uint32> conversationCounts(corpus.conversations.size(), 0);
+
+	auto actors = corpus.entryTable.GetActors();
+	auto conversations = corpus.entryTable.GetConversations();
+	result.entries.ForEach([&](uint32 entry) {
+		uint32 actor = corpus.ids.FindActor(actors[entry]);
+		++actorCounts[actor == UINT32_MAX ? actorCount : actor];
+		++conversationCounts[conversations[entry]];
+	});
+
+	hrt::vector<int32> actorIds(actorCount + 1, -1);
+	for (uint32 i = 0; i < actorCount; ++i)
+	{
+		actorIds[i] = int32(corpus.actors[i].id);
+	}
+
+	hrt::vector<int32> conversationIndices(corpus.conversations.size());
+	for (uint32 i = 0; i < conversationIndices.size(); ++i)
+	{
+		conversationIndices[i] = int32(i);
+	}
+
+	result.actorCounts = SortCounts(actorCounts, actorIds);
+	result.conversationCounts = SortCounts(conversationCounts, conversationIndices);
+	return result;
+}
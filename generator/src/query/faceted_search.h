@@ -0,0 +1,66 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "memory/roaring_bitmap.h"
+#include "query/facet_index.h"
+
+#include <heart/types.h>
+
+#include <heart/stl/string.h>
+#include <heart/stl/vector.h>
+
+#include <string_view>
+
+struct Corpus;
+
+// An entry passes if its field matches any of the values
+struct FacetFilter
+{
+	FacetField field = FacetField::Actor;
+	hrt::vector<int32> values;
+};
+
+struct FacetedQuery
+{
+	hrt::string text;
+
+	// Every filter has to pass
+	hrt::vector<FacetFilter> filters;
+};
+
+struct FacetCount
+{
+	// Actor id, or dense conversation index
+	int32 value = 0;
+	uint32 count = 0;
+};
+
+struct FacetedResult
+{
+	RoaringBitmap entries;
+
+	// Most common first
+	hrt::vector<FacetCount> actorCounts;
+	hrt::vector<FacetCount> conversationCounts;
+};
+
+// Reads `"whirling" actor:Kim root:true`. Quoted or bare words are the text query, and
+// key:value pairs (value quoted if it has spaces) are filters. actor and conversant take
+// an id or part of a name, conversation an id or part of a title, root and group
+// true/false. Returns false with a message in outError if a filter can't be understood.
+bool ParseFacetedQuery(std::string_view input, const Corpus& corpus, FacetedQuery& outQuery, hrt::string& outError);
+
+// True if the input has at least one key:value filter in it
+bool HasFacetFilters(std::string_view input);
+
+// Intersects the text search's candidates with the filters' bitmaps, smallest first, then
+// counts actors and conversations over what's left in the same walk.
+FacetedResult RunFacetedQuery(const Corpus& corpus, const FacetedQuery& query);
@@ -0,0 +1,43 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "query/latency_stats.h"
+
+#include <algorithm>
+
+namespace
+{
+	double Percentile(const hrt::vector<double>& sorted, double fraction)
+	{
+		size_t index = size_t(fraction * double(sorted.size() - 1) + 0.5);
+		return sorted[std::min(index, sorted.size() - 1)];
+	}
+}
+
+LatencySummary SummarizeLatencies(hrt::vector<double>& latencies)
+{
+	LatencySummary result;
+	if (latencies.empty())
+		return result;
+
+	std::sort(latencies.begin(), latencies.end());
+
+	double total = 0.0;
+	for (double latency : latencies)
+	{
+		total += latency;
+	}
+
+	result.count = uint32(latencies.size());
+	result.meanUs = total / double(latencies.size());
+	result.p50Us = Percentile(latencies, 0.50);
+	result.p99Us = Percentile(latencies, 0.99);
+	result.maxUs = latencies.back();
+	return result;
+}
@@ -0,0 +1,27 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include <heart/types.h>
+
+#include <heart/stl/vector.h>
+
+struct LatencySummary
+{
+	uint32 count = 0;
+
+	double meanUs = 0.0;
+	double p50Us = 0.0;
+	double p99Us = 0.0;
+	double maxUs = 0.0;
+};
+
+// Sorts latencies in place and summarizes them
+LatencySummary SummarizeLatencies(hrt::vector<double>& latencies);
@@ -0,0 +1,38 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "query/match_context.h"
+
+#include "corpus/corpus.h"
+
+bool ResolveMatchContext(const Corpus& corpus, const ManagedString& match, MatchContext& outContext)
+{
+	if (match.GetLookbackType(corpus.pool) != ObjectType::DialogEntry)
+		return false;
+
+	outContext = ResolveEntryContext(corpus, match.GetLookbackIndex(corpus.pool));
+	return true;
+}
+
+MatchContext ResolveEntryContext(const Corpus& corpus, uint32 entryIndex)
+{
+	MatchContext context;
+	context.entryIndex = entryIndex;
+	context.entry = &corpus.dialogEntries[entryIndex];
+
+	uint32 actor = corpus.ids.FindActor(context.entry->actor);
+	if (actor != UINT32_MAX)
+		context.speaker = &corpus.actors[actor];
+
+	uint32 conversation = corpus.ids.FindConversation(context.entry->conversationId);
+	if (conversation != UINT32_MAX)
+		context.conversation = &corpus.conversations[conversation];
+
+	return context;
+}
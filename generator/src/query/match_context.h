@@ -0,0 +1,36 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "memory/managed_string.h"
+
+#include <heart/types.h>
+
+struct Actor;
+struct Conversation;
+struct Corpus;
+struct DialogEntry;
+
+// A dialog entry match joined to who says it and where
+struct MatchContext
+{
+	uint32 entryIndex = 0;
+	const DialogEntry* entry = nullptr;
+
+	// Null if the id doesn't resolve, some lines have no actor at all
+	const Actor* speaker = nullptr;
+	const Conversation* conversation = nullptr;
+};
+
+// Returns false if match isn't a dialog entry's string. Two id lookups, no scanning.
+bool ResolveMatchContext(const Corpus& corpus, const ManagedString& match, MatchContext& outContext);
+
+// Same, starting from a dense entry index
+MatchContext ResolveEntryContext(const Corpus& corpus, uint32 entryIndex);
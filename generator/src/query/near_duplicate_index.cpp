@@ -0,0 +1,339 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "query/near_duplicate_index.h"
+
+#include "profiling/profiler.h"
+#include "threading/thread_pool.h"
+
+#include <heart/debug/assert.h>
+
+#include <heart/stl/string.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include <utility>
+
+namespace
+{
+	constexpr uint32 ShingleBytes = 5;
+
+	// Buckets bigger than this compare each entry to the next few only, otherwise one
+	// recycled bark in a thousand places would cost a million comparisons
+	constexpr uint32 MaxPairwiseBucket = 32;
+
+	uint64 Mix64(uint64 x)
+	{
+		// splitmix64 finalizer
+		x ^= x >> 30;
+		x *= 0xBF58476D1CE4E5B9ull;
+		x ^= x >> 27;
+		x *= 0x94D049BB133111EBull;
+		x ^= x >> 31;
+		return x;
+	}
+
+	// One multiply-add per permutation, applied to the already mixed shingle hash
+	struct PermutationTable
+	{
+		uint64 multipliers[NearDuplicateIndex::SignatureSize];
+		uint64 offsets[NearDuplicateIndex::SignatureSize];
+
+		PermutationTable()
+		{
+			for (uint32 i = 0; i < NearDuplicateIndex::SignatureSize; ++i)
+			{
+				multipliers[i] = Mix64(i * 2 + 1) | 1;
+				offsets[i] = Mix64(i * 2 + 2);
+			}
+		}
+	};
+
+	const PermutationTable& GetPermutations()
+	{
+		static const PermutationTable table;
+		return table;
+	}
+
+	// ASCII case folded, and every run of whitespace or punctuation turned into one space, so
+	// "Yes... yes." and "yes, yes" shingle the same. Other bytes are kept as they are.
+	void NormalizeText(std::string_view text, hrt::string& out)
+	{
+		out.clear();
+		bool pendingSpace = false;
+		for (char c : text)
+		{
+			uint8 byte = uint8(c);
+			bool isLetter = (byte >= 'a' && byte <= 'z') || (byte >= 'A' && byte <= 'Z') || (byte >= '0' && byte <= '9') || byte >= 0x80;
+			if (!isLetter)
+			{
+				pendingSpace = !out.empty();
+				continue;
+			}
+
+			if (pendingSpace)
+				out.push_back(' ');
+			pendingSpace = false;
+
+			out.push_back(byte >= 'A' && byte <= 'Z' ? char(byte - 'A' + 'a') : c);
+		}
+	}
+
+	void ComputeSignature(std::string_view text, hrt::string& scratch, uint16* outSignature)
+	{
+		NormalizeText(text, scratch);
+		if (scratch.empty())
+			return;
+
+		const PermutationTable& permutations = GetPermutations();
+
+		uint64 minimums[NearDuplicateIndex::SignatureSize];
+		std::fill(std::begin(minimums), std::end(minimums), ~uint64(0));
+
+		// Anything shorter than a shingle is one shingle of its own
+		size_t shingleCount = scratch.size() >= ShingleBytes ? scratch.size() - ShingleBytes + 1 : 1;
+		size_t shingleSize = scratch.size() >= ShingleBytes ? ShingleBytes : scratch.size();
+		for (size_t start = 0; start < shingleCount; ++start)
+		{
+			uint64 packed = shingleSize;
+			for (size_t i = 0; i < shingleSize; ++i)
+			{
+				packed = (packed << 8) | uint8(scratch[start + i]);
+			}
+
+			uint64 hash = Mix64(packed);
+			for (uint32 i = 0; i < NearDuplicateIndex::SignatureSize; ++i)
+			{
+				uint64 permuted = hash * permutations.multipliers[i] + permutations.offsets[i];
+				minimums[i] = permuted < minimums[i] ? permuted : minimums[i];
+			}
+		}
+
+		for (uint32 i = 0; i < NearDuplicateIndex::SignatureSize; ++i)
+		{
+			outSignature[i] = uint16(minimums[i] >> 48);
+		}
+	}
+
+	bool IsEmptySignature(const uint16* signature)
+	{
+		for (uint32 i = 0; i < NearDuplicateIndex::SignatureSize; ++i)
+		{
+			if (signature[i] != 0)
+				return false;
+		}
+
+		return true;
+	}
+
+	class DisjointSets
+	{
+		hrt::vector<uint32> m_parents;
+
+	public:
+		explicit DisjointSets(uint32 count) :
+			m_parents(count)
+		{
+			for (uint32 i = 0; i < count; ++i)
+			{
+				m_parents[i] = i;
+			}
+		}
+
+		uint32 Find(uint32 x)
+		{
+			while (m_parents[x] != x)
+			{
+				m_parents[x] = m_parents[m_parents[x]];
+				x = m_parents[x];
+			}
+
+			return x;
+		}
+
+		// The smaller index becomes the root, so roots are the first entry of their cluster
+		void Unite(uint32 a, uint32 b)
+		{
+			a = Find(a);
+			b = Find(b);
+			if (a < b)
+				m_parents[b] = a;
+			else if (b < a)
+				m_parents[a] = b;
+		}
+	};
+}
+
+uint32 NearDuplicateIndex::Build(const EntityVector<DialogEntry>& entries, const ManagedStringPool& pool, ThreadPool* threads)
+{
+	PROFILE_SCOPE("NearDuplicateIndex::Build");
+
+	m_entryCount = uint32(entries.size());
+	m_signatures.assign(size_t(m_entryCount) * SignatureSize, 0);
+	m_bucketEntries.clear();
+	m_bucketStarts.clear();
+
+	// Texts are cut into blocks so each job reuses one scratch string
+	constexpr uint32 BlockSize = 256;
+	uint32 blockCount = (m_entryCount + BlockSize - 1) / BlockSize;
+	auto signBlock = [&](uint32 block) {
+		hrt::string scratch;
+		uint32 end = std::min(m_entryCount, (block + 1) * BlockSize);
+		for (uint32 entry = block * BlockSize; entry < end; ++entry)
+		{
+			const ManagedString& text = entries[entry].dialogText;
+			ComputeSignature(std::string_view(text.CStr(pool), text.GetSize()), scratch, m_signatures.data() + size_t(entry) * SignatureSize);
+		}
+	};
+
+	// A band's rows, 4 x 16 bits, fit a key exactly, so a bucket holds only true band matches
+	static_assert(RowsPerBand * 16 == 64);
+	hrt::vector<hrt::vector<uint32>> bandBuckets(BandCount);
+	hrt::vector<hrt::vector<uint32>> bandStarts(BandCount);
+	auto bucketBand = [&](uint32 band) {
+		hrt::vector<std::pair<uint64, uint32>> keys;
+		keys.reserve(m_entryCount);
+		for (uint32 entry = 0; entry < m_entryCount; ++entry)
+		{
+			const uint16* signature = GetSignature(entry);
+			if (IsEmptySignature(signature))
+				continue;
+
+			uint64 key = 0;
+			for (uint32 row = 0; row < RowsPerBand; ++row)
+			{
+				key = (key << 16) | signature[band * RowsPerBand + row];
+			}
+
+			keys.emplace_back(key, entry);
+		}
+
+		std::sort(keys.begin(), keys.end());
+
+		for (size_t begin = 0; begin < keys.size();)
+		{
+			size_t end = begin + 1;
+			while (end < keys.size() && keys[end].first == keys[begin].first)
+				++end;
+
+			if (end - begin > 1)
+			{
+				bandStarts[band].push_back(uint32(bandBuckets[band].size()));
+				for (size_t i = begin; i < end; ++i)
+				{
+					bandBuckets[band].push_back(keys[i].second);
+				}
+			}
+
+			begin = end;
+		}
+	};
+
+	if (threads)
+	{
+		threads->ParallelFor(blockCount, signBlock);
+		threads->ParallelFor(BandCount, bucketBand);
+	}
+	else
+	{
+		for (uint32 block = 0; block < blockCount; ++block)
+		{
+			signBlock(block);
+		}
+		for (uint32 band = 0; band < BandCount; ++band)
+		{
+			bucketBand(band);
+		}
+	}
+
+	for (uint32 band = 0; band < BandCount; ++band)
+	{
+		uint32 base = uint32(m_bucketEntries.size());
+		for (uint32 start : bandStarts[band])
+		{
+			m_bucketStarts.push_back(base + start);
+		}
+
+		m_bucketEntries.insert(m_bucketEntries.end(), bandBuckets[band].begin(), bandBuckets[band].end());
+	}
+	m_bucketStarts.push_back(uint32(m_bucketEntries.size()));
+
+	return GetBucketCount();
+}
+
+float NearDuplicateIndex::EstimateSimilarity(uint32 a, uint32 b) const
+{
+	HEART_ASSERT(a < m_entryCount && b < m_entryCount);
+
+	const uint16* first = GetSignature(a);
+	const uint16* second = GetSignature(b);
+
+	uint32 agreeing = 0;
+	for (uint32 i = 0; i < SignatureSize; ++i)
+	{
+		agreeing += first[i] == second[i] ? 1 : 0;
+	}
+
+	return float(agreeing) / float(SignatureSize);
+}
+
+hrt::vector<DuplicateCluster> NearDuplicateIndex::FindClusters(float threshold) const
+{
+	PROFILE_SCOPE("NearDuplicateIndex::FindClusters");
+
+	DisjointSets sets(m_entryCount);
+	auto link = [&](uint32 a, uint32 b) {
+		if (sets.Find(a) != sets.Find(b) && EstimateSimilarity(a, b) >= threshold)
+			sets.Unite(a, b);
+	};
+
+	for (uint32 bucket = 0; bucket < GetBucketCount(); ++bucket)
+	{
+		const uint32* members = m_bucketEntries.data() + m_bucketStarts[bucket];
+		uint32 count = m_bucketStarts[bucket + 1] - m_bucketStarts[bucket];
+
+		for (uint32 i = 0; i < count; ++i)
+		{
+			uint32 last = count <= MaxPairwiseBucket ? count : std::min(count, i + 1 + MaxPairwiseBucket);
+			for (uint32 j = i + 1; j < last; ++j)
+			{
+				link(members[i], members[j]);
+			}
+		}
+	}
+
+	// Roots are the smallest index in their set, so walking in order meets each cluster's
+	// root before any of its other entries
+	hrt::vector<uint32> clusterOf(m_entryCount, UINT32_MAX);
+	hrt::vector<DuplicateCluster> clusters;
+	for (uint32 entry = 0; entry < m_entryCount; ++entry)
+	{
+		uint32 root = sets.Find(entry);
+		if (root == entry)
+			continue;
+
+		if (clusterOf[root] == UINT32_MAX)
+		{
+			clusterOf[root] = uint32(clusters.size());
+			clusters.emplace_back().entries.push_back(root);
+		}
+
+		clusters[clusterOf[root]].entries.push_back(entry);
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const DuplicateCluster& a, const DuplicateCluster& b) { return a.entries.size() > b.entries.size(); });
+	return clusters;
+}
+
+size_t NearDuplicateIndex::GetMemoryUsage() const
+{
+	return m_signatures.capacity() * sizeof(uint16) + m_bucketEntries.capacity() * sizeof(uint32) + m_bucketStarts.capacity() * sizeof(uint32);
+}
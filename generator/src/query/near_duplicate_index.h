@@ -0,0 +1,76 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "memory/managed_string.h"
+#include "memory/memory_tracker.h"
+#include "types/dialogue_entry.h"
+
+#include <heart/types.h>
+
+#include <heart/stl/vector.h>
+
+class ThreadPool;
+
+struct DuplicateCluster
+{
+	// Dense entry indices, ascending
+	hrt::vector<uint32> entries;
+};
+
+// MinHash signatures over every dialog entry's text, banded for locality-sensitive lookup.
+//
+// Each text is case-folded with punctuation and whitespace collapsed, then cut into
+// overlapping 5-byte shingles. The signature keeps the minimum of SignatureSize hashes
+// over those shingles, so the fraction of positions two signatures agree on estimates the
+// Jaccard similarity of their shingle sets. Entries whose signatures agree on a whole
+// band share a bucket, and only entries sharing a bucket are ever compared. With 16 bands
+// of 4, a pair at 0.5 shares one two times in three, and a pair at 0.7 nearly always.
+class NearDuplicateIndex
+{
+public:
+	static constexpr uint32 SignatureSize = 64;
+	static constexpr uint32 BandCount = 16;
+	static constexpr uint32 RowsPerBand = SignatureSize / BandCount;
+
+private:
+	// The top 16 bits of each minimum, plenty to tell hashes apart at this size
+	hrt::vector<uint16> m_signatures;
+	uint32 m_entryCount = 0;
+
+	// Only buckets with more than one entry are kept, every band's one after the other.
+	// Bucket i is m_bucketEntries[m_bucketStarts[i], m_bucketStarts[i + 1]).
+	hrt::vector<uint32> m_bucketEntries;
+	hrt::vector<uint32> m_bucketStarts;
+
+	const uint16* GetSignature(uint32 entry) const
+	{
+		return m_signatures.data() + size_t(entry) * SignatureSize;
+	}
+
+public:
+	// Entries with no text get an empty signature and are never reported. Returns how many
+	// buckets hold more than one entry.
+	uint32 Build(const EntityVector<DialogEntry>& entries, const ManagedStringPool& pool, ThreadPool* threads = nullptr);
+
+	// Estimated Jaccard similarity of two entries' shingles, 0 to 1
+	float EstimateSimilarity(uint32 a, uint32 b) const;
+
+	// Groups of entries linked by estimated similarity of at least threshold, largest first.
+	// Linked pairs are only looked for within shared buckets, so this stays close to linear.
+	hrt::vector<DuplicateCluster> FindClusters(float threshold) const;
+
+	uint32 GetBucketCount() const
+	{
+		return m_bucketStarts.empty() ? 0 : uint32(m_bucketStarts.size() - 1);
+	}
+
+	size_t GetMemoryUsage() const;
+};
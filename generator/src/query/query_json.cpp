@@ -0,0 +1,72 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "query/query_json.h"
+
+#include "corpus/corpus.h"
+#include "query/match_context.h"
+
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+uint32 AppendQueryResultJson(hrt::string& out, const Corpus& corpus, std::string_view query, const hrt::vector<ManagedString>& matches, double latencyUs, QueryStop stop)
+{
+	const ManagedStringPool& pool = corpus.pool;
+	uint32 matchCount = 0;
+
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+
+	writer.StartObject();
+	writer.Key("query");
+	writer.String(query.data(), rapidjson::SizeType(query.size()));
+	writer.Key("latencyUs");
+	writer.Double(latencyUs);
+	if (stop != QueryStop::Completed)
+	{
+		writer.Key("partial");
+		writer.String(GetQueryStopName(stop));
+	}
+	writer.Key("matches");
+	writer.StartArray();
+	for (const ManagedString& match : matches)
+	{
+		MatchContext context;
+		if (!ResolveMatchContext(corpus, match, context))
+			continue;
+
+		writer.StartObject();
+		writer.Key("entry");
+		writer.Uint(context.entryIndex);
+		writer.Key("text");
+		writer.String(match.CStr(pool), rapidjson::SizeType(match.GetSize()));
+
+		MatchSpan span;
+		if (HashLookup::FindMatchSpan(std::string_view(match.CStr(pool), match.GetSize()), query, {}, span))
+		{
+			writer.Key("offset");
+			writer.Uint(span.offset);
+			writer.Key("length");
+			writer.Uint(span.length);
+		}
+
+		writer.Key("speaker");
+		writer.String(context.speaker ? context.speaker->name.CStr(pool) : "");
+		writer.Key("conversation");
+		writer.String(context.conversation ? context.conversation->title.CStr(pool) : "");
+		writer.EndObject();
+
+		++matchCount;
+	}
+	writer.EndArray();
+	writer.EndObject();
+
+	out.append(buffer.GetString(), buffer.GetSize());
+	return matchCount;
+}
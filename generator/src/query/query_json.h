@@ -0,0 +1,29 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "memory/hash_lookup.h"
+#include "memory/managed_string.h"
+
+#include <heart/types.h>
+
+#include <heart/stl/string.h>
+#include <heart/stl/vector.h>
+
+#include <string_view>
+
+struct Corpus;
+
+// Appends a single-line JSON object describing the dialog entries among matches to out
+// (without a trailing newline), each joined to its speaker and conversation title and
+// with the byte offset and length of the query within its text.
+// A lookup that was cut short also gets "partial" with the reason. Returns how many
+// matches were written.
+uint32 AppendQueryResultJson(hrt::string& out, const Corpus& corpus, std::string_view query, const hrt::vector<ManagedString>& matches, double latencyUs, QueryStop stop = QueryStop::Completed);
@@ -0,0 +1,350 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "query/similarity_index.h"
+
+#include "memory/hash_lookup.h"
+#include "profiling/profiler.h"
+#include "threading/thread_pool.h"
+
+#include <heart/debug/assert.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <emmintrin.h>
+#include <utility>
+
+namespace
+{
+	// How many of the best candidates from the first pass get scored exactly
+	constexpr uint32 CandidateCount = 256;
+
+	// Words in more entries than this share of them are skipped while gathering candidates
+	constexpr float CommonTermFraction = 0.05f;
+
+	constexpr uint32 BuildBlockSize = 256;
+
+	typedef std::pair<uint32, uint32> WordCount;
+
+	// Sorts hashes and collapses them into (hash, occurrences), ascending by hash
+	void CountWords(hrt::vector<uint32>& hashes, hrt::vector<WordCount>& outCounts)
+	{
+		std::sort(hashes.begin(), hashes.end());
+
+		outCounts.clear();
+		for (uint32 hash : hashes)
+		{
+			if (!outCounts.empty() && outCounts.back().first == hash)
+				++outCounts.back().second;
+			else
+				outCounts.emplace_back(hash, 1);
+		}
+	}
+
+	float GetTermFrequencyWeight(uint32 occurrences)
+	{
+		return 1.0f + std::log(float(occurrences));
+	}
+
+	void Normalize(float* weights, size_t count)
+	{
+		float squares = 0.0f;
+		for (size_t i = 0; i < count; ++i)
+		{
+			squares += weights[i] * weights[i];
+		}
+
+		if (squares <= 0.0f)
+			return;
+
+		float scale = 1.0f / std::sqrt(squares);
+		for (size_t i = 0; i < count; ++i)
+		{
+			weights[i] *= scale;
+		}
+	}
+
+	// Dot product of two sparse vectors with ascending term ids. Four ids from each side are
+	// compared at once: rotating b's block three times lines every pair up in some lane, and
+	// since ids don't repeat, each lane of a matches at most once across the rotations.
+	float SparseDot(const uint32* aTerms, const float* aWeights, uint32 aCount, const uint32* bTerms, const float* bWeights, uint32 bCount)
+	{
+		__m128 sum = _mm_setzero_ps();
+
+		uint32 i = 0;
+		uint32 j = 0;
+		while (i + 4 <= aCount && j + 4 <= bCount)
+		{
+			__m128i aIds = _mm_loadu_si128((const __m128i*)(aTerms + i));
+			__m128 aValues = _mm_loadu_ps(aWeights + i);
+			__m128i bIds = _mm_loadu_si128((const __m128i*)(bTerms + j));
+			__m128 bValues = _mm_loadu_ps(bWeights + j);
+
+			for (uint32 rotation = 0; rotation < 4; ++rotation)
+			{
+				__m128 match = _mm_castsi128_ps(_mm_cmpeq_epi32(aIds, bIds));
+				sum = _mm_add_ps(sum, _mm_mul_ps(aValues, _mm_and_ps(bValues, match)));
+
+				bIds = _mm_shuffle_epi32(bIds, _MM_SHUFFLE(0, 3, 2, 1));
+				bValues = _mm_shuffle_ps(bValues, bValues, _MM_SHUFFLE(0, 3, 2, 1));
+			}
+
+			// Whichever block ends lower can't match anything further along the other side
+			uint32 aLast = aTerms[i + 3];
+			uint32 bLast = bTerms[j + 3];
+			if (aLast <= bLast)
+				i += 4;
+			if (bLast <= aLast)
+				j += 4;
+		}
+
+		__m128 shuffled = _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(2, 3, 0, 1));
+		sum = _mm_add_ps(sum, shuffled);
+		sum = _mm_add_ss(sum, _mm_movehl_ps(shuffled, sum));
+		float result = _mm_cvtss_f32(sum);
+
+		while (i < aCount && j < bCount)
+		{
+			if (aTerms[i] < bTerms[j])
+			{
+				++i;
+			}
+			else if (bTerms[j] < aTerms[i])
+			{
+				++j;
+			}
+			else
+			{
+				result += aWeights[i++] * bWeights[j++];
+			}
+		}
+
+		return result;
+	}
+}
+
+uint32 SimilarityIndex::Build(const EntityVector<DialogEntry>& entries, const ManagedStringPool& pool, ThreadPool* threads)
+{
+	PROFILE_SCOPE("SimilarityIndex::Build");
+
+	m_entryCount = uint32(entries.size());
+
+	auto forEachBlock = [&](auto&& func) {
+		uint32 blockCount = (m_entryCount + BuildBlockSize - 1) / BuildBlockSize;
+		auto runBlock = [&](uint32 block) {
+			uint32 end = std::min(m_entryCount, (block + 1) * BuildBlockSize);
+			func(block * BuildBlockSize, end);
+		};
+
+		if (threads)
+		{
+			threads->ParallelFor(blockCount, runBlock);
+		}
+		else
+		{
+			for (uint32 block = 0; block < blockCount; ++block)
+			{
+				runBlock(block);
+			}
+		}
+	};
+
+	// Each entry's distinct words and how often it uses them
+	hrt::vector<hrt::vector<WordCount>> entryWords(m_entryCount);
+	forEachBlock([&](uint32 begin, uint32 end) {
+		hrt::vector<uint32> hashes;
+		for (uint32 entry = begin; entry < end; ++entry)
+		{
+			const ManagedString& text = entries[entry].dialogText;
+
+			hashes.clear();
+			HashLookup::HashWords(std::string_view(text.CStr(pool), text.GetSize()), LookupOptions {}, hashes);
+			CountWords(hashes, entryWords[entry]);
+		}
+	});
+
+	// Every entry lists a word once, so after sorting, the length of each run is how many
+	// entries use it
+	m_rowStarts.assign(m_entryCount + 1, 0);
+	hrt::vector<uint32> allWords;
+	for (uint32 entry = 0; entry < m_entryCount; ++entry)
+	{
+		m_rowStarts[entry + 1] = m_rowStarts[entry] + uint32(entryWords[entry].size());
+	}
+
+	allWords.reserve(m_rowStarts.back());
+	for (const hrt::vector<WordCount>& words : entryWords)
+	{
+		for (const WordCount& word : words)
+		{
+			allWords.push_back(word.first);
+		}
+	}
+	std::sort(allWords.begin(), allWords.end());
+
+	m_termHashes.clear();
+	m_termIdf.clear();
+	m_postingStarts.assign(1, 0);
+	for (size_t begin = 0; begin < allWords.size();)
+	{
+		size_t end = begin + 1;
+		while (end < allWords.size() && allWords[end] == allWords[begin])
+			++end;
+
+		uint32 documentFrequency = uint32(end - begin);
+		m_termHashes.push_back(allWords[begin]);
+		m_termIdf.push_back(std::log(1.0f + float(m_entryCount) / float(documentFrequency)));
+		m_postingStarts.push_back(m_postingStarts.back() + documentFrequency);
+
+		begin = end;
+	}
+	allWords = {};
+
+	// Words come out of each entry sorted by hash, which is the term order too
+	m_rowTerms.resize(m_rowStarts.back());
+	m_rowWeights.resize(m_rowStarts.back());
+	forEachBlock([&](uint32 begin, uint32 end) {
+		for (uint32 entry = begin; entry < end; ++entry)
+		{
+			uint32 row = m_rowStarts[entry];
+			for (const WordCount& word : entryWords[entry])
+			{
+				uint32 term = FindTerm(word.first);
+				m_rowTerms[row] = term;
+				m_rowWeights[row] = GetTermFrequencyWeight(word.second) * m_termIdf[term];
+				++row;
+			}
+
+			Normalize(m_rowWeights.data() + m_rowStarts[entry], row - m_rowStarts[entry]);
+		}
+	});
+	entryWords = {};
+
+	// Filling term by term in entry order keeps each posting list ascending
+	m_postingEntries.resize(m_rowStarts.back());
+	m_postingWeights.resize(m_rowStarts.back());
+	hrt::vector<uint32> cursors(m_postingStarts.begin(), m_postingStarts.end() - 1);
+	for (uint32 entry = 0; entry < m_entryCount; ++entry)
+	{
+		for (uint32 row = m_rowStarts[entry]; row < m_rowStarts[entry + 1]; ++row)
+		{
+			uint32 posting = cursors[m_rowTerms[row]]++;
+			m_postingEntries[posting] = entry;
+			m_postingWeights[posting] = m_rowWeights[row];
+		}
+	}
+
+	return GetTermCount();
+}
+
+uint32 SimilarityIndex::FindTerm(uint32 hash) const
+{
+	auto iter = std::lower_bound(m_termHashes.begin(), m_termHashes.end(), hash);
+	if (iter == m_termHashes.end() || *iter != hash)
+		return UINT32_MAX;
+
+	return uint32(iter - m_termHashes.begin());
+}
+
+void SimilarityIndex::FindSimilar(const QueryVector& query, uint32 excludedEntry, uint32 count, hrt::vector<SimilarEntry>& outResults) const
+{
+	PROFILE_SCOPE("SimilarityIndex::FindSimilar");
+
+	outResults.clear();
+	if (query.terms.empty() || count == 0)
+		return;
+
+	auto getFrequency = [this](uint32 term) { return m_postingStarts[term + 1] - m_postingStarts[term]; };
+
+	uint32 commonLimit = uint32(float(m_entryCount) * CommonTermFraction);
+	bool anyRare = std::any_of(query.terms.begin(), query.terms.end(), [&](uint32 term) { return getFrequency(term) <= commonLimit; });
+
+	hrt::vector<float> scores(m_entryCount, 0.0f);
+	hrt::vector<uint32> touched;
+	for (size_t i = 0; i < query.terms.size(); ++i)
+	{
+		uint32 term = query.terms[i];
+		if (anyRare && getFrequency(term) > commonLimit)
+			continue;
+
+		for (uint32 posting = m_postingStarts[term]; posting < m_postingStarts[term + 1]; ++posting)
+		{
+			uint32 entry = m_postingEntries[posting];
+			if (entry == excludedEntry)
+				continue;
+
+			// Weights are all positive, so zero means untouched
+			if (scores[entry] == 0.0f)
+				touched.push_back(entry);
+			scores[entry] += query.weights[i] * m_postingWeights[posting];
+		}
+	}
+
+	uint32 candidateCount = std::max(CandidateCount, count);
+	if (touched.size() > candidateCount)
+	{
+		std::nth_element(touched.begin(), touched.begin() + candidateCount, touched.end(), [&](uint32 a, uint32 b) { return scores[a] > scores[b]; });
+		touched.resize(candidateCount);
+	}
+
+	outResults.reserve(touched.size());
+	for (uint32 entry : touched)
+	{
+		uint32 row = m_rowStarts[entry];
+		uint32 rowSize = m_rowStarts[entry + 1] - row;
+		float score = SparseDot(query.terms.data(), query.weights.data(), uint32(query.terms.size()), m_rowTerms.data() + row, m_rowWeights.data() + row, rowSize);
+		outResults.push_back(SimilarEntry {entry, score});
+	}
+
+	std::sort(outResults.begin(), outResults.end(), [](const SimilarEntry& a, const SimilarEntry& b) { return a.score != b.score ? a.score > b.score : a.entry < b.entry; });
+	if (outResults.size() > count)
+		outResults.resize(count);
+}
+
+void SimilarityIndex::FindSimilar(uint32 entry, uint32 count, hrt::vector<SimilarEntry>& outResults) const
+{
+	HEART_ASSERT(entry < m_entryCount);
+
+	QueryVector query;
+	query.terms.assign(m_rowTerms.begin() + m_rowStarts[entry], m_rowTerms.begin() + m_rowStarts[entry + 1]);
+	query.weights.assign(m_rowWeights.begin() + m_rowStarts[entry], m_rowWeights.begin() + m_rowStarts[entry + 1]);
+
+	FindSimilar(query, entry, count, outResults);
+}
+
+void SimilarityIndex::FindSimilar(std::string_view text, uint32 count, hrt::vector<SimilarEntry>& outResults) const
+{
+	hrt::vector<uint32> hashes;
+	hrt::vector<WordCount> words;
+	HashLookup::HashWords(text, LookupOptions {}, hashes);
+	CountWords(hashes, words);
+
+	QueryVector query;
+	for (const WordCount& word : words)
+	{
+		uint32 term = FindTerm(word.first);
+		if (term == UINT32_MAX)
+			continue;
+
+		query.terms.push_back(term);
+		query.weights.push_back(GetTermFrequencyWeight(word.second) * m_termIdf[term]);
+	}
+	Normalize(query.weights.data(), query.weights.size());
+
+	FindSimilar(query, UINT32_MAX, count, outResults);
+}
+
+size_t SimilarityIndex::GetMemoryUsage() const
+{
+	size_t bytes = m_termHashes.capacity() * sizeof(uint32) + m_termIdf.capacity() * sizeof(float);
+	bytes += (m_rowStarts.capacity() + m_rowTerms.capacity()) * sizeof(uint32) + m_rowWeights.capacity() * sizeof(float);
+	bytes += (m_postingStarts.capacity() + m_postingEntries.capacity()) * sizeof(uint32) + m_postingWeights.capacity() * sizeof(float);
+	return bytes;
+}
@@ -0,0 +1,84 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "memory/managed_string.h"
+#include "memory/memory_tracker.h"
+#include "types/dialogue_entry.h"
+
+#include <heart/types.h>
+
+#include <heart/stl/vector.h>
+
+#include <string_view>
+
+class ThreadPool;
+
+struct SimilarEntry
+{
+	uint32 entry = 0;
+
+	// Cosine of the two TF-IDF vectors, 0 to 1
+	float score = 0.0f;
+};
+
+// "More like this" over dialog entries. Each entry's text becomes a sparse TF-IDF vector
+// over the words HashLookup indexes, normalized so a dot product is the cosine.
+//
+// A query first runs through the inverted index, adding up partial scores for every entry
+// that shares one of its rarer words. Words in more than a few percent of entries would
+// touch most of the corpus for little signal, so that pass skips them unless nothing else
+// is left. The best few hundred candidates are then scored exactly against every word.
+class SimilarityIndex
+{
+	// Word hashes, sorted; a term's id is its position here
+	hrt::vector<uint32> m_termHashes;
+	hrt::vector<float> m_termIdf;
+
+	// Each entry's vector, term ids ascending. Row i is [m_rowStarts[i], m_rowStarts[i + 1]).
+	hrt::vector<uint32> m_rowStarts;
+	hrt::vector<uint32> m_rowTerms;
+	hrt::vector<float> m_rowWeights;
+
+	// The same weights by term, entries ascending
+	hrt::vector<uint32> m_postingStarts;
+	hrt::vector<uint32> m_postingEntries;
+	hrt::vector<float> m_postingWeights;
+
+	uint32 m_entryCount = 0;
+
+	struct QueryVector
+	{
+		hrt::vector<uint32> terms;
+		hrt::vector<float> weights;
+	};
+
+	uint32 FindTerm(uint32 hash) const;
+
+	void FindSimilar(const QueryVector& query, uint32 excludedEntry, uint32 count, hrt::vector<SimilarEntry>& outResults) const;
+
+public:
+	// Returns how many distinct words the vectors are made of
+	uint32 Build(const EntityVector<DialogEntry>& entries, const ManagedStringPool& pool, ThreadPool* threads = nullptr);
+
+	// The count entries most like this one, best first, leaving out the entry itself and
+	// anything sharing no words with it
+	void FindSimilar(uint32 entry, uint32 count, hrt::vector<SimilarEntry>& outResults) const;
+
+	// Same for any text, weighted by the corpus' statistics. Unknown words are ignored.
+	void FindSimilar(std::string_view text, uint32 count, hrt::vector<SimilarEntry>& outResults) const;
+
+	uint32 GetTermCount() const
+	{
+		return uint32(m_termHashes.size());
+	}
+
+	size_t GetMemoryUsage() const;
+};
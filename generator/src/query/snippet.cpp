@@ -0,0 +1,89 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "query/snippet.h"
+
+#include <heart/debug/assert.h>
+
+namespace
+{
+	bool IsContinuationByte(char c)
+	{
+		return (uint8(c) & 0xC0) == 0x80;
+	}
+
+	bool IsBreak(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n';
+	}
+
+	// Moves start forward to just past the first break before limit, or at least off the
+	// middle of a codepoint if the word runs all the way to the match
+	size_t SnapWindowStart(std::string_view text, size_t start, size_t limit)
+	{
+		if (IsBreak(text[start - 1]))
+			return start;
+
+		for (size_t i = start; i < limit; ++i)
+		{
+			if (IsBreak(text[i]))
+				return i + 1;
+		}
+
+		while (start < limit && IsContinuationByte(text[start]))
+			++start;
+
+		return start;
+	}
+
+	// Same for the end, moving back to the last break after limit
+	size_t SnapWindowEnd(std::string_view text, size_t end, size_t limit)
+	{
+		if (IsBreak(text[end]))
+			return end;
+
+		for (size_t i = end; i > limit; --i)
+		{
+			if (IsBreak(text[i - 1]))
+				return i - 1;
+		}
+
+		while (end > limit && IsContinuationByte(text[end]))
+			--end;
+
+		return end;
+	}
+}
+
+void AppendSnippet(hrt::string& out, std::string_view text, MatchSpan span, const SnippetOptions& options)
+{
+	size_t matchBegin = span.offset;
+	size_t matchEnd = size_t(span.offset) + span.length;
+	HEART_ASSERT(matchEnd <= text.size());
+
+	size_t start = matchBegin > options.contextBytes ? matchBegin - options.contextBytes : 0;
+	size_t end = matchEnd + options.contextBytes < text.size() ? matchEnd + options.contextBytes : text.size();
+
+	if (start > 0)
+		start = SnapWindowStart(text, start, matchBegin);
+	if (end < text.size())
+		end = SnapWindowEnd(text, end, matchEnd);
+
+	if (start > 0)
+		out.append(options.ellipsis);
+
+	out.append(text.substr(start, matchBegin - start));
+	out.append(options.highlightBegin);
+	out.append(text.substr(matchBegin, matchEnd - matchBegin));
+	out.append(options.highlightEnd);
+	out.append(text.substr(matchEnd, end - matchEnd));
+
+	if (end < text.size())
+		out.append(options.ellipsis);
+}
@@ -0,0 +1,34 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "memory/hash_lookup.h"
+
+#include <heart/types.h>
+
+#include <heart/stl/string.h>
+
+#include <string_view>
+
+struct SnippetOptions
+{
+	// Bytes of context on either side of the match, before trimming back to whole words
+	uint32 contextBytes = 60;
+
+	const char* highlightBegin = "**";
+	const char* highlightEnd = "**";
+
+	// Marks where the window cut the text off
+	const char* ellipsis = "...";
+};
+
+// Appends the part of text around span, with the match itself wrapped in the highlight
+// markers. Short strings come out whole.
+void AppendSnippet(hrt::string& out, std::string_view text, MatchSpan span, const SnippetOptions& options = {});
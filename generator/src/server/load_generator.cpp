@@ -0,0 +1,175 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "server/load_generator.h"
+
+#include "os/winsock.h"
+
+#include <heart/stl/string.h>
+#include <heart/stl/vector.h>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+namespace
+{
+	SOCKET Connect(uint16 port)
+	{
+		SOCKET socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if (socket == INVALID_SOCKET)
+			return INVALID_SOCKET;
+
+		sockaddr_in address = {};
+		address.sin_family = AF_INET;
+		address.sin_port = htons(port);
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		if (connect(socket, (const sockaddr*)&address, sizeof(address)) == SOCKET_ERROR)
+		{
+			closesocket(socket);
+			return INVALID_SOCKET;
+		}
+
+		BOOL noDelay = TRUE;
+		setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+		return socket;
+	}
+
+	bool SendAll(SOCKET socket, const hrt::string& data)
+	{
+		size_t offset = 0;
+		while (offset < data.size())
+		{
+			int sent = send(socket, data.data() + offset, int(data.size() - offset), 0);
+			if (sent == SOCKET_ERROR)
+				return false;
+
+			offset += size_t(sent);
+		}
+
+		return true;
+	}
+
+	// Reads until a full response line is buffered, then drops it from the buffer
+	bool ReceiveLine(SOCKET socket, hrt::string& buffer)
+	{
+		char chunk[16 * 1024];
+		while (true)
+		{
+			if (size_t newline = buffer.find('\n'); newline != hrt::string::npos)
+			{
+				buffer.erase(0, newline + 1);
+				return true;
+			}
+
+			int received = recv(socket, chunk, int(sizeof(chunk)), 0);
+			if (received <= 0)
+				return false;
+
+			buffer.append(chunk, size_t(received));
+		}
+	}
+
+	void RunConnection(const LoadGeneratorConfig& config, const hrt::vector<hrt::string>& queries, uint32 connectionIndex, hrt::vector<double>& outLatencies, std::atomic<uint32>& failedConnections)
+	{
+		SOCKET socket = Connect(config.port);
+		if (socket == INVALID_SOCKET)
+		{
+			++failedConnections;
+			return;
+		}
+
+		outLatencies.reserve(config.requestsPerConnection);
+
+		hrt::string request;
+		hrt::string responses;
+		for (uint32 i = 0; i < config.requestsPerConnection; ++i)
+		{
+			// Offset every connection so they don't all hammer the same query at once
+			const hrt::string& query = queries[(connectionIndex + i) % queries.size()];
+			request.assign(query);
+			request.push_back('\n');
+
+			auto start = std::chrono::steady_clock::now();
+			if (!SendAll(socket, request) || !ReceiveLine(socket, responses))
+			{
+				++failedConnections;
+				break;
+			}
+			auto end = std::chrono::steady_clock::now();
+
+			outLatencies.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+		}
+
+		closesocket(socket);
+	}
+}
+
+bool RunLoadGenerator(const LoadGeneratorConfig& config, LoadGeneratorResult& outResult)
+{
+	outResult = {};
+
+	hrt::vector<hrt::string> queries;
+	{
+		std::ifstream input(config.queriesPath);
+		if (!input)
+			return false;
+
+		hrt::string line;
+		while (std::getline(input, line))
+		{
+			if (!line.empty() && line.back() == '\r')
+				line.pop_back();
+
+			if (!line.empty())
+				queries.push_back(std::move(line));
+		}
+	}
+
+	if (queries.empty() || config.connections == 0)
+		return false;
+
+	WinsockScope winsock;
+	if (!winsock.initialized)
+		return false;
+
+	hrt::vector<hrt::vector<double>> latencies(config.connections);
+	std::atomic<uint32> failedConnections = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	{
+		hrt::vector<std::thread> connections;
+		for (uint32 i = 0; i < config.connections; ++i)
+		{
+			connections.emplace_back([&, i]() { RunConnection(config, queries, i, latencies[i], failedConnections); });
+		}
+
+		for (std::thread& connection : connections)
+		{
+			connection.join();
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	hrt::vector<double> allLatencies;
+	for (hrt::vector<double>& connectionLatencies : latencies)
+	{
+		allLatencies.insert(allLatencies.end(), connectionLatencies.begin(), connectionLatencies.end());
+	}
+
+	outResult.requestsCompleted = allLatencies.size();
+	outResult.failedConnections = failedConnections;
+	outResult.wallSeconds = std::chrono::duration<double>(end - start).count();
+	outResult.queriesPerSecond = outResult.wallSeconds > 0.0 ? double(outResult.requestsCompleted) / outResult.wallSeconds : 0.0;
+	outResult.latency = SummarizeLatencies(allLatencies);
+
+	return outResult.requestsCompleted > 0;
+}
@@ -0,0 +1,38 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "query/latency_stats.h"
+
+#include <heart/types.h>
+
+struct LoadGeneratorConfig
+{
+	uint16 port = 0;
+	const char* queriesPath = nullptr;
+
+	uint32 connections = 8;
+	uint32 requestsPerConnection = 1000;
+};
+
+struct LoadGeneratorResult
+{
+	uint64 requestsCompleted = 0;
+	uint32 failedConnections = 0;
+
+	double wallSeconds = 0.0;
+	double queriesPerSecond = 0.0;
+
+	LatencySummary latency;
+};
+
+// Drives a running QueryServer from several connections at once. Every connection sends
+// one query, waits for its answer and sends the next, cycling through the queries file.
+bool RunLoadGenerator(const LoadGeneratorConfig& config, LoadGeneratorResult& outResult);
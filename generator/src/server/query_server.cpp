@@ -0,0 +1,329 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "server/query_server.h"
+
+#include "corpus/live_corpus.h"
+#include "os/winsock.h"
+#include "query/query_json.h"
+
+#include <heart/debug/assert.h>
+
+#include <heart/stl/string.h>
+#include <heart/stl/vector.h>
+
+#include <chrono>
+#include <iostream>
+#include <string_view>
+#include <thread>
+
+namespace
+{
+	// Anything longer than this without a newline is not a query, drop the client
+	constexpr size_t MaxLineLength = 64 * 1024;
+
+	// How often a loop with nothing to do checks whether it should stop
+	constexpr INT PollTimeoutMs = 100;
+
+	constexpr size_t ReceiveChunkSize = 16 * 1024;
+
+	struct Client
+	{
+		SOCKET socket = INVALID_SOCKET;
+		hrt::string input;
+		hrt::string output;
+		size_t outputOffset = 0;
+
+		// The peer won't send anything more, but still gets the answers already queued
+		bool peerClosed = false;
+		bool failed = false;
+
+		bool HasPendingOutput() const
+		{
+			return outputOffset < output.size();
+		}
+
+		bool IsFinished() const
+		{
+			return failed || (peerClosed && !HasPendingOutput());
+		}
+	};
+
+	bool SetNonBlocking(SOCKET socket)
+	{
+		u_long mode = 1;
+		return ioctlsocket(socket, FIONBIO, &mode) == 0;
+	}
+
+	void AcceptPending(SOCKET listenSocket, hrt::vector<Client>& clients, std::atomic<uint64>& acceptedCount)
+	{
+		while (true)
+		{
+			SOCKET socket = accept(listenSocket, nullptr, nullptr);
+			if (socket == INVALID_SOCKET)
+				return; // WSAEWOULDBLOCK, or another loop got there first
+
+			if (!SetNonBlocking(socket))
+			{
+				closesocket(socket);
+				continue;
+			}
+
+			BOOL noDelay = TRUE;
+			setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+
+			Client& client = clients.emplace_back();
+			client.socket = socket;
+			++acceptedCount;
+		}
+	}
+
+	// Returns false once the peer has closed its end or the connection failed
+	bool ReceiveAvailable(Client& client)
+	{
+		char chunk[ReceiveChunkSize];
+		while (true)
+		{
+			int received = recv(client.socket, chunk, int(sizeof(chunk)), 0);
+			if (received > 0)
+			{
+				client.input.append(chunk, size_t(received));
+				continue;
+			}
+
+			if (received == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK)
+				return true;
+
+			return false;
+		}
+	}
+
+	// Returns false if the connection failed
+	bool SendPending(Client& client)
+	{
+		while (client.HasPendingOutput())
+		{
+			size_t remaining = client.output.size() - client.outputOffset;
+			int sent = send(client.socket, client.output.data() + client.outputOffset, int(remaining), 0);
+			if (sent == SOCKET_ERROR)
+				return WSAGetLastError() == WSAEWOULDBLOCK;
+
+			client.outputOffset += size_t(sent);
+		}
+
+		client.output.clear();
+		client.outputOffset = 0;
+		return true;
+	}
+}
+
+QueryServer::QueryServer(LiveCorpus& corpus, const char* dumpPath) :
+	m_corpus(corpus),
+	m_dumpPath(dumpPath),
+	m_winsock(std::make_unique<WinsockScope>()),
+	m_listenSocket(INVALID_SOCKET)
+{
+}
+
+QueryServer::~QueryServer()
+{
+	if (m_listenSocket != INVALID_SOCKET)
+		closesocket(SOCKET(m_listenSocket));
+
+	m_listenSocket = INVALID_SOCKET;
+}
+
+bool QueryServer::Listen(uint16 port)
+{
+	HEART_ASSERT(m_listenSocket == INVALID_SOCKET);
+
+	if (!m_winsock->initialized)
+		return false;
+
+	SOCKET listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (listenSocket == INVALID_SOCKET)
+		return false;
+
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (bind(listenSocket, (const sockaddr*)&address, sizeof(address)) == SOCKET_ERROR || listen(listenSocket, SOMAXCONN) == SOCKET_ERROR || !SetNonBlocking(listenSocket))
+	{
+		closesocket(listenSocket);
+		return false;
+	}
+
+	m_listenSocket = listenSocket;
+	return true;
+}
+
+void QueryServer::Run(uint32 loopCount)
+{
+	HEART_ASSERT(m_listenSocket != INVALID_SOCKET);
+
+	hrt::vector<std::thread> extraLoops;
+	for (uint32 i = 1; i < loopCount; ++i)
+	{
+		extraLoops.emplace_back([this]() { RunEventLoop(); });
+	}
+
+	RunEventLoop();
+
+	for (std::thread& loop : extraLoops)
+	{
+		loop.join();
+	}
+}
+
+void QueryServer::SetQueryBudget(std::chrono::microseconds timeout, uint32 maxCandidates)
+{
+	m_queryTimeout = timeout;
+	m_maxCandidates = maxCandidates;
+}
+
+void QueryServer::SetAllowShutdown(bool allow)
+{
+	m_allowShutdown = allow;
+}
+
+void QueryServer::Stop()
+{
+	m_stopRequested = true;
+	m_stopToken.Cancel();
+}
+
+void QueryServer::RunEventLoop()
+{
+	SOCKET listenSocket = SOCKET(m_listenSocket);
+
+	LiveCorpus::Reader reader(m_corpus);
+
+	hrt::vector<Client> clients;
+	hrt::vector<WSAPOLLFD> pollFds;
+
+	while (!m_stopRequested)
+	{
+		pollFds.clear();
+		pollFds.push_back(WSAPOLLFD {listenSocket, POLLRDNORM, 0});
+		for (Client& client : clients)
+		{
+			SHORT events = client.peerClosed ? SHORT(0) : SHORT(POLLRDNORM);
+			if (client.HasPendingOutput())
+				events |= POLLWRNORM;
+
+			pollFds.push_back(WSAPOLLFD {client.socket, events, 0});
+		}
+
+		int readyCount = WSAPoll(pollFds.data(), ULONG(pollFds.size()), PollTimeoutMs);
+		if (readyCount == SOCKET_ERROR)
+		{
+			// Without this loop its clients would hang, so take the rest down with it
+			std::cout << "Event loop failed to poll (error " << WSAGetLastError() << "), stopping the server." << std::endl;
+			Stop();
+			break;
+		}
+		if (readyCount == 0)
+			continue;
+
+		// Only the clients that were polled; anything accepted below waits for the next pass
+		size_t polledClientCount = clients.size();
+
+		if (pollFds[0].revents & POLLRDNORM)
+			AcceptPending(listenSocket, clients, m_connectionsAccepted);
+
+		for (size_t i = 0; i < polledClientCount; ++i)
+		{
+			Client& client = clients[i];
+			SHORT revents = pollFds[i + 1].revents;
+
+			if (!client.peerClosed && (revents & (POLLRDNORM | POLLHUP | POLLERR)))
+			{
+				// Still answer whatever arrived before the peer hung up
+				if (!ReceiveAvailable(client))
+					client.peerClosed = true;
+			}
+
+			size_t lineStart = 0;
+			for (size_t lineEnd = client.input.find('\n'); lineEnd != hrt::string::npos; lineEnd = client.input.find('\n', lineStart))
+			{
+				std::string_view line(client.input.data() + lineStart, lineEnd - lineStart);
+				if (!line.empty() && line.back() == '\r')
+					line.remove_suffix(1);
+
+				lineStart = lineEnd + 1;
+
+				if (line == "shutdown")
+				{
+					if (m_allowShutdown)
+						Stop();
+					else
+						client.output.append("{\"shutdown\":\"refused\"}\n");
+					continue;
+				}
+
+				if (line == "reload")
+				{
+					bool started = m_corpus.BeginReload(m_dumpPath);
+					client.output.append(started ? "{\"reload\":\"started\"}\n" : "{\"reload\":\"busy\"}\n");
+					continue;
+				}
+
+				hrt::string query(line);
+				{
+					// The generation can't be freed until this guard is gone
+					LiveCorpus::ReadGuard corpus = reader.Read();
+
+					auto start = std::chrono::steady_clock::now();
+
+					QueryBudget budget = m_queryTimeout.count() > 0 ? QueryBudget::FromTimeout(m_queryTimeout) : QueryBudget {};
+					budget.maxCandidates = m_maxCandidates;
+					budget.cancellation = &m_stopToken;
+
+					LookupResult result = corpus->index.LookupWord(query.c_str(), budget);
+					auto end = std::chrono::steady_clock::now();
+
+					double latencyUs = std::chrono::duration<double, std::micro>(end - start).count();
+					AppendQueryResultJson(client.output, *corpus, line, result.matches, latencyUs, result.stop);
+				}
+				client.output.push_back('\n');
+
+				++m_queriesServed;
+			}
+
+			client.input.erase(0, lineStart);
+			if (client.input.size() > MaxLineLength)
+				client.failed = true;
+
+			if (!client.failed && !SendPending(client))
+				client.failed = true;
+		}
+
+		for (size_t i = 0; i < clients.size();)
+		{
+			if (clients[i].IsFinished())
+			{
+				closesocket(clients[i].socket);
+				if (i + 1 != clients.size())
+					clients[i] = std::move(clients.back());
+				clients.pop_back();
+			}
+			else
+			{
+				++i;
+			}
+		}
+	}
+
+	for (Client& client : clients)
+	{
+		closesocket(client.socket);
+	}
+}
@@ -0,0 +1,90 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "threading/cancellation_token.h"
+
+#include <heart/copy_move_semantics.h>
+#include <heart/types.h>
+
+#include <heart/stl/string.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+class LiveCorpus;
+struct WinsockScope;
+
+// Long-running query server on loopback TCP.
+//
+// The protocol is line framed: every '\n'-terminated line a client sends is a query,
+// and the server answers each one with a single line of JSON (see AppendQueryResultJson)
+// in the order they arrived. A line reading "shutdown" stops the server if that was
+// allowed with SetAllowShutdown, and "reload" loads the dump again in the background and
+// swaps it in without interrupting anyone.
+//
+// Each event loop owns its clients and multiplexes them with non-blocking sockets. Every
+// loop reads the current corpus generation directly; the query cache is the only shared
+// state with locks, and a hit only takes its shard's lock shared.
+class QueryServer
+{
+	LiveCorpus& m_corpus;
+	hrt::string m_dumpPath;
+
+	// Behind a pointer so including this doesn't pull WinSock2.h in after Windows.h
+	std::unique_ptr<WinsockScope> m_winsock;
+	uintptr_t m_listenSocket;
+
+	std::atomic<bool> m_stopRequested = false;
+	std::atomic<uint64> m_connectionsAccepted = 0;
+	std::atomic<uint64> m_queriesServed = 0;
+
+	// Zero means unlimited. Stopping also cancels whatever lookups are in flight.
+	std::chrono::microseconds m_queryTimeout {0};
+	uint32 m_maxCandidates = 0;
+	CancellationToken m_stopToken;
+
+	bool m_allowShutdown = false;
+
+	void RunEventLoop();
+
+public:
+	QueryServer(LiveCorpus& corpus, const char* dumpPath);
+	DISABLE_COPY_AND_MOVE_SEMANTICS(QueryServer);
+	~QueryServer();
+
+	bool Listen(uint16 port);
+
+	// Lookups that run out of either are answered with what they found so far, marked
+	// partial. Set before Run().
+	void SetQueryBudget(std::chrono::microseconds timeout, uint32 maxCandidates);
+
+	// Off by default, so a client can't take the server down for everyone else. Set
+	// before Run().
+	void SetAllowShutdown(bool allow);
+
+	// Blocks until Stop() is called or a client asks to shut down, running one event
+	// loop on this thread and loopCount - 1 more on their own threads.
+	void Run(uint32 loopCount);
+
+	void Stop();
+
+	uint64 GetConnectionsAccepted() const
+	{
+		return m_connectionsAccepted;
+	}
+
+	uint64 GetQueriesServed() const
+	{
+		return m_queriesServed;
+	}
+};
@@ -0,0 +1,35 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include <heart/copy_move_semantics.h>
+
+#include <atomic>
+
+// Set from one thread, polled by work running on others. Work that sees it stops at its
+// next check and returns whatever it has, there's no waiting for it to notice.
+class CancellationToken
+{
+	std::atomic<bool> m_cancelled = false;
+
+public:
+	CancellationToken() = default;
+	DISABLE_COPY_AND_MOVE_SEMANTICS(CancellationToken);
+
+	void Cancel()
+	{
+		m_cancelled.store(true, std::memory_order_relaxed);
+	}
+
+	bool IsCancelled() const
+	{
+		return m_cancelled.load(std::memory_order_relaxed);
+	}
+};
@@ -0,0 +1,226 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "threading/thread_pool.h"
+
+#include <heart/debug/assert.h>
+
+namespace
+{
+	// Which pool and worker the calling thread is, if any, so jobs submitted from a job go
+	// onto that worker's own deque
+	struct WorkerIdentity
+	{
+		const ThreadPool* pool = nullptr;
+		uint32 index = 0;
+	};
+
+	thread_local WorkerIdentity t_worker;
+}
+
+ThreadPool::ThreadPool(uint32 threadCount)
+{
+	if (threadCount == 0)
+		threadCount = GetHardwareThreadCount();
+
+	m_queues.reserve(threadCount);
+	for (uint32 i = 0; i < threadCount; ++i)
+	{
+		m_queues.push_back(std::make_unique<WorkerQueue>());
+	}
+
+	m_workers.reserve(threadCount);
+	for (uint32 i = 0; i < threadCount; ++i)
+	{
+		m_workers.emplace_back([this, i]() { WorkerMain(i); });
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_stopping = true;
+	}
+
+	m_wake.notify_all();
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+uint32 ThreadPool::GetHardwareThreadCount()
+{
+	uint32 count = std::thread::hardware_concurrency();
+	return count > 0 ? count : 1;
+}
+
+template <typename F>
+void ThreadPool::Sleep(std::unique_lock<std::mutex>& lock, F&& wake)
+{
+	++m_sleepers;
+	m_wake.wait(lock, wake);
+	--m_sleepers;
+}
+
+void ThreadPool::WorkerMain(uint32 workerIndex)
+{
+	t_worker = WorkerIdentity {this, workerIndex};
+
+	while (true)
+	{
+		if (TryRunOne())
+			continue;
+
+		std::unique_lock lock(m_mutex);
+		Sleep(lock, [this]() { return m_stopping || m_queuedTasks > 0; });
+
+		// Anything still queued gets run before the pool goes away
+		if (m_stopping && m_queuedTasks == 0)
+			return;
+	}
+}
+
+void ThreadPool::Push(Task task)
+{
+	HEART_ASSERT(!m_workers.empty());
+	++m_pendingTasks;
+
+	// Counted before it's queued, so the count never dips below what's queued
+	++m_queuedTasks;
+
+	if (t_worker.pool == this)
+	{
+		WorkerQueue& queue = *m_queues[t_worker.index];
+		std::lock_guard lock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+	}
+	else
+	{
+		std::lock_guard lock(m_injectedMutex);
+		m_injected.push_back(std::move(task));
+	}
+
+	// A sleeper counts itself before checking for work and we count the task before
+	// checking for sleepers, so one of us always sees the other. Taking the lock then
+	// makes sure a sleeper that saw no work has actually started waiting.
+	if (m_sleepers > 0)
+	{
+		{
+			std::lock_guard lock(m_mutex);
+		}
+
+		m_wake.notify_one();
+	}
+}
+
+bool ThreadPool::TryRunOne()
+{
+	Task task;
+	bool found = false;
+
+	// Our own newest job first, it's the most likely to still be in cache
+	bool isWorker = t_worker.pool == this;
+	if (isWorker)
+	{
+		WorkerQueue& queue = *m_queues[t_worker.index];
+		std::lock_guard lock(queue.mutex);
+		if (!queue.tasks.empty())
+		{
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+			found = true;
+		}
+	}
+
+	if (!found)
+	{
+		std::lock_guard lock(m_injectedMutex);
+		if (!m_injected.empty())
+		{
+			task = std::move(m_injected.front());
+			m_injected.pop_front();
+			found = true;
+		}
+	}
+
+	// Then the oldest job of whichever worker comes next
+	uint32 queueCount = uint32(m_queues.size());
+	uint32 first = isWorker ? t_worker.index + 1 : 0;
+	for (uint32 i = 0; i < queueCount && !found; ++i)
+	{
+		WorkerQueue& queue = *m_queues[(first + i) % queueCount];
+		std::lock_guard lock(queue.mutex);
+		if (!queue.tasks.empty())
+		{
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+			found = true;
+		}
+	}
+
+	if (!found)
+		return false;
+
+	--m_queuedTasks;
+	task.job();
+	Finish(task.group);
+	return true;
+}
+
+void ThreadPool::Finish(TaskGroup* group)
+{
+	bool groupDone = group && --group->m_pending == 0;
+	bool poolDone = --m_pendingTasks == 0;
+
+	if (groupDone || poolDone)
+	{
+		// Taking the lock orders this with a waiter that's between checking and sleeping
+		{
+			std::lock_guard lock(m_mutex);
+		}
+
+		m_wake.notify_all();
+	}
+}
+
+template <typename F>
+void ThreadPool::HelpUntil(F&& done)
+{
+	while (!done())
+	{
+		if (TryRunOne())
+			continue;
+
+		std::unique_lock lock(m_mutex);
+		Sleep(lock, [&]() { return done() || m_queuedTasks > 0; });
+	}
+}
+
+void ThreadPool::Submit(Job job)
+{
+	Push(Task {std::move(job), nullptr});
+}
+
+void ThreadPool::Wait()
+{
+	HelpUntil([this]() { return m_pendingTasks == 0; });
+}
+
+void ThreadPool::TaskGroup::Run(Job job)
+{
+	++m_pending;
+	m_pool.Push(Task {std::move(job), this});
+}
+
+void ThreadPool::TaskGroup::Wait()
+{
+	m_pool.HelpUntil([this]() { return m_pending == 0; });
+}
@@ -0,0 +1,145 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include <heart/copy_move_semantics.h>
+#include <heart/types.h>
+
+#include <heart/stl/vector.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Fixed-size pool of worker threads with work stealing. Each worker pushes the jobs it
+// submits onto its own deque and pops them newest first, idle workers steal the oldest
+// from the others, and jobs submitted from outside the pool go through a shared queue.
+class ThreadPool
+{
+public:
+	typedef std::function<void()> Job;
+
+	// Tracks the jobs run through it. Waiting on a group runs queued jobs rather than
+	// blocking, so groups can be waited on from inside jobs and nest freely.
+	class TaskGroup
+	{
+		friend class ThreadPool;
+
+		ThreadPool& m_pool;
+		std::atomic<uint32> m_pending = 0;
+
+	public:
+		explicit TaskGroup(ThreadPool& pool) :
+			m_pool(pool)
+		{
+		}
+
+		DISABLE_COPY_AND_MOVE_SEMANTICS(TaskGroup);
+
+		~TaskGroup()
+		{
+			Wait();
+		}
+
+		void Run(Job job);
+
+		void Wait();
+	};
+
+private:
+	struct Task
+	{
+		Job job;
+		TaskGroup* group = nullptr;
+	};
+
+	struct WorkerQueue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	hrt::vector<std::thread> m_workers;
+	hrt::vector<std::unique_ptr<WorkerQueue>> m_queues;
+
+	std::mutex m_injectedMutex;
+	std::deque<Task> m_injected;
+
+	// Sleeping workers and waiters all wait on m_wake, under m_mutex
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+
+	std::atomic<uint32> m_queuedTasks = 0;
+	std::atomic<uint32> m_pendingTasks = 0;
+
+	// Threads inside m_wake.wait, so Push can skip the mutex when nobody needs waking
+	std::atomic<uint32> m_sleepers = 0;
+	bool m_stopping = false;
+
+	void WorkerMain(uint32 workerIndex);
+
+	void Push(Task task);
+	bool TryRunOne();
+
+	// Waits on m_wake until wake() holds, counted in m_sleepers the whole time
+	template <typename F>
+	void Sleep(std::unique_lock<std::mutex>& lock, F&& wake);
+
+	void Finish(TaskGroup* group);
+
+	// Runs queued jobs until done() holds, sleeping when there's nothing to run
+	template <typename F>
+	void HelpUntil(F&& done);
+
+public:
+	// A thread count of 0 means one worker per hardware thread
+	explicit ThreadPool(uint32 threadCount = 0);
+	DISABLE_COPY_AND_MOVE_SEMANTICS(ThreadPool);
+	~ThreadPool();
+
+	static uint32 GetHardwareThreadCount();
+
+	uint32 GetThreadCount() const
+	{
+		return uint32(m_workers.size());
+	}
+
+	void Submit(Job job);
+
+	// Runs jobs until every submitted job has finished, including those of any group
+	void Wait();
+
+	// Calls func(index) for every index in [0, count), handing indices out to the workers
+	// one at a time so uneven work still balances. Blocks until all of them are done, and
+	// can be called from inside another job.
+	template <typename F>
+	void ParallelFor(uint32 count, F&& func)
+	{
+		std::atomic<uint32> next = 0;
+		uint32 jobCount = count < GetThreadCount() ? count : GetThreadCount();
+
+		TaskGroup group(*this);
+		for (uint32 i = 0; i < jobCount; ++i)
+		{
+			group.Run([&next, &func, count]() {
+				for (uint32 index = next++; index < count; index = next++)
+				{
+					func(index);
+				}
+			});
+		}
+
+		group.Wait();
+	}
+};
@@ -61,7 +61,7 @@ struct Actor
 };
 
 template <typename RapidjsonT>
-Actor ParseActor(RapidjsonT&& jsonObj)
+Actor ParseActor(RapidjsonT&& jsonObj, ManagedStringPool& pool)
 {
 	Actor result;
 
@@ -83,21 +83,21 @@ Actor ParseActor(RapidjsonT&& jsonObj)
 
 	ReadFromFieldsArray(result.articyId, fieldsArray, "Articy Id");
 
-	READ_NAMED_FROM_FIELDS_ARRAY(result, name, fieldsArray);
+	READ_NAMED_STRING_FROM_FIELDS_ARRAY(result, name, pool, fieldsArray);
 
-	ReadFromFieldsArray(result.characterShortName, fieldsArray, "character_short_name");
+	ReadFromFieldsArray(result.characterShortName, pool, fieldsArray, "character_short_name");
 
-	READ_NAMED_FROM_FIELDS_ARRAY(result, pictures, fieldsArray);
+	READ_NAMED_STRING_FROM_FIELDS_ARRAY(result, pictures, pool, fieldsArray);
 
-	READ_NAMED_FROM_FIELDS_ARRAY(result, description, fieldsArray);
+	READ_NAMED_STRING_FROM_FIELDS_ARRAY(result, description, pool, fieldsArray);
 
-	ReadFromFieldsArray(result.shortDescription, fieldsArray, "short_description");
+	ReadFromFieldsArray(result.shortDescription, pool, fieldsArray, "short_description");
 
-	READ_NAMED_FROM_FIELDS_ARRAY(result, longDescription, fieldsArray);
+	READ_NAMED_STRING_FROM_FIELDS_ARRAY(result, longDescription, pool, fieldsArray);
 
 	if (fieldsArray.Size() > 11)
 	{
-		printf("Character %s may have new and surprising fields.\n", result.name.CStr());
+		printf("Character %s may have new and surprising fields.\n", result.name.CStr(pool));
 	}
 
 	return result;
@@ -27,9 +27,11 @@ struct Conversation
 
 	uint64 articyId = 0;
 
-	uint32 dialogEntryCount = 0;
+	// The conversation's entries are the contiguous range
+	// [firstDialogEntry, firstDialogEntry + dialogEntryCount) of the corpus' dialog entries
+	uint32 firstDialogEntry = 0;
 
-	uint32 dialogEntries[2048] = {};
+	uint32 dialogEntryCount = 0;
 
 	std::array<ManagedString*, 1> GetStrings()
 	{
@@ -42,7 +44,7 @@ struct Conversation
 };
 
 template <typename RapidJsonT>
-Conversation ParseConversation(RapidJsonT&& jsonObj)
+Conversation ParseConversation(RapidJsonT&& jsonObj, ManagedStringPool& pool)
 {
 	Conversation result;
 
@@ -54,7 +56,7 @@ Conversation ParseConversation(RapidJsonT&& jsonObj)
 
 	READ_NAMED_SINGLE_FIELD(result, id, jsonObj);
 
-	READ_NAMED_FROM_FIELDS_ARRAY(result, title, fieldsArray);
+	READ_NAMED_STRING_FROM_FIELDS_ARRAY(result, title, pool, fieldsArray);
 
 	ReadFromFieldsArray(result.articyId, fieldsArray, "Articy Id");
 
@@ -15,6 +15,8 @@
 
 #include <heart/types.h>
 
+#include <array>
+
 struct DialogEntry
 {
 	static constexpr ObjectType Type = ObjectType::DialogEntry;
@@ -41,7 +43,7 @@ struct DialogEntry
 
 	int16 conditionPriority = 0;
 
-	// TODO: outgoing links
+	// Outgoing links are resolved into the corpus' DialogueGraph
 
 	uint64 outputId = 0;
 
@@ -62,8 +64,14 @@ struct DialogEntry
 	}
 };
 
+// Entry ids are only unique within their conversation
+inline uint64 MakeDialogEntryKey(int32 conversationId, int32 entryId)
+{
+	return (uint64(uint32(conversationId)) << 32) | uint64(uint32(entryId));
+}
+
 template <typename RapidjsonT>
-DialogEntry ParseDialogEntry(RapidjsonT&& jsonObj)
+DialogEntry ParseDialogEntry(RapidjsonT&& jsonObj, ManagedStringPool& pool)
 {
 	DialogEntry result;
 
@@ -83,11 +91,11 @@ DialogEntry ParseDialogEntry(RapidjsonT&& jsonObj)
 
 	READ_NAMED_SINGLE_FIELD(result, conditionPriority, jsonObj);
 
-	READ_NAMED_SINGLE_FIELD(result, conditionsString, jsonObj);
+	READ_NAMED_STRING_SINGLE_FIELD(result, conditionsString, pool, jsonObj);
 
-	ReadFromFieldsArray(result.title, fieldsArray, "Title");
+	ReadFromFieldsArray(result.title, pool, fieldsArray, "Title");
 
-	ReadFromFieldsArray(result.dialogText, fieldsArray, "Dialogue Text");
+	ReadFromFieldsArray(result.dialogText, pool, fieldsArray, "Dialogue Text");
 
 	ReadFromFieldsArray(result.articyId, fieldsArray, "Articy Id");
 
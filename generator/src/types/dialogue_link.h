@@ -0,0 +1,51 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "json/read_helpers.h"
+
+#include <heart/types.h>
+
+// One entry of a dialogue entry's "outgoingLinks". Only lives during loading, the
+// resolved links end up in the corpus' DialogueGraph.
+struct DialogLink
+{
+	int32 originConversationID = 0;
+
+	int32 originDialogueID = 0;
+
+	int32 destinationConversationID = 0;
+
+	int32 destinationDialogueID = 0;
+
+	uint8 isConnector = 0;
+
+	uint8 priority = 0;
+};
+
+template <typename RapidjsonT>
+DialogLink ParseDialogLink(RapidjsonT&& jsonObj)
+{
+	DialogLink result;
+
+	READ_NAMED_SINGLE_FIELD(result, originConversationID, jsonObj);
+
+	READ_NAMED_SINGLE_FIELD(result, originDialogueID, jsonObj);
+
+	READ_NAMED_SINGLE_FIELD(result, destinationConversationID, jsonObj);
+
+	READ_NAMED_SINGLE_FIELD(result, destinationDialogueID, jsonObj);
+
+	READ_NAMED_SINGLE_FIELD(result, isConnector, jsonObj);
+
+	READ_NAMED_SINGLE_FIELD(result, priority, jsonObj);
+
+	return result;
+}
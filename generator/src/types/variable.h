@@ -22,11 +22,11 @@ struct Variable
 {
 	static constexpr ObjectType Type = ObjectType::Variable;
 
-	int32 id;
+	int32 id = 0;
 
-	bool initialValueBool;
+	bool initialValueBool = false;
 
-	int32 initialValueNumber;
+	int32 initialValueNumber = 0;
 
 	ManagedString name;
 
@@ -44,7 +44,7 @@ struct Variable
 };
 
 template <typename RapidjsonT>
-Variable ParseVariable(RapidjsonT&& jsonObj)
+Variable ParseVariable(RapidjsonT&& jsonObj, ManagedStringPool& pool)
 {
 	Variable result;
 
@@ -56,20 +56,25 @@ Variable ParseVariable(RapidjsonT&& jsonObj)
 
 	READ_NAMED_SINGLE_FIELD(result, id, jsonObj);
 
-	READ_NAMED_FROM_FIELDS_ARRAY(result, name, fieldsArray);
+	READ_NAMED_STRING_FROM_FIELDS_ARRAY(result, name, pool, fieldsArray);
 
-	READ_NAMED_FROM_FIELDS_ARRAY(result, description, fieldsArray);
+	READ_NAMED_STRING_FROM_FIELDS_ARRAY(result, description, pool, fieldsArray);
 
 	bool isBool = ReadFromFieldsArray(result.initialValueBool, fieldsArray, "Initial Value");
 	bool isNumber = ReadFromFieldsArray(result.initialValueNumber, fieldsArray, "Initial Value");
 	if (!(isBool || isNumber))
 	{
-		printf("Failed to read initial value for variable %s\n", result.name.CStr());
+		printf("Failed to read initial value for variable %s\n", result.name.CStr(pool));
+	}
+	else if (!isNumber)
+	{
+		// A JSON true/false; the number parse already turns "True"/"False" strings into 1/0
+		result.initialValueNumber = result.initialValueBool ? 1 : 0;
 	}
 
 	if (fieldsArray.Size() > 3)
 	{
-		printf("Character %s may have new and surprising fields.\n", result.name.CStr());
+		printf("Character %s may have new and surprising fields.\n", result.name.CStr(pool));
 	}
 
 	return result;
@@ -83,3 +83,5 @@ include "external/"
 include "generator/"
 
 include "visualizer/"
+
+include "benchmark/"
@@ -22,5 +22,18 @@ project "visualizer"
 	}
 	includedirs {
 		get_root_location() .. "external/rapidjson/include",
-		"src/"
+		"src/",
+		"../generator/src/",
+	}
+
+	-- The corpus loader is shared with the generator, everything but its entry point
+	files {
+		"../generator/src/**",
+	}
+	removefiles {
+		"../generator/src/main.cpp",
+	}
+
+	links {
+		"Ws2_32",
 	}
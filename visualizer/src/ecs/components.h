@@ -0,0 +1,91 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "layout/vec2.h"
+#include "memory/managed_string.h"
+
+#include <heart/types.h>
+
+#include <entt/entt.hpp>
+
+// Components are kept small and separate so each system only pulls the bytes it reads.
+// Strings stay as handles into the corpus' pool.
+
+struct ActorComponent
+{
+	uint32 id = 0;
+
+	// Dense index into the corpus' actors
+	uint32 actorIndex = 0;
+
+	ManagedString name;
+
+	uint8 isPlayer = 0;
+
+	uint8 color = 0;
+};
+
+struct ConversationComponent
+{
+	int32 id = 0;
+
+	// Dense index into the corpus' conversations
+	uint32 conversationIndex = 0;
+
+	ManagedString title;
+
+	// Its nodes are positions [firstNode, firstNode + nodeCount) of the node group
+	uint32 firstNode = 0;
+
+	uint32 nodeCount = 0;
+};
+
+struct DialogNode
+{
+	entt::entity conversation = entt::null;
+
+	// Null when the entry's actor isn't in the dump
+	entt::entity speaker = entt::null;
+
+	// Dense index into the corpus' dialog entries, which is also the node's group position
+	uint32 entryIndex = 0;
+
+	uint8 isRoot = 0;
+
+	uint8 isGroup = 0;
+};
+
+// World space, filled in from a layout once it's computed or loaded
+struct NodePosition
+{
+	Vec2 position;
+};
+
+// Kept apart from DialogNode so the per-frame loops don't drag string handles through cache
+struct NodeText
+{
+	ManagedString title;
+
+	ManagedString dialogText;
+};
+
+struct DialogLinkComponent
+{
+	// Node group positions, so drawing an edge indexes straight into the packed node arrays
+	uint32 from = 0;
+
+	uint32 to = 0;
+
+	uint8 priority = 0;
+
+	// DialogueEdge::Flags
+	uint8 flags = 0;
+};
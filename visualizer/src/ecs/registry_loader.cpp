@@ -0,0 +1,93 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "ecs/registry_loader.h"
+
+#include "corpus/corpus.h"
+
+#include <heart/debug/assert.h>
+
+#include <heart/stl/vector.h>
+
+#include <span>
+
+RegistryStats LoadRegistry(const Corpus& corpus, entt::registry& registry)
+{
+	RegistryStats stats;
+
+	// Asking for the group before anything is emplaced means each entity lands at the
+	// end of the packed range as it's filled in, so group order is creation order.
+	NodeGroup nodes = GetNodeGroup(registry);
+
+	hrt::vector<entt::entity> actorEntities;
+	actorEntities.reserve(corpus.actors.size());
+	for (uint32 i = 0; i < uint32(corpus.actors.size()); ++i)
+	{
+		const Actor& actor = corpus.actors[i];
+
+		entt::entity entity = registry.create();
+		registry.emplace<ActorComponent>(entity, ActorComponent {actor.id, i, actor.name, actor.isPlayer, actor.color});
+		actorEntities.push_back(entity);
+	}
+
+	hrt::vector<entt::entity> conversationEntities;
+	conversationEntities.reserve(corpus.conversations.size());
+	for (uint32 i = 0; i < uint32(corpus.conversations.size()); ++i)
+	{
+		const Conversation& conversation = corpus.conversations[i];
+
+		entt::entity entity = registry.create();
+		registry.emplace<ConversationComponent>(entity, ConversationComponent {conversation.id, i, conversation.title, conversation.firstDialogEntry, conversation.dialogEntryCount});
+		conversationEntities.push_back(entity);
+	}
+
+	std::span<const int32> entryConversations = corpus.entryTable.GetConversations();
+	for (uint32 i = 0; i < uint32(corpus.dialogEntries.size()); ++i)
+	{
+		const DialogEntry& entry = corpus.dialogEntries[i];
+
+		entt::entity speaker = entt::null;
+		uint32 actorIndex = corpus.ids.FindActor(entry.actor);
+		if (actorIndex != FlatIdMap<uint32>::NotFound)
+			speaker = actorEntities[actorIndex];
+		else
+			++stats.unknownSpeakerCount;
+
+		entt::entity entity = registry.create();
+		registry.emplace<DialogNode>(entity, DialogNode {conversationEntities[entryConversations[i]], speaker, i, entry.isRoot, entry.isGroup});
+		registry.emplace<NodePosition>(entity);
+		registry.emplace<NodeText>(entity, NodeText {entry.title, entry.dialogText});
+	}
+
+	// Links only reference node positions, which is only sound if nothing reordered the group
+	HEART_ASSERT(nodes.size() == corpus.dialogEntries.size());
+
+	for (uint32 i = 0; i < corpus.graph.GetEntryCount(); ++i)
+	{
+		for (const DialogueEdge& edge : corpus.graph.GetOutgoing(i))
+		{
+			entt::entity entity = registry.create();
+			registry.emplace<DialogLinkComponent>(entity, DialogLinkComponent {i, edge.entry, edge.priority, edge.flags});
+		}
+	}
+
+	stats.actorCount = uint32(actorEntities.size());
+	stats.conversationCount = uint32(conversationEntities.size());
+	stats.nodeCount = uint32(nodes.size());
+	stats.linkCount = uint32(GetLinkView(registry).size());
+	return stats;
+}
+
+void ApplyLayout(entt::registry& registry, const hrt::vector<Vec2>& positions)
+{
+	NodeGroup nodes = GetNodeGroup(registry);
+	HEART_ASSERT(nodes.size() == positions.size());
+
+	nodes.each([&positions](const DialogNode& node, NodePosition& position, const NodeText&) { position.position = positions[node.entryIndex]; });
+}
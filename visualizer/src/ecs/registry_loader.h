@@ -0,0 +1,59 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "ecs/components.h"
+#include "layout/vec2.h"
+
+#include <heart/types.h>
+
+#include <heart/stl/vector.h>
+
+#include <entt/entt.hpp>
+
+#include <utility>
+
+struct Corpus;
+
+// The owning group the loader sets up. Owned components are packed in group order, so
+// iterating a group walks contiguous arrays with no sparse lookups. Links are a single
+// component, so a plain view already walks their storage directly.
+using NodeGroup = decltype(std::declval<entt::registry&>().group<DialogNode, NodePosition, NodeText>());
+using LinkView = decltype(std::declval<entt::registry&>().view<DialogLinkComponent>());
+
+inline NodeGroup GetNodeGroup(entt::registry& registry)
+{
+	return registry.group<DialogNode, NodePosition, NodeText>();
+}
+
+inline LinkView GetLinkView(entt::registry& registry)
+{
+	return registry.view<DialogLinkComponent>();
+}
+
+struct RegistryStats
+{
+	uint32 actorCount = 0;
+	uint32 conversationCount = 0;
+	uint32 nodeCount = 0;
+	uint32 linkCount = 0;
+
+	// Entries whose actor id didn't match any actor
+	uint32 unknownSpeakerCount = 0;
+};
+
+// Fills an empty registry with one entity per actor, conversation, dialog entry and
+// dialogue graph edge. Nodes are created in dialog entry order, which keeps each
+// conversation's nodes contiguous in the node group and lets links refer to nodes by
+// group position.
+RegistryStats LoadRegistry(const Corpus& corpus, entt::registry& registry);
+
+// Copies one position per dialog entry onto the nodes
+void ApplyLayout(entt::registry& registry, const hrt::vector<Vec2>& positions);
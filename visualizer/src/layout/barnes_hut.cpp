@@ -0,0 +1,152 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "layout/barnes_hut.h"
+
+#include <algorithm>
+
+namespace
+{
+	// Keeps two points at nearly the same spot from producing a huge push
+	constexpr float MinDistanceSquared = 0.01f;
+
+	uint32 GetQuadrant(Vec2 center, Vec2 point)
+	{
+		return (point.x >= center.x ? 1u : 0u) | (point.y >= center.y ? 2u : 0u);
+	}
+}
+
+void BarnesHutTree::Subdivide(uint32 cell)
+{
+	uint32 firstChild = uint32(m_cells.size());
+	m_cells.resize(m_cells.size() + 4);
+
+	Cell& parent = m_cells[cell];
+	parent.firstChild = firstChild;
+
+	float childHalf = parent.halfSize * 0.5f;
+	for (uint32 quadrant = 0; quadrant < 4; ++quadrant)
+	{
+		Cell& child = m_cells[firstChild + quadrant];
+		child.center.x = parent.center.x + ((quadrant & 1) ? childHalf : -childHalf);
+		child.center.y = parent.center.y + ((quadrant & 2) ? childHalf : -childHalf);
+		child.halfSize = childHalf;
+	}
+}
+
+void BarnesHutTree::Insert(uint32 body)
+{
+	Vec2 point = m_positions[body];
+
+	uint32 cell = 0;
+	for (uint32 depth = 0;; ++depth)
+	{
+		{
+			Cell& current = m_cells[cell];
+			current.centerOfMass = (current.centerOfMass * current.mass + point) * (1.0f / (current.mass + 1.0f));
+			current.mass += 1.0f;
+
+			if (current.firstChild != 0)
+			{
+				cell = current.firstChild + GetQuadrant(current.center, point);
+				continue;
+			}
+
+			if (current.body == NoBody)
+			{
+				current.body = body;
+				return;
+			}
+
+			if (depth == MaxDepth)
+				return;
+		}
+
+		// An occupied leaf: split it and push its point down a level before carrying on
+		uint32 existing = m_cells[cell].body;
+		m_cells[cell].body = NoBody;
+		Subdivide(cell);
+
+		Vec2 existingPoint = m_positions[existing];
+		Cell& moved = m_cells[m_cells[cell].firstChild + GetQuadrant(m_cells[cell].center, existingPoint)];
+		moved.centerOfMass = existingPoint;
+		moved.mass = 1.0f;
+		moved.body = existing;
+
+		cell = m_cells[cell].firstChild + GetQuadrant(m_cells[cell].center, point);
+	}
+}
+
+void BarnesHutTree::Build(std::span<const Vec2> positions)
+{
+	m_positions = positions;
+	m_cells.clear();
+	if (positions.empty())
+		return;
+
+	Vec2 low = positions[0];
+	Vec2 high = positions[0];
+	for (Vec2 point : positions)
+	{
+		low.x = std::min(low.x, point.x);
+		low.y = std::min(low.y, point.y);
+		high.x = std::max(high.x, point.x);
+		high.y = std::max(high.y, point.y);
+	}
+
+	m_cells.reserve(positions.size() * 2);
+
+	Cell& root = m_cells.emplace_back();
+	root.center = (low + high) * 0.5f;
+	root.halfSize = std::max(std::max(high.x - low.x, high.y - low.y) * 0.5f, 1.0f) * 1.001f;
+
+	for (uint32 body = 0; body < uint32(positions.size()); ++body)
+	{
+		Insert(body);
+	}
+}
+
+Vec2 BarnesHutTree::ComputeRepulsion(uint32 body, float theta, float strength) const
+{
+	Vec2 force;
+	if (m_cells.empty())
+		return force;
+
+	Vec2 point = m_positions[body];
+	float thetaSquared = theta * theta;
+
+	// Each level pops one cell and pushes at most four
+	uint32 stack[MaxDepth * 3 + 4];
+	uint32 stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const Cell& cell = m_cells[stack[--stackSize]];
+		if (cell.mass == 0.0f || cell.body == body)
+			continue;
+
+		Vec2 delta = point - cell.centerOfMass;
+		float distanceSquared = std::max(delta.LengthSquared(), MinDistanceSquared);
+
+		float size = cell.halfSize * 2.0f;
+		if (cell.firstChild == 0 || size * size < thetaSquared * distanceSquared)
+		{
+			force += delta * (strength * cell.mass / distanceSquared);
+			continue;
+		}
+
+		for (uint32 quadrant = 0; quadrant < 4; ++quadrant)
+		{
+			stack[stackSize++] = cell.firstChild + quadrant;
+		}
+	}
+
+	return force;
+}
@@ -0,0 +1,65 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "layout/vec2.h"
+
+#include <heart/types.h>
+
+#include <heart/stl/vector.h>
+
+#include <span>
+
+// Quadtree over a set of points where every cell also knows the total mass and centre of
+// mass below it. Far-away cells stand in for all of their points, which turns the O(n^2)
+// all-pairs repulsion into roughly O(n log n).
+class BarnesHutTree
+{
+public:
+	static constexpr uint32 MaxDepth = 24;
+
+private:
+	static constexpr uint32 NoBody = UINT32_MAX;
+
+	struct Cell
+	{
+		Vec2 centerOfMass;
+		float mass = 0.0f;
+
+		Vec2 center;
+		float halfSize = 0.0f;
+
+		// Children are [firstChild, firstChild + 4), 0 for a leaf as the root is no one's child
+		uint32 firstChild = 0;
+
+		// The leaf's point. Points too close for MaxDepth to split share a leaf, only the
+		// first is kept here.
+		uint32 body = NoBody;
+	};
+
+	hrt::vector<Cell> m_cells;
+	std::span<const Vec2> m_positions;
+
+	void Insert(uint32 body);
+	void Subdivide(uint32 cell);
+
+public:
+	// Keeps a view of positions, which must stay alive and unchanged while forces are computed
+	void Build(std::span<const Vec2> positions);
+
+	// Sum of strength * delta / distance^2 pushing body away from every other point. Cells
+	// whose size over distance is below theta are treated as a single point.
+	Vec2 ComputeRepulsion(uint32 body, float theta, float strength) const;
+
+	uint32 GetCellCount() const
+	{
+		return uint32(m_cells.size());
+	}
+};
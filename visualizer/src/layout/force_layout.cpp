@@ -0,0 +1,330 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "layout/force_layout.h"
+
+#include "corpus/corpus.h"
+#include "layout/barnes_hut.h"
+#include "threading/thread_pool.h"
+
+#include <heart/debug/assert.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	constexpr uint32 Unvisited = UINT32_MAX;
+
+	// Nodes per job when one conversation's force pass is split over the pool
+	constexpr uint32 NodesPerJob = 256;
+
+	double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	bool IsLocalEdge(const DialogueEdge& edge, uint32 first, uint32 count)
+	{
+		return (edge.flags & DialogueEdge::CrossConversation) == 0 && edge.entry - first < count;
+	}
+
+	// Links in both directions as compressed rows over the conversation's local indices,
+	// so each node can sum its own springs without touching anyone else's force
+	void BuildNeighbours(const DialogueGraph& graph, uint32 first, uint32 count, hrt::vector<uint32>& offsets, hrt::vector<uint32>& neighbours)
+	{
+		offsets.assign(count + 1, 0);
+		for (uint32 i = 0; i < count; ++i)
+		{
+			for (const DialogueEdge& edge : graph.GetOutgoing(first + i))
+			{
+				uint32 local = edge.entry - first;
+				if (!IsLocalEdge(edge, first, count) || local == i)
+					continue;
+
+				++offsets[i + 1];
+				++offsets[local + 1];
+			}
+		}
+
+		for (uint32 i = 0; i < count; ++i)
+		{
+			offsets[i + 1] += offsets[i];
+		}
+
+		neighbours.resize(offsets[count]);
+		hrt::vector<uint32> cursor(offsets.begin(), offsets.end() - 1);
+		for (uint32 i = 0; i < count; ++i)
+		{
+			for (const DialogueEdge& edge : graph.GetOutgoing(first + i))
+			{
+				uint32 local = edge.entry - first;
+				if (!IsLocalEdge(edge, first, count) || local == i)
+					continue;
+
+				neighbours[cursor[i]++] = local;
+				neighbours[cursor[local]++] = i;
+			}
+		}
+	}
+
+	// Breadth-first layers along outgoing links from the roots, one row per layer. Whatever
+	// the roots can't reach goes in a roughly square block of rows underneath.
+	void SeedLayers(const Corpus& corpus, uint32 first, uint32 count, float spacing, std::span<Vec2> outPositions)
+	{
+		hrt::vector<uint32> layer(count, Unvisited);
+		hrt::vector<uint32> queue;
+		queue.reserve(count);
+
+		for (uint32 i = 0; i < count; ++i)
+		{
+			if (corpus.dialogEntries[first + i].isRoot)
+			{
+				layer[i] = 0;
+				queue.push_back(i);
+			}
+		}
+
+		if (queue.empty())
+		{
+			layer[0] = 0;
+			queue.push_back(0);
+		}
+
+		for (size_t head = 0; head < queue.size(); ++head)
+		{
+			uint32 current = queue[head];
+			for (const DialogueEdge& edge : corpus.graph.GetOutgoing(first + current))
+			{
+				uint32 local = edge.entry - first;
+				if (IsLocalEdge(edge, first, count) && layer[local] == Unvisited)
+				{
+					layer[local] = layer[current] + 1;
+					queue.push_back(local);
+				}
+			}
+		}
+
+		uint32 reachedLayers = layer[queue.back()] + 1;
+		uint32 unreachedCount = count - uint32(queue.size());
+		uint32 rowWidth = std::max(uint32(std::ceil(std::sqrt(float(unreachedCount)))), 1u);
+
+		uint32 unreachedSeen = 0;
+		for (uint32 i = 0; i < count; ++i)
+		{
+			if (layer[i] == Unvisited)
+				layer[i] = reachedLayers + unreachedSeen++ / rowWidth;
+		}
+
+		uint32 layerCount = reachedLayers + (unreachedCount + rowWidth - 1) / rowWidth;
+		hrt::vector<uint32> layerSizes(layerCount, 0);
+		for (uint32 i = 0; i < count; ++i)
+		{
+			++layerSizes[layer[i]];
+		}
+
+		hrt::vector<uint32> slots(layerCount, 0);
+		for (uint32 i = 0; i < count; ++i)
+		{
+			uint32 row = layer[i];
+			float column = float(slots[row]++) - float(layerSizes[row] - 1) * 0.5f;
+			outPositions[i] = Vec2 {column * spacing, float(row) * spacing * 1.5f};
+		}
+	}
+
+	void PackConversations(const Corpus& corpus, float margin, hrt::vector<Vec2>& positions)
+	{
+		struct Box
+		{
+			uint32 conversation = 0;
+			Vec2 low;
+			Vec2 high;
+		};
+
+		hrt::vector<Box> boxes;
+		float area = 0.0f;
+		float widest = 0.0f;
+		for (uint32 c = 0; c < uint32(corpus.conversations.size()); ++c)
+		{
+			const Conversation& conversation = corpus.conversations[c];
+			if (conversation.dialogEntryCount == 0)
+				continue;
+
+			Box& box = boxes.emplace_back();
+			box.conversation = c;
+			box.low = box.high = positions[conversation.firstDialogEntry];
+			for (uint32 i = conversation.firstDialogEntry; i < conversation.firstDialogEntry + conversation.dialogEntryCount; ++i)
+			{
+				box.low.x = std::min(box.low.x, positions[i].x);
+				box.low.y = std::min(box.low.y, positions[i].y);
+				box.high.x = std::max(box.high.x, positions[i].x);
+				box.high.y = std::max(box.high.y, positions[i].y);
+			}
+
+			area += (box.high.x - box.low.x + margin) * (box.high.y - box.low.y + margin);
+			widest = std::max(widest, box.high.x - box.low.x + margin);
+		}
+
+		// Shelves, tallest first, in rows about as wide as the whole thing is tall
+		std::sort(boxes.begin(), boxes.end(), [](const Box& a, const Box& b) { return a.high.y - a.low.y > b.high.y - b.low.y; });
+		float rowLimit = std::max(std::sqrt(area), widest);
+
+		Vec2 cursor;
+		float rowHeight = 0.0f;
+		for (const Box& box : boxes)
+		{
+			float width = box.high.x - box.low.x + margin;
+			if (cursor.x > 0.0f && cursor.x + width > rowLimit)
+			{
+				cursor = Vec2 {0.0f, cursor.y + rowHeight};
+				rowHeight = 0.0f;
+			}
+
+			const Conversation& conversation = corpus.conversations[box.conversation];
+			Vec2 offset = cursor - box.low;
+			for (uint32 i = conversation.firstDialogEntry; i < conversation.firstDialogEntry + conversation.dialogEntryCount; ++i)
+			{
+				positions[i] += offset;
+			}
+
+			cursor.x += width;
+			rowHeight = std::max(rowHeight, box.high.y - box.low.y + margin);
+		}
+	}
+}
+
+void LayoutConversation(const Corpus& corpus, uint32 conversation, const LayoutSettings& settings, ThreadPool* threads, std::span<Vec2> outPositions, LayoutTimings* outTimings)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	const Conversation& info = corpus.conversations[conversation];
+	uint32 first = info.firstDialogEntry;
+	uint32 count = info.dialogEntryCount;
+	HEART_ASSERT(outPositions.size() == count);
+
+	LayoutTimings timings;
+	timings.nodeCount = count;
+	if (count == 0)
+	{
+		if (outTimings)
+			*outTimings = timings;
+		return;
+	}
+
+	hrt::vector<uint32> offsets;
+	hrt::vector<uint32> neighbours;
+	BuildNeighbours(corpus.graph, first, count, offsets, neighbours);
+	timings.edgeCount = uint32(neighbours.size() / 2);
+
+	SeedLayers(corpus, first, count, settings.springLength, outPositions);
+	timings.seedMs = MillisecondsSince(start);
+
+	hrt::vector<Vec2> displacement(count);
+	BarnesHutTree tree;
+
+	float repulsion = settings.springLength * settings.springLength;
+	float inverseLength = 1.0f / settings.springLength;
+	bool parallel = threads && count >= settings.parallelThreshold;
+
+	auto computeForces = [&](uint32 begin, uint32 end) {
+		for (uint32 i = begin; i < end; ++i)
+		{
+			Vec2 point = outPositions[i];
+			Vec2 force = tree.ComputeRepulsion(i, settings.theta, repulsion);
+
+			for (uint32 n = offsets[i]; n < offsets[i + 1]; ++n)
+			{
+				Vec2 delta = outPositions[neighbours[n]] - point;
+				force += delta * (std::sqrt(delta.LengthSquared()) * inverseLength);
+			}
+
+			force -= point * settings.gravity;
+			displacement[i] = force;
+		}
+	};
+
+	float step = settings.initialStep;
+	for (uint32 iteration = 0; iteration < settings.iterations; ++iteration)
+	{
+		auto treeStart = std::chrono::steady_clock::now();
+		tree.Build(outPositions);
+		timings.treeMs += MillisecondsSince(treeStart);
+
+		auto forceStart = std::chrono::steady_clock::now();
+		if (parallel)
+		{
+			uint32 jobCount = (count + NodesPerJob - 1) / NodesPerJob;
+			threads->ParallelFor(jobCount, [&](uint32 job) { computeForces(job * NodesPerJob, std::min(job * NodesPerJob + NodesPerJob, count)); });
+		}
+		else
+		{
+			computeForces(0, count);
+		}
+		timings.forceMs += MillisecondsSince(forceStart);
+
+		// Nobody moves further than the current step, which shrinks as the layout settles
+		for (uint32 i = 0; i < count; ++i)
+		{
+			float length = std::sqrt(displacement[i].LengthSquared());
+			if (length > step)
+				displacement[i] = displacement[i] * (step / length);
+
+			outPositions[i] += displacement[i];
+		}
+
+		step *= settings.cooling;
+	}
+
+	timings.totalMs = MillisecondsSince(start);
+	if (outTimings)
+		*outTimings = timings;
+}
+
+void LayoutCorpus(const Corpus& corpus, const LayoutSettings& settings, ThreadPool& threads, hrt::vector<Vec2>& outPositions, LayoutReport& outReport)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	outPositions.assign(corpus.dialogEntries.size(), Vec2 {});
+	outReport = LayoutReport {};
+
+	auto getRange = [&](uint32 c) {
+		const Conversation& conversation = corpus.conversations[c];
+		return std::span<Vec2>(outPositions.data() + conversation.firstDialogEntry, conversation.dialogEntryCount);
+	};
+
+	for (uint32 c = 0; c < uint32(corpus.conversations.size()); ++c)
+	{
+		if (corpus.conversations[c].dialogEntryCount > corpus.conversations[outReport.largestConversation].dialogEntryCount)
+			outReport.largestConversation = c;
+	}
+
+	// Big conversations one at a time with every thread on them, then the rest one per job.
+	// The largest always goes first so its timings are taken with the whole pool.
+	hrt::vector<uint32> small;
+	for (uint32 c = 0; c < uint32(corpus.conversations.size()); ++c)
+	{
+		if (c == outReport.largestConversation)
+			LayoutConversation(corpus, c, settings, &threads, getRange(c), &outReport.largest);
+		else if (corpus.conversations[c].dialogEntryCount < settings.parallelThreshold)
+			small.push_back(c);
+	}
+
+	for (uint32 c = 0; c < uint32(corpus.conversations.size()); ++c)
+	{
+		if (c != outReport.largestConversation && corpus.conversations[c].dialogEntryCount >= settings.parallelThreshold)
+			LayoutConversation(corpus, c, settings, &threads, getRange(c), nullptr);
+	}
+
+	threads.ParallelFor(uint32(small.size()), [&](uint32 i) { LayoutConversation(corpus, small[i], settings, nullptr, getRange(small[i]), nullptr); });
+
+	PackConversations(corpus, settings.conversationMargin, outPositions);
+
+	outReport.totalMs = MillisecondsSince(start);
+}
@@ -0,0 +1,74 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "layout/vec2.h"
+
+#include <heart/types.h>
+
+#include <heart/stl/vector.h>
+
+#include <span>
+
+class ThreadPool;
+struct Corpus;
+
+// Fruchterman-Reingold style: springs of natural length springLength along links, every
+// pair of nodes pushing apart (approximated through a Barnes-Hut tree), and a step size
+// that cools each iteration.
+struct LayoutSettings
+{
+	uint32 iterations = 300;
+
+	float springLength = 60.0f;
+
+	// Barnes-Hut opening angle, higher is faster and rougher
+	float theta = 0.9f;
+
+	// Pull towards the conversation's origin, keeps disconnected pieces from drifting off
+	float gravity = 0.02f;
+
+	float initialStep = 40.0f;
+	float cooling = 0.985f;
+
+	// Conversations with at least this many nodes spread each iteration over the thread
+	// pool; smaller ones are laid out one per job instead.
+	uint32 parallelThreshold = 1024;
+
+	// Space left between conversations once they're packed together
+	float conversationMargin = 200.0f;
+};
+
+struct LayoutTimings
+{
+	uint32 nodeCount = 0;
+	uint32 edgeCount = 0;
+
+	double seedMs = 0.0;
+	double treeMs = 0.0;
+	double forceMs = 0.0;
+	double totalMs = 0.0;
+};
+
+struct LayoutReport
+{
+	double totalMs = 0.0;
+
+	uint32 largestConversation = 0;
+	LayoutTimings largest;
+};
+
+// Lays out one conversation in its own coordinates, writing one position per entry of
+// its range. Seeds the nodes in layers by distance from the roots, then relaxes them.
+// threads may be null to run on the calling thread.
+void LayoutConversation(const Corpus& corpus, uint32 conversation, const LayoutSettings& settings, ThreadPool* threads, std::span<Vec2> outPositions, LayoutTimings* outTimings);
+
+// Lays out every conversation and packs them side by side, one position per dialog entry
+void LayoutCorpus(const Corpus& corpus, const LayoutSettings& settings, ThreadPool& threads, hrt::vector<Vec2>& outPositions, LayoutReport& outReport);
@@ -0,0 +1,96 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "layout/layout_file.h"
+
+#include "corpus/corpus.h"
+
+#include <fstream>
+
+namespace
+{
+	constexpr uint32 LayoutMagic = 0x594C4344; // "DCLY"
+	constexpr uint32 LayoutVersion = 1;
+
+	struct LayoutFileHeader
+	{
+		uint32 magic = LayoutMagic;
+		uint32 version = LayoutVersion;
+
+		uint32 entryCount = 0;
+		uint32 edgeCount = 0;
+
+		uint64 fingerprint = 0;
+	};
+
+	// FNV-1a over the entries' articy ids and conversation sizes
+	uint64 ComputeFingerprint(const Corpus& corpus)
+	{
+		uint64 hash = 14695981039346656037ull;
+		auto mix = [&hash](uint64 value) {
+			hash ^= value;
+			hash *= 1099511628211ull;
+		};
+
+		for (const DialogEntry& entry : corpus.dialogEntries)
+		{
+			mix(entry.articyId);
+		}
+
+		for (const Conversation& conversation : corpus.conversations)
+		{
+			mix(conversation.dialogEntryCount);
+		}
+
+		return hash;
+	}
+
+	LayoutFileHeader MakeHeader(const Corpus& corpus)
+	{
+		LayoutFileHeader header;
+		header.entryCount = uint32(corpus.dialogEntries.size());
+		header.edgeCount = corpus.graph.GetEdgeCount();
+		header.fingerprint = ComputeFingerprint(corpus);
+		return header;
+	}
+}
+
+bool WriteLayoutFile(const char* path, const Corpus& corpus, const hrt::vector<Vec2>& positions)
+{
+	if (positions.size() != corpus.dialogEntries.size())
+		return false;
+
+	std::ofstream output(path, std::ios::binary);
+	if (!output)
+		return false;
+
+	LayoutFileHeader header = MakeHeader(corpus);
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	output.write(reinterpret_cast<const char*>(positions.data()), std::streamsize(positions.size() * sizeof(Vec2)));
+
+	return bool(output);
+}
+
+bool ReadLayoutFile(const char* path, const Corpus& corpus, hrt::vector<Vec2>& outPositions)
+{
+	std::ifstream input(path, std::ios::binary);
+	if (!input)
+		return false;
+
+	LayoutFileHeader header;
+	if (!input.read(reinterpret_cast<char*>(&header), sizeof(header)))
+		return false;
+
+	LayoutFileHeader expected = MakeHeader(corpus);
+	if (header.magic != expected.magic || header.version != expected.version || header.entryCount != expected.entryCount || header.edgeCount != expected.edgeCount || header.fingerprint != expected.fingerprint)
+		return false;
+
+	outPositions.resize(header.entryCount);
+	return bool(input.read(reinterpret_cast<char*>(outPositions.data()), std::streamsize(outPositions.size() * sizeof(Vec2))));
+}
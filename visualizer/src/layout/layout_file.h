@@ -0,0 +1,25 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "layout/vec2.h"
+
+#include <heart/types.h>
+
+#include <heart/stl/vector.h>
+
+struct Corpus;
+
+// Positions are saved as a small header followed by one Vec2 per dialog entry. The header
+// carries a fingerprint of the corpus' entries and links, so a file written for another
+// dump (or an older export of this one) is refused rather than loaded onto the wrong nodes.
+bool WriteLayoutFile(const char* path, const Corpus& corpus, const hrt::vector<Vec2>& positions);
+
+bool ReadLayoutFile(const char* path, const Corpus& corpus, hrt::vector<Vec2>& outPositions);
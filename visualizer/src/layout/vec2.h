@@ -0,0 +1,90 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+struct Vec2
+{
+	float x = 0.0f;
+	float y = 0.0f;
+
+	Vec2 operator+(Vec2 other) const
+	{
+		return Vec2 {x + other.x, y + other.y};
+	}
+
+	Vec2 operator-(Vec2 other) const
+	{
+		return Vec2 {x - other.x, y - other.y};
+	}
+
+	Vec2 operator*(float scale) const
+	{
+		return Vec2 {x * scale, y * scale};
+	}
+
+	Vec2& operator+=(Vec2 other)
+	{
+		x += other.x;
+		y += other.y;
+		return *this;
+	}
+
+	Vec2& operator-=(Vec2 other)
+	{
+		x -= other.x;
+		y -= other.y;
+		return *this;
+	}
+
+	float LengthSquared() const
+	{
+		return x * x + y * y;
+	}
+};
+
+// Axis-aligned box, low and high inclusive
+struct Rect
+{
+	Vec2 low;
+	Vec2 high;
+
+	static Rect FromPoint(Vec2 point)
+	{
+		return Rect {point, point};
+	}
+
+	void Extend(Vec2 point)
+	{
+		low.x = point.x < low.x ? point.x : low.x;
+		low.y = point.y < low.y ? point.y : low.y;
+		high.x = point.x > high.x ? point.x : high.x;
+		high.y = point.y > high.y ? point.y : high.y;
+	}
+
+	bool Contains(Vec2 point) const
+	{
+		return point.x >= low.x && point.x <= high.x && point.y >= low.y && point.y <= high.y;
+	}
+
+	bool Overlaps(const Rect& other) const
+	{
+		return low.x <= other.high.x && high.x >= other.low.x && low.y <= other.high.y && high.y >= other.low.y;
+	}
+
+	Vec2 GetCenter() const
+	{
+		return (low + high) * 0.5f;
+	}
+
+	Vec2 GetSize() const
+	{
+		return high - low;
+	}
+};
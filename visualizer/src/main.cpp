@@ -7,7 +7,279 @@
  *
  */
 
-int main()
+#include "corpus/corpus.h"
+#include "ecs/registry_loader.h"
+#include "layout/force_layout.h"
+#include "layout/layout_file.h"
+#include "render/scene_index.h"
+#include "render/svg_renderer.h"
+#include "threading/thread_pool.h"
+
+#include <heart/types.h>
+
+#include <entt/entt.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
 {
+	struct CommandLine
+	{
+		const char* dumpPath = "C:\\Users\\James\\Desktop\\DiscoDump\\Disco Elysium.json";
+
+		uint32 frameCount = 120;
+
+		// Positions are read from here if it matches the dump, else computed and saved here
+		const char* layoutPath = nullptr;
+		bool forceLayout = false;
+
+		LayoutSettings layout;
+
+		uint32 threadCount = 0;
+
+		// Where to write the first benchmarked frame, if anywhere
+		const char* renderPath = nullptr;
+
+		// Benchmarks this view instead of the overview and largest conversation
+		bool hasView = false;
+		Viewport view;
+
+		bool hasPick = false;
+		Vec2 pick;
+
+		bool Parse(int argc, char* argv[])
+		{
+			for (int i = 1; i < argc; ++i)
+			{
+				const char* arg = argv[i];
+				bool hasNext = i + 1 < argc;
+
+				if (strcmp(arg, "--dump") == 0 && hasNext)
+				{
+					dumpPath = argv[++i];
+				}
+				else if (strcmp(arg, "--frames") == 0 && hasNext)
+				{
+					frameCount = uint32(strtoul(argv[++i], nullptr, 10));
+				}
+				else if (strcmp(arg, "--layout") == 0 && hasNext)
+				{
+					layoutPath = argv[++i];
+				}
+				else if (strcmp(arg, "--relayout") == 0)
+				{
+					forceLayout = true;
+				}
+				else if (strcmp(arg, "--iterations") == 0 && hasNext)
+				{
+					layout.iterations = uint32(strtoul(argv[++i], nullptr, 10));
+				}
+				else if (strcmp(arg, "--render") == 0 && hasNext)
+				{
+					renderPath = argv[++i];
+				}
+				else if (strcmp(arg, "--view") == 0 && i + 3 < argc)
+				{
+					hasView = true;
+					view.center.x = strtof(argv[++i], nullptr);
+					view.center.y = strtof(argv[++i], nullptr);
+					view.scale = strtof(argv[++i], nullptr);
+				}
+				else if (strcmp(arg, "--size") == 0 && i + 2 < argc)
+				{
+					view.width = uint32(strtoul(argv[++i], nullptr, 10));
+					view.height = uint32(strtoul(argv[++i], nullptr, 10));
+				}
+				else if (strcmp(arg, "--pick") == 0 && i + 2 < argc)
+				{
+					hasPick = true;
+					pick.x = strtof(argv[++i], nullptr);
+					pick.y = strtof(argv[++i], nullptr);
+				}
+				else if (strcmp(arg, "--threads") == 0 && hasNext)
+				{
+					threadCount = uint32(strtoul(argv[++i], nullptr, 10));
+				}
+				else
+				{
+					std::cout << "Unknown or incomplete argument " << arg << std::endl;
+					std::cout << "Usage: visualizer [--dump <path>] [--layout <positions file> [--relayout]] [--iterations <count>] [--threads <count>]" << std::endl;
+					std::cout << "       [--frames <count>] [--render <out.svg>] [--view <x> <y> <pixels per unit>] [--size <width> <height>] [--pick <x> <y>]" << std::endl;
+					return false;
+				}
+			}
+
+			return true;
+		}
+	};
+
+	struct BenchmarkView
+	{
+		const char* name = nullptr;
+		Viewport viewport;
+	};
+
+	// Renders the view frameCount times into memory and reports the average cost per frame
+	bool BenchmarkRender(const SceneIndex& scene, const Corpus& corpus, const CommandLine& commandLine, const BenchmarkView& view, bool writeFile)
+	{
+		SvgRenderer renderer;
+		RenderSettings settings;
+		settings.nodeSpacing = commandLine.layout.springLength;
+
+		RenderStats total;
+		RenderStats last;
+		for (uint32 i = 0; i < commandLine.frameCount; ++i)
+		{
+			last = renderer.Render(scene, corpus.pool, view.viewport, settings);
+			total.cullUs += last.cullUs;
+			total.emitUs += last.emitUs;
+		}
+
+		double frames = double(commandLine.frameCount);
+		std::cout << view.name << " (" << view.viewport.scale << " px/unit" << (last.clustered ? ", clustered" : "") << "): " << last.nodesDrawn << " nodes, " << last.edgesDrawn << " links, " << last.clustersDrawn << " clusters, ";
+		std::cout << total.cullUs / frames << "us culling + " << total.emitUs / frames << "us drawing per frame, " << renderer.GetSvg().size() / 1024 << "KB of SVG." << std::endl;
+
+		if (!writeFile)
+			return true;
+
+		std::ofstream output(commandLine.renderPath, std::ios::binary);
+		output.write(renderer.GetSvg().data(), std::streamsize(renderer.GetSvg().size()));
+		if (!output)
+		{
+			std::cout << "Failed to write " << commandLine.renderPath << std::endl;
+			return false;
+		}
+
+		std::cout << "Wrote " << commandLine.renderPath << "." << std::endl;
+		return true;
+	}
+
+	bool GetLayout(const Corpus& corpus, const CommandLine& commandLine, ThreadPool& threads, hrt::vector<Vec2>& outPositions)
+	{
+		if (commandLine.layoutPath && !commandLine.forceLayout && ReadLayoutFile(commandLine.layoutPath, corpus, outPositions))
+		{
+			std::cout << "Loaded layout from " << commandLine.layoutPath << "." << std::endl;
+			return true;
+		}
+
+		std::cout << "Computing layout on " << threads.GetThreadCount() << " threads... ";
+		std::cout.flush();
+
+		LayoutReport report;
+		LayoutCorpus(corpus, commandLine.layout, threads, outPositions, report);
+		std::cout << "Done in " << report.totalMs << "ms." << std::endl;
+
+		if (!corpus.conversations.empty())
+		{
+			const LayoutTimings& largest = report.largest;
+			std::cout << "Largest conversation \"" << corpus.conversations[report.largestConversation].title.CStr(corpus.pool) << "\" (" << largest.nodeCount << " nodes, " << largest.edgeCount << " links): ";
+			std::cout << largest.totalMs << "ms for " << commandLine.layout.iterations << " iterations, seeding " << largest.seedMs << "ms, tree builds " << largest.treeMs << "ms, forces " << largest.forceMs << "ms." << std::endl;
+		}
+
+		if (commandLine.layoutPath)
+		{
+			if (!WriteLayoutFile(commandLine.layoutPath, corpus, outPositions))
+			{
+				std::cout << "Failed to write " << commandLine.layoutPath << std::endl;
+				return false;
+			}
+
+			std::cout << "Wrote layout to " << commandLine.layoutPath << "." << std::endl;
+		}
+
+		return true;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	CommandLine commandLine;
+	if (!commandLine.Parse(argc, argv))
+		return 1;
+
+	ThreadPool threads(commandLine.threadCount);
+
+	Corpus corpus;
+	if (!LoadCorpus(commandLine.dumpPath, corpus, &std::cout, nullptr, &threads))
+		return 1;
+
+	std::cout << "Filling registry... ";
+	std::cout.flush();
+
+	entt::registry registry;
+
+	auto start = std::chrono::steady_clock::now();
+	RegistryStats stats = LoadRegistry(corpus, registry);
+	auto end = std::chrono::steady_clock::now();
+
+	double loadMs = std::chrono::duration<double, std::milli>(end - start).count();
+	std::cout << "Done! " << stats.actorCount << " actors, " << stats.conversationCount << " conversations, " << stats.nodeCount << " nodes and " << stats.linkCount << " links in " << loadMs << "ms";
+	std::cout << " (" << stats.unknownSpeakerCount << " nodes without a known speaker)." << std::endl;
+
+	hrt::vector<Vec2> positions;
+	if (!GetLayout(corpus, commandLine, threads, positions))
+		return 1;
+
+	ApplyLayout(registry, positions);
+
+	if (commandLine.frameCount == 0)
+		return 0;
+
+	std::cout << "Building scene index... ";
+	std::cout.flush();
+
+	SceneIndex scene;
+	start = std::chrono::steady_clock::now();
+	scene.Build(registry);
+	end = std::chrono::steady_clock::now();
+
+	double indexMs = std::chrono::duration<double, std::milli>(end - start).count();
+	std::cout << "Done in " << indexMs << "ms, " << scene.GetMemoryUsage() / 1024 << "KB." << std::endl;
+
+	// The requested view, or everything at once plus a close up of the largest conversation
+	hrt::vector<BenchmarkView> views;
+	if (commandLine.hasView)
+	{
+		views.push_back(BenchmarkView {"View", commandLine.view});
+	}
+	else
+	{
+		views.push_back(BenchmarkView {"Overview", Viewport::Fit(scene.GetBounds(), commandLine.view.width, commandLine.view.height)});
+
+		uint32 largest = SceneIndex::NoHit;
+		for (uint32 i = 0; i < scene.GetClusterCount(); ++i)
+		{
+			if (largest == SceneIndex::NoHit || scene.GetCluster(i).nodeCount > scene.GetCluster(largest).nodeCount)
+				largest = i;
+		}
+
+		if (largest != SceneIndex::NoHit)
+		{
+			Viewport detail = commandLine.view;
+			detail.center = scene.GetCluster(largest).centroid;
+			views.push_back(BenchmarkView {"Largest conversation", detail});
+		}
+	}
+
+	for (uint32 i = 0; i < uint32(views.size()); ++i)
+	{
+		if (!BenchmarkRender(scene, corpus, commandLine, views[i], i == 0 && commandLine.renderPath))
+			return 1;
+	}
+
+	if (commandLine.hasPick)
+	{
+		const Viewport& viewport = views[0].viewport;
+		uint32 hit = scene.HitTest(viewport.ToWorld(commandLine.pick), RenderSettings().nodeRadius / viewport.scale);
+		if (hit == SceneIndex::NoHit)
+			std::cout << "Nothing at " << commandLine.pick.x << ", " << commandLine.pick.y << "." << std::endl;
+		else
+			std::cout << "Picked " << corpus.dialogEntries[hit].title.CStr(corpus.pool) << ": " << corpus.dialogEntries[hit].dialogText.CStr(corpus.pool) << std::endl;
+	}
+
 	return 0;
 }
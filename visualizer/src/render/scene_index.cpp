@@ -0,0 +1,109 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "render/scene_index.h"
+
+#include "ecs/registry_loader.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Aim for a handful of items per cell
+	float ChooseCellSize(const Rect& bounds, uint32 itemCount)
+	{
+		Vec2 size = bounds.GetSize();
+		return std::sqrt(std::max(size.x * size.y, 1.0f) / float(std::max(itemCount, 1u))) * 2.0f;
+	}
+}
+
+void SceneIndex::Build(entt::registry& registry)
+{
+	NodeGroup nodes = GetNodeGroup(registry);
+
+	m_positions.assign(nodes.size(), Vec2 {});
+	m_isRoot.assign(nodes.size(), 0);
+	nodes.each([this](const DialogNode& node, const NodePosition& position, const NodeText&) {
+		m_positions[node.entryIndex] = position.position;
+		m_isRoot[node.entryIndex] = node.isRoot;
+	});
+
+	m_bounds = m_positions.empty() ? Rect {} : Rect::FromPoint(m_positions[0]);
+	for (Vec2 position : m_positions)
+	{
+		m_bounds.Extend(position);
+	}
+
+	m_edges.clear();
+	LinkView links = GetLinkView(registry);
+	m_edges.reserve(links.size());
+	links.each([this](const DialogLinkComponent& link) { m_edges.push_back(Segment {m_positions[link.from], m_positions[link.to]}); });
+
+	m_clusters.clear();
+	registry.view<ConversationComponent>().each([this](const ConversationComponent& conversation) {
+		if (m_clusters.size() <= conversation.conversationIndex)
+			m_clusters.resize(conversation.conversationIndex + 1);
+
+		SceneCluster& cluster = m_clusters[conversation.conversationIndex];
+		cluster.nodeCount = conversation.nodeCount;
+		cluster.title = conversation.title;
+		if (conversation.nodeCount == 0)
+			return;
+
+		Vec2 sum;
+		cluster.bounds = Rect::FromPoint(m_positions[conversation.firstNode]);
+		for (uint32 i = conversation.firstNode; i < conversation.firstNode + conversation.nodeCount; ++i)
+		{
+			cluster.bounds.Extend(m_positions[i]);
+			sum += m_positions[i];
+		}
+
+		cluster.centroid = sum * (1.0f / float(conversation.nodeCount));
+	});
+
+	hrt::vector<Rect> clusterBounds;
+	clusterBounds.reserve(m_clusters.size());
+	for (const SceneCluster& cluster : m_clusters)
+	{
+		// Empty conversations get a box nobody will look at rather than a hole in the numbering
+		clusterBounds.push_back(cluster.nodeCount != 0 ? cluster.bounds : Rect::FromPoint(m_bounds.low - Vec2 {1.0f, 1.0f}));
+	}
+
+	float nodeCellSize = ChooseCellSize(m_bounds, GetNodeCount());
+	m_nodeGrid.BuildPoints(m_bounds, nodeCellSize, m_positions);
+	m_edgeGrid.BuildSegments(m_bounds, nodeCellSize, m_edges);
+	m_clusterGrid.BuildBoxes(m_bounds, ChooseCellSize(m_bounds, uint32(m_clusters.size())), clusterBounds);
+}
+
+uint32 SceneIndex::HitTest(Vec2 point, float radius) const
+{
+	hrt::vector<uint32> candidates;
+	m_nodeGrid.Query(Rect {point - Vec2 {radius, radius}, point + Vec2 {radius, radius}}, candidates);
+
+	uint32 best = NoHit;
+	float bestDistanceSquared = radius * radius;
+	for (uint32 node : candidates)
+	{
+		float distanceSquared = (m_positions[node] - point).LengthSquared();
+		if (distanceSquared <= bestDistanceSquared)
+		{
+			best = node;
+			bestDistanceSquared = distanceSquared;
+		}
+	}
+
+	return best;
+}
+
+size_t SceneIndex::GetMemoryUsage() const
+{
+	size_t bytes = m_positions.capacity() * sizeof(Vec2) + m_isRoot.capacity() + m_edges.capacity() * sizeof(Segment) + m_clusters.capacity() * sizeof(SceneCluster);
+	return bytes + m_nodeGrid.GetMemoryUsage() + m_edgeGrid.GetMemoryUsage() + m_clusterGrid.GetMemoryUsage();
+}
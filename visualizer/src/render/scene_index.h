@@ -0,0 +1,114 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "layout/vec2.h"
+#include "memory/managed_string.h"
+#include "render/spatial_grid.h"
+
+#include <heart/types.h>
+
+#include <heart/stl/vector.h>
+
+#include <entt/entt.hpp>
+
+// A conversation drawn as one glyph when zoomed out
+struct SceneCluster
+{
+	Rect bounds;
+	Vec2 centroid;
+	uint32 nodeCount = 0;
+	ManagedString title;
+};
+
+// Flat copies of the laid-out registry plus grids over nodes, links and conversations, so
+// culling and picking only look at what's near the area asked about. Nodes are dialog
+// entry indices, edges link storage positions and clusters conversation indices.
+class SceneIndex
+{
+public:
+	static constexpr uint32 NoHit = UINT32_MAX;
+
+private:
+	hrt::vector<Vec2> m_positions;
+	hrt::vector<uint8> m_isRoot;
+	hrt::vector<Segment> m_edges;
+	hrt::vector<SceneCluster> m_clusters;
+
+	SpatialGrid m_nodeGrid;
+	SpatialGrid m_edgeGrid;
+	SpatialGrid m_clusterGrid;
+
+	Rect m_bounds;
+
+public:
+	// Reads a registry that LoadRegistry and ApplyLayout have filled in
+	void Build(entt::registry& registry);
+
+	void QueryNodes(const Rect& area, hrt::vector<uint32>& out) const
+	{
+		m_nodeGrid.Query(area, out);
+	}
+
+	void QueryEdges(const Rect& area, hrt::vector<uint32>& out) const
+	{
+		m_edgeGrid.Query(area, out);
+	}
+
+	void QueryClusters(const Rect& area, hrt::vector<uint32>& out) const
+	{
+		m_clusterGrid.Query(area, out);
+	}
+
+	// The closest node within radius of point, or NoHit
+	uint32 HitTest(Vec2 point, float radius) const;
+
+	Vec2 GetPosition(uint32 node) const
+	{
+		return m_positions[node];
+	}
+
+	bool IsRoot(uint32 node) const
+	{
+		return m_isRoot[node] != 0;
+	}
+
+	const Segment& GetEdge(uint32 edge) const
+	{
+		return m_edges[edge];
+	}
+
+	const SceneCluster& GetCluster(uint32 cluster) const
+	{
+		return m_clusters[cluster];
+	}
+
+	const Rect& GetBounds() const
+	{
+		return m_bounds;
+	}
+
+	uint32 GetNodeCount() const
+	{
+		return uint32(m_positions.size());
+	}
+
+	uint32 GetEdgeCount() const
+	{
+		return uint32(m_edges.size());
+	}
+
+	uint32 GetClusterCount() const
+	{
+		return uint32(m_clusters.size());
+	}
+
+	size_t GetMemoryUsage() const;
+};
@@ -0,0 +1,169 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "render/spatial_grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+void SpatialGrid::Initialize(const Rect& bounds, float cellSize)
+{
+	m_bounds = bounds;
+	m_itemsSpanCells = false;
+
+	Vec2 size = bounds.GetSize();
+	cellSize = std::max(cellSize, 1.0f);
+	while ((std::floor(size.x / cellSize) + 1.0f) * (std::floor(size.y / cellSize) + 1.0f) > float(MaxCells))
+	{
+		cellSize *= 2.0f;
+	}
+
+	m_inverseCellSize = 1.0f / cellSize;
+	m_columns = uint32(size.x * m_inverseCellSize) + 1;
+	m_rows = uint32(size.y * m_inverseCellSize) + 1;
+}
+
+void SpatialGrid::Finish(uint32 itemCount, const hrt::vector<CellItem>& cellItems)
+{
+	m_itemsSpanCells = cellItems.size() > itemCount;
+
+	// Counting sort by cell
+	m_offsets.assign(GetCellCount() + 1, 0);
+	for (const CellItem& cellItem : cellItems)
+	{
+		++m_offsets[cellItem.cell + 1];
+	}
+
+	for (uint32 cell = 0; cell < GetCellCount(); ++cell)
+	{
+		m_offsets[cell + 1] += m_offsets[cell];
+	}
+
+	m_items.resize(cellItems.size());
+	hrt::vector<uint32> cursor(m_offsets.begin(), m_offsets.end() - 1);
+	for (const CellItem& cellItem : cellItems)
+	{
+		m_items[cursor[cellItem.cell]++] = cellItem.item;
+	}
+}
+
+uint32 SpatialGrid::GetColumn(float x) const
+{
+	float column = (x - m_bounds.low.x) * m_inverseCellSize;
+	return column <= 0.0f ? 0 : std::min(uint32(column), m_columns - 1);
+}
+
+uint32 SpatialGrid::GetRow(float y) const
+{
+	float row = (y - m_bounds.low.y) * m_inverseCellSize;
+	return row <= 0.0f ? 0 : std::min(uint32(row), m_rows - 1);
+}
+
+void SpatialGrid::BuildPoints(const Rect& bounds, float cellSize, std::span<const Vec2> points)
+{
+	Initialize(bounds, cellSize);
+
+	hrt::vector<CellItem> cellItems;
+	cellItems.reserve(points.size());
+	for (uint32 i = 0; i < uint32(points.size()); ++i)
+	{
+		cellItems.push_back(CellItem {GetRow(points[i].y) * m_columns + GetColumn(points[i].x), i});
+	}
+
+	Finish(uint32(points.size()), cellItems);
+}
+
+void SpatialGrid::BuildBoxes(const Rect& bounds, float cellSize, std::span<const Rect> boxes)
+{
+	Initialize(bounds, cellSize);
+
+	hrt::vector<CellItem> cellItems;
+	cellItems.reserve(boxes.size());
+	for (uint32 i = 0; i < uint32(boxes.size()); ++i)
+	{
+		for (uint32 row = GetRow(boxes[i].low.y); row <= GetRow(boxes[i].high.y); ++row)
+		{
+			for (uint32 column = GetColumn(boxes[i].low.x); column <= GetColumn(boxes[i].high.x); ++column)
+			{
+				cellItems.push_back(CellItem {row * m_columns + column, i});
+			}
+		}
+	}
+
+	Finish(uint32(boxes.size()), cellItems);
+}
+
+void SpatialGrid::BuildSegments(const Rect& bounds, float cellSize, std::span<const Segment> segments)
+{
+	Initialize(bounds, cellSize);
+
+	hrt::vector<CellItem> cellItems;
+	cellItems.reserve(segments.size() * 2);
+	for (uint32 i = 0; i < uint32(segments.size()); ++i)
+	{
+		// Walks the cells the segment crosses in order (Amanatides & Woo), in cell units
+		Vec2 from = (segments[i].from - bounds.low) * m_inverseCellSize;
+		Vec2 to = (segments[i].to - bounds.low) * m_inverseCellSize;
+		Vec2 delta = to - from;
+
+		int32 column = int32(GetColumn(segments[i].from.x));
+		int32 row = int32(GetRow(segments[i].from.y));
+		int32 lastColumn = int32(GetColumn(segments[i].to.x));
+		int32 lastRow = int32(GetRow(segments[i].to.y));
+
+		int32 stepX = delta.x >= 0.0f ? 1 : -1;
+		int32 stepY = delta.y >= 0.0f ? 1 : -1;
+		float deltaX = delta.x != 0.0f ? 1.0f / std::abs(delta.x) : INFINITY;
+		float deltaY = delta.y != 0.0f ? 1.0f / std::abs(delta.y) : INFINITY;
+		float nextX = delta.x != 0.0f ? (stepX > 0 ? float(column + 1) - from.x : from.x - float(column)) * deltaX : INFINITY;
+		float nextY = delta.y != 0.0f ? (stepY > 0 ? float(row + 1) - from.y : from.y - float(row)) * deltaY : INFINITY;
+
+		// Rounding can't send the walk past the end cell, it's at most this many steps
+		uint32 remaining = uint32(std::abs(lastColumn - column) + std::abs(lastRow - row));
+		cellItems.push_back(CellItem {uint32(row) * m_columns + uint32(column), i});
+		while (remaining-- > 0)
+		{
+			if (nextX < nextY ? column != lastColumn : row == lastRow)
+			{
+				column += stepX;
+				nextX += deltaX;
+			}
+			else
+			{
+				row += stepY;
+				nextY += deltaY;
+			}
+
+			cellItems.push_back(CellItem {uint32(row) * m_columns + uint32(column), i});
+		}
+	}
+
+	Finish(uint32(segments.size()), cellItems);
+}
+
+void SpatialGrid::Query(const Rect& area, hrt::vector<uint32>& out) const
+{
+	out.clear();
+	if (m_columns == 0 || !area.Overlaps(m_bounds))
+		return;
+
+	uint32 lastColumn = GetColumn(area.high.x);
+	uint32 lastRow = GetRow(area.high.y);
+	for (uint32 row = GetRow(area.low.y); row <= lastRow; ++row)
+	{
+		uint32 first = row * m_columns;
+		out.insert(out.end(), m_items.begin() + m_offsets[first + GetColumn(area.low.x)], m_items.begin() + m_offsets[first + lastColumn + 1]);
+	}
+
+	if (m_itemsSpanCells)
+	{
+		std::sort(out.begin(), out.end());
+		out.erase(std::unique(out.begin(), out.end()), out.end());
+	}
+}
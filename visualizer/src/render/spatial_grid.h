@@ -0,0 +1,76 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "layout/vec2.h"
+
+#include <heart/types.h>
+
+#include <heart/stl/vector.h>
+
+#include <span>
+
+struct Segment
+{
+	Vec2 from;
+	Vec2 to;
+};
+
+// Uniform grid over a fixed area, each cell holding the items that touch it as compressed
+// rows: cell c's items are items[offsets[c] .. offsets[c + 1]). Points land in exactly one
+// cell, boxes in every cell they overlap and segments in every cell they pass through.
+class SpatialGrid
+{
+public:
+	// Keeps very sparse layouts from asking for an enormous grid
+	static constexpr uint32 MaxCells = 1 << 22;
+
+private:
+	struct CellItem
+	{
+		uint32 cell = 0;
+		uint32 item = 0;
+	};
+
+	Rect m_bounds;
+	float m_inverseCellSize = 1.0f;
+	uint32 m_columns = 0;
+	uint32 m_rows = 0;
+
+	hrt::vector<uint32> m_offsets;
+	hrt::vector<uint32> m_items;
+
+	// Set when any item went into more than one cell, so queries have to drop repeats
+	bool m_itemsSpanCells = false;
+
+	void Initialize(const Rect& bounds, float cellSize);
+	void Finish(uint32 itemCount, const hrt::vector<CellItem>& cellItems);
+
+	uint32 GetColumn(float x) const;
+	uint32 GetRow(float y) const;
+
+public:
+	void BuildPoints(const Rect& bounds, float cellSize, std::span<const Vec2> points);
+	void BuildBoxes(const Rect& bounds, float cellSize, std::span<const Rect> boxes);
+	void BuildSegments(const Rect& bounds, float cellSize, std::span<const Segment> segments);
+
+	// Every item in a cell touching area, once each and unordered. Replaces out's contents.
+	void Query(const Rect& area, hrt::vector<uint32>& out) const;
+
+	uint32 GetCellCount() const
+	{
+		return m_columns * m_rows;
+	}
+
+	size_t GetMemoryUsage() const
+	{
+		return m_offsets.capacity() * sizeof(uint32) + m_items.capacity() * sizeof(uint32);
+	}
+};
@@ -0,0 +1,166 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#include "render/svg_renderer.h"
+
+#include "memory/managed_string.h"
+#include "render/scene_index.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+
+namespace
+{
+	// Clusters smaller than this on screen don't get a title
+	constexpr float LabelMinRadius = 24.0f;
+
+	double MicrosecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+Viewport Viewport::Fit(const Rect& area, uint32 width, uint32 height)
+{
+	Vec2 size = area.GetSize();
+
+	Viewport result;
+	result.center = area.GetCenter();
+	result.width = width;
+	result.height = height;
+	result.scale = std::min(float(width) / std::max(size.x, 1.0f), float(height) / std::max(size.y, 1.0f)) * 0.95f;
+	return result;
+}
+
+Rect Viewport::GetWorldRect() const
+{
+	Vec2 half = Vec2 {float(width), float(height)} * (0.5f / scale);
+	return Rect {center - half, center + half};
+}
+
+Vec2 Viewport::ToScreen(Vec2 world) const
+{
+	return (world - center) * scale + Vec2 {float(width) * 0.5f, float(height) * 0.5f};
+}
+
+Vec2 Viewport::ToWorld(Vec2 screen) const
+{
+	return (screen - Vec2 {float(width) * 0.5f, float(height) * 0.5f}) * (1.0f / scale) + center;
+}
+
+void SvgRenderer::AppendFormat(const char* format, ...)
+{
+	char buffer[256];
+
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+
+	if (length > 0)
+		m_svg.append(buffer, std::min(size_t(length), sizeof(buffer) - 1));
+}
+
+void SvgRenderer::AppendEscaped(const char* text)
+{
+	for (; *text; ++text)
+	{
+		if (*text == '&')
+			m_svg.append("&amp;");
+		else if (*text == '<')
+			m_svg.append("&lt;");
+		else if (*text == '>')
+			m_svg.append("&gt;");
+		else if (*text == '"')
+			m_svg.append("&quot;");
+		else
+			m_svg.push_back(*text);
+	}
+}
+
+RenderStats SvgRenderer::Render(const SceneIndex& scene, const ManagedStringPool& pool, const Viewport& viewport, const RenderSettings& settings)
+{
+	RenderStats stats;
+	stats.clustered = settings.nodeSpacing * viewport.scale < settings.clusterBelowPixels;
+
+	// Pad the query so nodes whose circles poke into view still get drawn
+	Rect area = viewport.GetWorldRect();
+	Vec2 padding = Vec2 {settings.nodeRadius, settings.nodeRadius} * (1.0f / viewport.scale);
+	area.low -= padding;
+	area.high += padding;
+
+	auto cullStart = std::chrono::steady_clock::now();
+	if (stats.clustered)
+	{
+		scene.QueryClusters(area, m_clusters);
+		m_nodes.clear();
+		m_edges.clear();
+	}
+	else
+	{
+		scene.QueryNodes(area, m_nodes);
+		scene.QueryEdges(area, m_edges);
+		m_clusters.clear();
+	}
+	stats.cullUs = MicrosecondsSince(cullStart);
+
+	auto emitStart = std::chrono::steady_clock::now();
+	m_svg.clear();
+	AppendFormat("<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%u\" height=\"%u\">\n", viewport.width, viewport.height);
+	AppendFormat("<rect width=\"100%%\" height=\"100%%\" fill=\"#1b1b1f\"/>\n");
+
+	for (uint32 index : m_clusters)
+	{
+		const SceneCluster& cluster = scene.GetCluster(index);
+		if (cluster.nodeCount == 0)
+			continue;
+
+		Vec2 center = viewport.ToScreen(cluster.centroid);
+		float radius = std::max(std::sqrt(float(cluster.nodeCount)) * settings.nodeSpacing * viewport.scale * 0.5f, 2.0f);
+		AppendFormat("<circle cx=\"%.1f\" cy=\"%.1f\" r=\"%.1f\" fill=\"#3d6e9e\" fill-opacity=\"0.6\"/>\n", center.x, center.y, radius);
+
+		if (radius >= LabelMinRadius)
+		{
+			AppendFormat("<text x=\"%.1f\" y=\"%.1f\" fill=\"#e0e0e0\" font-size=\"12\" text-anchor=\"middle\">", center.x, center.y);
+			AppendEscaped(cluster.title.CStr(pool));
+			m_svg.append("</text>\n");
+		}
+
+		++stats.clustersDrawn;
+	}
+
+	if (!m_edges.empty())
+	{
+		m_svg.append("<g stroke=\"#5a5a66\" stroke-width=\"1\">\n");
+		for (uint32 index : m_edges)
+		{
+			const Segment& edge = scene.GetEdge(index);
+			Vec2 from = viewport.ToScreen(edge.from);
+			Vec2 to = viewport.ToScreen(edge.to);
+			AppendFormat("<line x1=\"%.1f\" y1=\"%.1f\" x2=\"%.1f\" y2=\"%.1f\"/>\n", from.x, from.y, to.x, to.y);
+		}
+		m_svg.append("</g>\n");
+		stats.edgesDrawn = uint32(m_edges.size());
+	}
+
+	for (uint32 node : m_nodes)
+	{
+		Vec2 center = viewport.ToScreen(scene.GetPosition(node));
+		AppendFormat("<circle cx=\"%.1f\" cy=\"%.1f\" r=\"%.1f\" fill=\"%s\"/>\n", center.x, center.y, settings.nodeRadius, scene.IsRoot(node) ? "#e0a040" : "#8fb3d9");
+	}
+	stats.nodesDrawn = uint32(m_nodes.size());
+
+	m_svg.append("</svg>\n");
+	stats.emitUs = MicrosecondsSince(emitStart);
+
+	return stats;
+}
@@ -0,0 +1,88 @@
+/* Copyright (C) 2022 James Keats
+ *
+ * You may use, distribute, and modify this code under the terms of its modified
+ * BSD-3-Clause license. Use for any commercial purposes is prohibited.
+ * You should have received a copy of the license with this file. If not, please visit:
+ * https://github.com/growlitheharpo/heart-engine-playground
+ *
+ */
+
+#pragma once
+
+#include "layout/vec2.h"
+
+#include <heart/types.h>
+
+#include <heart/stl/string.h>
+#include <heart/stl/vector.h>
+
+class ManagedStringPool;
+class SceneIndex;
+
+struct Viewport
+{
+	// World position at the middle of the image
+	Vec2 center;
+
+	// Pixels per world unit
+	float scale = 1.0f;
+
+	uint32 width = 1920;
+	uint32 height = 1080;
+
+	// The whole of area, with a little room around it
+	static Viewport Fit(const Rect& area, uint32 width, uint32 height);
+
+	Rect GetWorldRect() const;
+
+	Vec2 ToScreen(Vec2 world) const;
+
+	Vec2 ToWorld(Vec2 screen) const;
+};
+
+struct RenderSettings
+{
+	float nodeRadius = 6.0f;
+
+	// Below this many pixels between neighbouring nodes, conversations become cluster glyphs
+	float clusterBelowPixels = 4.0f;
+
+	// Node spacing in world units, the layout's spring length
+	float nodeSpacing = 60.0f;
+};
+
+struct RenderStats
+{
+	bool clustered = false;
+
+	uint32 nodesDrawn = 0;
+	uint32 edgesDrawn = 0;
+	uint32 clustersDrawn = 0;
+
+	double cullUs = 0.0;
+	double emitUs = 0.0;
+};
+
+// Draws a SceneIndex to SVG text. Only what the grids say is in view gets drawn, and when
+// zoomed far enough out each conversation becomes a single labelled circle. Keeps its
+// scratch lists and output buffer between frames so steady-state frames don't allocate.
+class SvgRenderer
+{
+private:
+	hrt::vector<uint32> m_nodes;
+	hrt::vector<uint32> m_edges;
+	hrt::vector<uint32> m_clusters;
+
+	hrt::string m_svg;
+
+	void AppendFormat(const char* format, ...);
+	void AppendEscaped(const char* text);
+
+public:
+	RenderStats Render(const SceneIndex& scene, const ManagedStringPool& pool, const Viewport& viewport, const RenderSettings& settings);
+
+	const hrt::string& GetSvg() const
+	{
+		return m_svg;
+	}
+};